@@ -0,0 +1,84 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// capture.h - Header file containing the interface for the RF capture and replay.
+
+#ifndef INCLUDE_CAPTURE_H_
+#define INCLUDE_CAPTURE_H_
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <Arduino.h>
+#include <FS.h>
+#include <freertos/stream_buffer.h>
+#include "capture_format.h"     // NOLINT
+
+constexpr char     CAPTURE_PATH[] {"/capture.bin"};
+constexpr auto     CAPTURE_BUFFER_SIZE  {4096};         // Bytes between radio and flash
+constexpr uint32_t CAPTURE_MAX_BYTES    {512 * 1024};
+
+/**
+ * @brief The FrameCapture class records the raw frames received by the radio to
+ *        flash, and reads them back for a replay.
+ *
+ * The radio task only copies the records into a stream buffer, the loop task
+ * writes them to LittleFS, so flash writes never run in the radio task. A
+ * record that does not fit in the stream buffer is dropped whole.
+ */
+class FrameCapture {
+ private:
+    StaticStreamBuffer_t stream_struct;
+    std::array<uint8_t, CAPTURE_BUFFER_SIZE + 1> stream_storage {};
+    StreamBufferHandle_t stream {nullptr};
+
+    File file;
+    volatile bool recording {false};
+    int64_t  last_us {0};
+    uint32_t written {0};
+    uint32_t frames {0};
+    uint32_t dropped {0};
+
+    bool mount();
+
+ public:
+    bool start();
+    void stop();
+    void record(const uint8_t *frame, size_t size, int16_t rssi, int8_t snr, int64_t capturedUs);
+    void drain();
+    void dump();
+    void printStatus() const;
+
+    bool openReplay();
+    bool next(CaptureRecord *record);
+    void closeReplay();
+
+    bool isRecording() const { return recording; }
+};
+
+#endif  // INCLUDE_CAPTURE_H_
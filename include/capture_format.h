@@ -0,0 +1,84 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// File description
+// =========================================================
+// capture_format.h - Header file containing the on-flash format of the RF captures.
+
+#ifndef INCLUDE_CAPTURE_FORMAT_H_
+#define INCLUDE_CAPTURE_FORMAT_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+constexpr char     CAPTURE_MAGIC[] {"LBC1"};            // Format version, bump on change
+constexpr auto     CAPTURE_MAGIC_SIZE   {4};
+constexpr auto     CAPTURE_HEADER_SIZE  {8};            // Size, RSSI, SNR, delta
+constexpr auto     CAPTURE_MAX_FRAME    {255};          // SX126x FIFO
+
+/**
+ * @brief One captured frame.
+ *
+ * On flash, a record is its size (1 byte), RSSI (2 bytes), SNR (1 byte) and
+ * the time since the previous frame (4 bytes, µs), all little-endian, then
+ * the frame itself.
+ */
+typedef struct {
+    uint32_t delta_us;
+    int16_t  rssi;
+    int8_t   snr;
+    uint8_t  size;
+    std::array<uint8_t, CAPTURE_MAX_FRAME> frame;
+} capture_record_t;
+
+using CaptureRecord = capture_record_t;
+using CaptureHeader = std::array<uint8_t, CAPTURE_HEADER_SIZE>;
+
+uint32_t captureDelta(int64_t lastUs, int64_t capturedUs);
+void     captureEncodeHeader(uint8_t size, int16_t rssi, int8_t snr, uint32_t deltaUs,
+                             CaptureHeader *header);
+void     captureDecodeHeader(const CaptureHeader &header, CaptureRecord *record);
+
+/**
+ * @brief The CaptureReader class reads the records of a capture held in memory.
+ *
+ * Used by the host tools, which read a capture copied from the bridge, see
+ * FrameCapture::dump().
+ */
+class CaptureReader {
+ private:
+    const uint8_t *data {nullptr};
+    size_t size {0};
+    size_t offset {0};
+
+ public:
+    bool begin(const uint8_t *capture, size_t length);
+    bool next(CaptureRecord *record);
+};
+
+#endif  // INCLUDE_CAPTURE_FORMAT_H_
@@ -32,27 +32,7 @@
 #define INCLUDE_GUI_H_
 
 #include <HT_SSD1306Wire.h>
-
-
-typedef struct {
-    uint32_t received_packet_id;
-    uint32_t receive_error_count;
-    uint32_t sensor_error_count;
-    int16_t  rssi;
-} oled_gui_stats_t;
-
-typedef struct {
-    uint8_t  water_level;
-} oled_gui_info_t;
-
-typedef struct {
-    oled_gui_info_t  info;
-    oled_gui_stats_t stats;
-} oled_gui_data_t;
-
-using OledGuiData = oled_gui_data_t;
-
-#define oled_gui_data_init_default       {0, 0, 0, 0}
+#include "gui_data.h"           // NOLINT
 
 /**
  * @brief The OledGui class provides a simple interface to display information on the built-in
@@ -67,7 +47,8 @@ class OledGui {
 
     void showInfoScreen();
     void showStatsScreen();
-    void screenHeader(String header);
+    void showHistoryScreen();
+    void screenHeader(const char *header);
 
  public:
     OledGui(SSD1306Wire *guiDisplay, OledGuiData *guiData);
@@ -79,6 +60,7 @@ class OledGui {
     void splashScreen();
     void refresh();
     void nextScreen();
+    int  historyPage() const;
 };
 
 #endif  // INCLUDE_GUI_H_
@@ -0,0 +1,70 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// gui_data.h - Definition of the data shown by the GUI.
+//
+// The receive pipeline fills it and the display task draws it, see gui.h.
+// It does not depend on the display, so the host builds of the pipeline
+// include it too.
+
+#ifndef INCLUDE_GUI_DATA_H_
+#define INCLUDE_GUI_DATA_H_
+
+#include <cstdint>
+#include "history.h"            // NOLINT
+
+typedef struct {
+    uint32_t received_packet_id;
+    uint32_t receive_error_count;
+    uint32_t sensor_error_count;
+    int16_t  rssi;
+    int8_t   snr;
+    int16_t  link_margin;                       // 0.1 dB
+} oled_gui_stats_t;
+
+typedef struct {
+    uint8_t  water_level;
+} oled_gui_info_t;
+
+typedef struct {
+    uint8_t  sensors;                           // Sensors with a history, one page each
+    uint32_t sensor_id;                         // Sensor of the page shown
+    HistoryColumns columns;                     // Oldest first
+} oled_gui_history_t;
+
+typedef struct {
+    oled_gui_info_t    info;
+    oled_gui_stats_t   stats;
+    oled_gui_history_t history;                 // Filled by the display task
+} oled_gui_data_t;
+
+using OledGuiData = oled_gui_data_t;
+
+#define oled_gui_data_init_default       {0, 0, 0, 0}
+
+#endif  // INCLUDE_GUI_DATA_H_
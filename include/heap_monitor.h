@@ -0,0 +1,50 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// heap_monitor.h - Header file containing the heap budget instrumentation.
+
+#ifndef INCLUDE_HEAP_MONITOR_H_
+#define INCLUDE_HEAP_MONITOR_H_
+
+#include <cstdint>
+#include <cstddef>
+
+typedef struct {
+    size_t free_size;                           // Bytes currently free
+    size_t largest_free_block;                  // Largest allocation that can succeed
+    size_t min_free_size;                       // Lowest free size since boot
+    size_t allocated_blocks;                    // Live allocations
+    uint8_t fragmentation;                      // 0-100 %
+} heap_stats_t;
+
+using HeapStats = heap_stats_t;
+
+HeapStats readHeapStats();
+void printHeapStats(const HeapStats &stats);
+
+#endif  // INCLUDE_HEAP_MONITOR_H_
@@ -0,0 +1,86 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// history.h - Header file containing the interface for the level history.
+
+#ifndef INCLUDE_HISTORY_H_
+#define INCLUDE_HISTORY_H_
+
+#include <array>
+#include <cstdint>
+
+constexpr auto HISTORY_COLUMNS     {120};
+constexpr auto HISTORY_SPAN_MS     {24LL * 60 * 60 * 1000};
+constexpr auto HISTORY_COLUMN_US   {HISTORY_SPAN_MS * 1000 / HISTORY_COLUMNS};     // 12 min
+constexpr auto HISTORY_MAX_SENSORS {4};
+
+// An empty column has min > max, so a first reading sets both.
+typedef struct {
+    uint8_t min;
+    uint8_t max;
+} history_column_t;
+
+using HistoryColumn  = history_column_t;
+using HistoryColumns = std::array<HistoryColumn, HISTORY_COLUMNS>;
+
+constexpr HistoryColumn HISTORY_COLUMN_EMPTY {UINT8_MAX, 0};
+
+typedef struct {
+    bool     used;
+    uint64_t source;                                    // See payloadSource()
+    int64_t  newest;                                    // Column number of the newest column
+    HistoryColumns ring;
+} level_series_t;
+
+using LevelSeries = level_series_t;
+
+/**
+ * @brief The LevelHistory class keeps the last 24 h of water levels of each sensor,
+ *        decimated to one min/max column per HISTORY_COLUMN_US.
+ *
+ * Each sensor has a ring of columns indexed by column number, so a reading
+ * updates one column in O(1) and the history never allocates memory. When
+ * all the series are used, the one updated least recently is reused.
+ *
+ * The class has no lock. Taking a new series or skipping columns touches up
+ * to the whole ring, so the bridge updates and copies it under the radio
+ * mutex rather than a spinlock.
+ */
+class LevelHistory {
+ private:
+    std::array<LevelSeries, HISTORY_MAX_SENSORS> series {};
+
+    LevelSeries *find(uint64_t source);
+
+ public:
+    void    update(uint64_t source, uint8_t level, int64_t capturedUs);
+    uint8_t count() const;
+    bool    copy(uint8_t page, int64_t nowUs, uint64_t *source, HistoryColumns *columns) const;
+};
+
+#endif  // INCLUDE_HISTORY_H_
@@ -0,0 +1,74 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// json_writer.h - Header file containing the interface for the JSON writer.
+
+#ifndef INCLUDE_JSON_WRITER_H_
+#define INCLUDE_JSON_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+constexpr auto JSON_WRITER_MAX_DEPTH {4};
+
+/**
+ * @brief The JsonWriter class writes a JSON object into a caller supplied buffer.
+ *
+ * Members are written in order, nested objects are opened with begin() and
+ * closed with end(). Nothing is allocated: a document that does not fit in
+ * the buffer is marked as overflowed, and finish() returns 0 for it.
+ */
+class JsonWriter {
+ private:
+    char  *buffer;
+    size_t size;
+    size_t length {0};
+    uint8_t depth {0};
+    bool    empty {true};                               // No member yet in the current object
+    bool    overflow {false};
+
+    void append(const char *text, size_t textLength);
+    void appendf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+    void appendString(const char *text);
+    void key(const char *name);
+
+ public:
+    JsonWriter(char *text, size_t textSize);
+
+    void begin(const char *name = nullptr);
+    void end();
+    void addString(const char *name, const char *value);
+    void addInt(const char *name, int64_t value);
+    void addTenths(const char *name, int32_t tenths);
+    void addServerTimestamp(const char *name);
+    size_t finish();
+
+    bool overflowed() const { return overflow; }
+};
+
+#endif  // INCLUDE_JSON_WRITER_H_
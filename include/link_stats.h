@@ -0,0 +1,111 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// link_stats.h - Per-sensor rolling link-quality statistics.
+
+#ifndef INCLUDE_LINK_STATS_H_
+#define INCLUDE_LINK_STATS_H_
+
+#include <array>
+#include <cstdint>
+
+constexpr auto LINK_STATS_MAX_SENSORS {8};      // Sensors tracked at once
+constexpr auto LINK_HIST_BINS         {8};      // Bins per histogram
+
+constexpr auto LINK_RSSI_HIST_MIN     {-130};   // dBm, lower edge of bin 0
+constexpr auto LINK_RSSI_HIST_STEP    {10};     // dB per bin
+constexpr auto LINK_SNR_HIST_MIN      {-20};    // dB, lower edge of bin 0
+constexpr auto LINK_SNR_HIST_STEP     {4};      // dB per bin
+
+constexpr auto LINK_EWMA_SHIFT        {4};      // EWMA values are stored in Q4
+constexpr auto LINK_EWMA_WEIGHT       {8};      // alpha = 1 / LINK_EWMA_WEIGHT
+
+constexpr auto LINK_ADVICE_MIN_SAMPLES {16};    // Samples before giving advice
+constexpr auto LINK_MARGIN_FASTER      {100};   // 0.1 dB, margin to step SF down
+constexpr auto LINK_MARGIN_SLOWER      {30};    // 0.1 dB, margin to step SF up
+constexpr auto LINK_REORDER_WINDOW     {16};    // Packets a late frame may lag behind
+
+typedef struct {
+    bool     used;
+    uint64_t source;                            // See payloadSource()
+    uint32_t samples;
+    uint32_t last_update;                       // Value of the update counter
+    int32_t  rssi_ewma;                         // dBm, Q4
+    int32_t  snr_ewma;                          // dB, Q4
+    int16_t  rssi_min;
+    int16_t  rssi_max;
+    int8_t   snr_min;
+    int8_t   snr_max;
+    bool     has_packet;
+    uint32_t last_packet_id;
+    uint32_t missed;                            // Packets lost, from the sequence
+    std::array<uint32_t, LINK_HIST_BINS> rssi_hist;
+    std::array<uint32_t, LINK_HIST_BINS> snr_hist;
+} link_stats_t;
+
+enum class LinkAdvice {
+    LINK_ADVICE_NONE = 0,                       // Not enough samples yet
+    LINK_ADVICE_KEEP,                           // Current data rate is fine
+    LINK_ADVICE_FASTER,                         // Enough margin for a lower SF
+    LINK_ADVICE_SLOWER,                         // Needs a higher SF
+};
+
+/**
+ * @brief The LinkStats class keeps rolling RSSI/SNR statistics and the packet sequence
+ *        of each sensor heard by the bridge.
+ *
+ * Every statistic is updated incrementally from a fixed-size table, so recording a
+ * packet never allocates memory.
+ */
+class LinkStats {
+ private:
+    std::array<link_stats_t, LINK_STATS_MAX_SENSORS> table {};
+
+    uint8_t  spreading_factor;
+    uint32_t update_count {0};
+
+    link_stats_t *slot(uint64_t source);
+
+ public:
+    explicit LinkStats(uint8_t sf = 7);
+
+    void setSpreadingFactor(uint8_t sf);
+    const link_stats_t *update(uint64_t source, int16_t rssi, int8_t snr);
+    bool sequence(uint64_t source, uint32_t packetId, uint32_t *missed);
+    const link_stats_t *find(uint64_t source) const;
+    const std::array<link_stats_t, LINK_STATS_MAX_SENSORS> &entries() const { return table; }
+
+    int16_t rssiAverage(const link_stats_t &stats) const;
+    int16_t snrAverageTenths(const link_stats_t &stats) const;
+    int16_t marginTenths(const link_stats_t &stats) const;
+    LinkAdvice advice(const link_stats_t &stats) const;
+
+    static int16_t demodFloorTenths(uint8_t sf);
+};
+
+#endif  // INCLUDE_LINK_STATS_H_
@@ -0,0 +1,138 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// low_power.h - Header file containing the interface for the low-power receiver.
+
+#ifndef INCLUDE_LOW_POWER_H_
+#define INCLUDE_LOW_POWER_H_
+
+#include <cstdint>
+#include "radio_profile.h"      // NOLINT
+
+#if defined(BRIDGE_LOW_POWER) && !defined(BRIDGE_RELAY_MODE)
+#error "BRIDGE_LOW_POWER needs BRIDGE_RELAY_MODE, the Wi-Fi uplink keeps the bridge awake"
+#endif
+
+constexpr auto RADIO_DIO1_IO                 {14};      // SX1262 DIO1 on the Heltec V3
+
+constexpr auto LOW_POWER_CPU_MHZ             {80};
+constexpr auto LOW_POWER_CAD_SYMBOLS         {2};       // SX126x default CAD length
+constexpr auto LOW_POWER_LOCK_SYMBOLS        {3};       // Preamble left to lock after a CAD
+constexpr auto LOW_POWER_RX_WINDOW_SYMBOLS   {16};      // Sync word and header, with margin
+constexpr auto LOW_POWER_WAKE_OVERHEAD_US    {500};     // Light sleep entry and exit
+constexpr auto LOW_POWER_LIGHT_SLEEP_MIN_US  {1000};
+constexpr auto LOW_POWER_RX_POLL_US          {10000};
+
+// Typical supply currents, for the estimate only. Board regulators and the
+// OLED are not included.
+constexpr auto SX126X_RX_UA                  {4600};    // Rx and CAD, DC-DC, 125 kHz
+constexpr auto SX126X_TX_UA                  {45000};   // 14 dBm
+constexpr auto SX126X_SLEEP_UA               {2};       // Warm start
+constexpr auto ESP32_ACTIVE_UA               {22000};   // 80 MHz, radios off
+constexpr auto ESP32_LIGHT_SLEEP_UA          {240};
+
+typedef struct {
+    uint32_t cycles;                                    // CADs, or polls in continuous reception
+    uint32_t detections;                                // CAD found a preamble
+    uint32_t false_wakeups;                             // Detection without a packet
+    uint32_t cad_timeouts;
+    uint32_t packets;
+} low_power_stats_t;
+
+using LowPowerStats = low_power_stats_t;
+
+typedef struct {
+    int64_t  period_us;                                 // Since the last report
+    int64_t  radio_on_us;                               // CAD, reception and transmission
+    int64_t  cpu_sleep_us;                              // Light sleep
+    uint32_t current_ua;                                // Estimated average supply current
+} low_power_duty_t;
+
+using LowPowerDuty = low_power_duty_t;
+
+/**
+ * @brief The CadReceiver class listens for sensor frames with Channel Activity
+ *        Detection instead of continuous reception.
+ *
+ * The radio sleeps and wakes up for a CAD often enough to catch every preamble
+ * of the active profile. Only a detection opens a reception window. The ESP32
+ * spends the gaps in light sleep, woken by its timer or by DIO1, and the radio
+ * task blocks for the CAD itself. When the preamble is too short for a CAD
+ * cycle, the radio stays in reception and only the ESP32 sleeps.
+ *
+ * cycle() uses the radio and runs under the radio mutex, idle() only sleeps
+ * and runs without it, see low_power.cpp.
+ */
+class CadReceiver {
+ private:
+    enum class State { SLEEP, CAD, RX };
+
+    volatile State state {State::SLEEP};
+
+    RadioProfile sized {};
+    uint32_t symbol_us {0};
+    uint32_t sleep_us {0};
+    uint32_t cad_timeout_us {0};
+    uint32_t rx_window_ms {0};
+    uint32_t rx_guard_us {0};
+    bool     cad_cycles {false};                        // false: continuous reception
+    bool     light_sleep {false};
+    bool     radio_asleep {false};
+
+    LowPowerStats stats {};
+
+    // Time spent in each state since the last report
+    int64_t period_start {0};
+    int64_t cad_us {0};
+    int64_t rx_us {0};
+    int64_t tx_us {0};
+    int64_t cpu_sleep_us {0};
+    int64_t last_cycle {0};
+
+    bool changed(const RadioProfile &profile) const;
+    void size(const RadioProfile &profile);
+    void sleepFor(uint32_t us, bool wakeOnDio1);
+    void waitDio1(uint32_t us);
+    void listen();
+
+ public:
+    void begin(const RadioProfile &profile);
+    void cycle(const RadioProfile &profile);
+    void idle();
+    void cadDone(bool detected);
+    void rxDone(bool packet);
+    void txDone(uint32_t ms);
+    LowPowerDuty duty() const;
+    void report(uint32_t missed);
+
+    bool cadCycles() const { return cad_cycles; }
+    uint32_t sleepUs() const { return sleep_us; }
+    const LowPowerStats &statistics() const { return stats; }
+};
+
+#endif  // INCLUDE_LOW_POWER_H_
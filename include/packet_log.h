@@ -0,0 +1,76 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// packet_log.h - Header file containing the interface for the per-packet log.
+
+#ifndef INCLUDE_PACKET_LOG_H_
+#define INCLUDE_PACKET_LOG_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <Arduino.h>
+#include "static_pool.h"        // NOLINT
+
+constexpr auto PACKET_LOG_ENTRIES    {16};      // Lines waiting to be printed
+constexpr auto PACKET_LOG_ENTRY_SIZE {96};      // Longer lines are truncated
+
+typedef struct {
+    size_t length;
+    std::array<char, PACKET_LOG_ENTRY_SIZE> text;
+} packet_log_entry_t;
+
+using PacketLogEntry = packet_log_entry_t;
+
+/**
+ * @brief The PacketLog class holds the log lines written for each packet until the
+ *        loop task prints them.
+ *
+ * The lines are formatted into entries taken from a StaticPool, so logging a
+ * packet never allocates memory, and the radio and uplink tasks never wait on
+ * the serial port. A line is dropped when all the entries are waiting.
+ */
+class PacketLog {
+ private:
+    StaticPool<PacketLogEntry, PACKET_LOG_ENTRIES> pool;
+    std::array<PacketLogEntry *, PACKET_LOG_ENTRIES> pending {};
+
+    size_t first {0};
+    size_t count {0};
+
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+ public:
+    void printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+    void flush();
+
+    size_t   waiting() const { return count; }
+    uint32_t droppedCount() const { return pool.failureCount(); }
+};
+
+#endif  // INCLUDE_PACKET_LOG_H_
@@ -0,0 +1,111 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// payload_registry.h - Header file containing the registry of the sensor payload types.
+
+#ifndef INCLUDE_PAYLOAD_REGISTRY_H_
+#define INCLUDE_PAYLOAD_REGISTRY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <pb.h>
+#include "lora_payload.pb.h"    // NOLINT
+
+class JsonWriter;
+
+// A frame is a message type byte followed by the nanopb encoded message. Frames
+// from sensors that predate the envelope start directly with the LoraPayload
+// field 1 tag, which is never used as a message type.
+enum class PayloadTypeId : uint8_t {
+    PAYLOAD_TYPE_NONE = 0,
+    PAYLOAD_TYPE_WATER_LEVEL,
+    PAYLOAD_TYPE_AIR,
+    PAYLOAD_TYPE_RELAY_BATCH,                   // RelayBatch, see relay.h
+};
+
+constexpr auto    PAYLOAD_TYPE_COUNT {3};     // Sensor types, relay batches excluded
+constexpr uint8_t PAYLOAD_LEGACY_TAG {0x08};   // Tag of LoraPayload.id, varint
+
+constexpr auto LORA_SENSOR_MAX_PAYLOAD {30};   // Bytes, longest sensor frame
+constexpr auto LORA_RELAY_MAX_PAYLOAD  {192};  // Bytes, fits a full relay batch
+
+typedef union {
+    LoraPayload water_level;
+    AirPayload  air;
+} payload_body_t;
+
+typedef struct {
+    uint32_t sensor_id;
+    uint32_t packet_id;
+    uint32_t err_sensor;
+    uint32_t boot_id;
+    bool     has_sensor_id;
+    bool     has_boot_id;
+} payload_header_t;
+
+typedef struct {
+    const char          *name;
+    const pb_msgdesc_t  *fields;                // nanopb descriptor
+    const char          *path;                  // RTDB node, relative to databasePath
+    payload_header_t   (*header)(const payload_body_t &body);
+    void               (*serialize)(const payload_body_t &body, JsonWriter *json);
+} payload_type_t;
+
+using PayloadBody   = payload_body_t;
+using PayloadHeader = payload_header_t;
+using PayloadType   = payload_type_t;
+
+/**
+ * @brief Return the key identifying a sensor across payload types, since sensors of
+ *        different types may share the same sensor_id.
+ *
+ * The key holds the type above the whole sensor_id, so no two sensors share it.
+ */
+constexpr uint64_t payloadSource(PayloadTypeId type, uint32_t sensorId) {
+    return (static_cast<uint64_t>(type) << 32) | sensorId;
+}
+
+constexpr uint8_t  payloadSourceType(uint64_t source) { return static_cast<uint8_t>(source >> 32); }
+constexpr uint32_t payloadSourceSensor(uint64_t source) { return static_cast<uint32_t>(source); }
+
+/**
+ * @brief Tell whether a frame names its sensor and the boot of the sensor.
+ *
+ * Only such frames have a packet ID that no other frame shares: sensors
+ * without a sensor_id all share sensor 0, and the packet ID of a sensor
+ * starts again when it restarts.
+ */
+constexpr bool payloadIdentified(const payload_header_t &header) {
+    return header.has_sensor_id && header.has_boot_id;
+}
+
+const PayloadType *payloadType(uint8_t type);
+PayloadTypeId      payloadFrameType(const uint8_t *frame, size_t size,
+                                    const uint8_t **body, size_t *bodySize);
+
+#endif  // INCLUDE_PAYLOAD_REGISTRY_H_
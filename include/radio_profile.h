@@ -0,0 +1,154 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// radio_profile.h - Header file containing the interface for the radio profiles.
+
+#ifndef INCLUDE_RADIO_PROFILE_H_
+#define INCLUDE_RADIO_PROFILE_H_
+
+#include <array>
+#include <Preferences.h>
+#include "payload_registry.h"   // NOLINT
+
+constexpr auto RADIO_PROFILE_NAME_LEN      {12};        // Including the terminator
+constexpr auto RADIO_PROFILE_MAX_BUILTIN   {5};
+constexpr auto RADIO_PROFILE_MAX_USER      {4};
+constexpr auto RADIO_PROFILE_MAX           {RADIO_PROFILE_MAX_BUILTIN + RADIO_PROFILE_MAX_USER};
+
+constexpr auto RADIO_PROFILE_NVS_VERSION   {1};         // Bump when radio_profile_t changes
+constexpr auto RADIO_PROFILE_PROBATION_MS  {15 * 60 * 1000};
+constexpr auto RADIO_PROFILE_BENCH_MIN_MS  {10 * 1000};
+constexpr char RADIO_PROFILE_UPLINK[]      {"sf7bw125ch2"};  // Default uplink of a relay
+// A bridge receiving relay batches listens on the uplink of the relays by
+// default, the upstream link is a single channel.
+#ifdef BRIDGE_RELAY_UPSTREAM
+constexpr const char *RADIO_PROFILE_DEFAULT {RADIO_PROFILE_UPLINK};
+#else
+constexpr char RADIO_PROFILE_DEFAULT[]     {"sf7bw125"};
+#endif
+
+constexpr auto LORA_SYMBOL_TIMEOUT         {0};         // Symbols
+constexpr auto LORA_FIX_LENGTH_PAYLOAD_ON  {false};
+constexpr auto LORA_IQ_INVERSION_ON        {false};
+// Only the relays and the bridges they forward to receive relay batches, the
+// other bridges reject anything longer than a sensor frame in the radio.
+#if defined(BRIDGE_RELAY_MODE) || defined(BRIDGE_RELAY_UPSTREAM)
+constexpr auto LORA_MAX_PAYLOAD_LENGTH     {LORA_RELAY_MAX_PAYLOAD};
+constexpr auto LORA_RELAY_BATCHES          {true};
+#else
+constexpr auto LORA_MAX_PAYLOAD_LENGTH     {LORA_SENSOR_MAX_PAYLOAD};
+constexpr auto LORA_RELAY_BATCHES          {false};
+#endif
+#ifdef BRIDGE_LOW_POWER
+constexpr auto LORA_RX_CONTINUOUS          {false};     // Windows opened by CAD, see low_power.h
+#else
+constexpr auto LORA_RX_CONTINUOUS          {true};
+#endif
+
+typedef struct {
+    char     name[RADIO_PROFILE_NAME_LEN];
+    uint32_t frequency;                                 // Hz
+    uint8_t  bandwidth;                                 // [0: 125 kHz,
+                                                        //  1: 250 kHz,
+                                                        //  2: 500 kHz]
+    uint8_t  spreading_factor;                          // [SF7..SF12]
+    uint8_t  coding_rate;                               // [1: 4/5,
+                                                        //  2: 4/6,
+                                                        //  3: 4/7,
+                                                        //  4: 4/8]
+    uint16_t preamble_length;                           // Same for Tx and Rx
+} radio_profile_t;
+
+using RadioProfile = radio_profile_t;
+
+typedef struct {
+    uint32_t received;
+    uint32_t missed;
+} radio_bench_result_t;
+
+/**
+ * @brief The RadioProfiles class manages the named LoRa receive configurations of
+ *        the bridge.
+ *
+ * Built-in profiles are compiled in, user profiles, the active profile and the
+ * uplink profile are kept in NVS. A newly selected profile stays on probation
+ * until a packet is decoded with it, and the previous profile is restored if
+ * none arrives in time. The uplink profile is the one a relay transmits its
+ * batches with; it must be on another channel than the active profile.
+ */
+class RadioProfiles {
+ private:
+    Preferences *prefs;
+
+    std::array<RadioProfile, RADIO_PROFILE_MAX> profiles {};
+    uint8_t count {0};
+    uint8_t active_index {0};
+    uint8_t fallback_index {0};
+    uint8_t uplink_index {0};
+
+    bool     on_probation {false};
+    uint32_t probation_start {0};
+
+    bool     bench_running {false};
+    uint8_t  bench_index {0};
+    uint8_t  bench_restore_index {0};
+    uint32_t bench_dwell_ms {0};
+    uint32_t bench_start {0};
+    std::array<radio_bench_result_t, RADIO_PROFILE_MAX> bench_results {};
+
+    void configureRx(uint8_t index);
+    void apply(uint8_t index);
+    void persistUserProfiles();
+    void persistActive();
+    int  find(const char *name) const;
+    bool sameChannel(uint8_t a, uint8_t b) const;
+    void printBenchReport() const;
+
+ public:
+    explicit RadioProfiles(Preferences *nvs);
+
+    void begin();
+    bool select(const char *name);
+    bool save(const RadioProfile &profile);
+    void packetReceived(uint32_t missed);
+    void tick(uint32_t now);
+    bool startBenchmark(uint32_t dwellMs);
+    void list() const;
+    bool setUplink(const char *name);
+    bool uplinkUsable() const;
+    bool configureUplinkTx(int8_t power, uint32_t timeoutMs);
+    void resumeRx();
+
+    const RadioProfile &active() const { return profiles[active_index]; }
+    const RadioProfile &uplink() const { return profiles[uplink_index]; }
+    bool benchmarkRunning() const { return bench_running; }
+
+    static bool isValid(const RadioProfile &profile);
+};
+
+#endif  // INCLUDE_RADIO_PROFILE_H_
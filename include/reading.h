@@ -0,0 +1,58 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// reading.h - Definition of the sensor reading record passed from the radio task
+//             to the uplink task.
+
+#ifndef INCLUDE_READING_H_
+#define INCLUDE_READING_H_
+
+#include <cstdint>
+#include "json_writer.h"        // NOLINT
+#include "payload_registry.h"   // NOLINT
+
+typedef struct {
+    PayloadTypeId type;
+    PayloadHeader header;
+    PayloadBody   body;
+    int16_t  rssi;
+    int8_t   snr;
+    int16_t  rssi_avg;
+    int16_t  rssi_min;
+    int16_t  rssi_max;
+    int16_t  snr_avg;                           // 0.1 dB
+    int16_t  link_margin;                       // 0.1 dB
+    int64_t  captured_us;                       // Monotonic, see wall_clock.h
+    uint8_t  hops;                              // Relays the frame went through
+} sensor_reading_t;
+
+using SensorReading = sensor_reading_t;
+
+void buildReadingJson(const SensorReading &reading, JsonWriter *json);
+
+#endif  // INCLUDE_READING_H_
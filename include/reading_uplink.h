@@ -0,0 +1,103 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// File description
+// =========================================================
+// reading_uplink.h - Header file containing the interface for the upload of the readings.
+
+#ifndef INCLUDE_READING_UPLINK_H_
+#define INCLUDE_READING_UPLINK_H_
+
+#include <atomic>
+#include <cstdint>
+#include <Arduino.h>
+#include "packet_log.h"         // NOLINT
+#include "reading.h"            // NOLINT
+#include "receive_pipeline.h"   // NOLINT
+#include "rtdb_uplink.h"        // NOLINT
+#include "static_pool.h"        // NOLINT
+
+constexpr auto UPLINK_QUEUE_LENGTH         {16};
+constexpr auto READING_POOL_SIZE           {UPLINK_QUEUE_LENGTH + UPLINK_MAX_PENDING};  // Queue + uplink
+constexpr auto LATENCY_EWMA_WEIGHT         {8};
+
+/**
+ * @brief The ReadingUplink class takes the readings from the radio task to the
+ *        database.
+ *
+ * The radio task queues each new reading with queueReading(): it is copied
+ * into a record of the reading pool and its pointer goes through a FreeRTOS
+ * queue, so a slow upload never stalls the radio nor allocates memory. The
+ * uplink task moves the queued readings to the RtdbUplink while it has room,
+ * see submitQueued(), and hands back the completed writes with done(), which
+ * returns the records to the pool.
+ *
+ * It does not depend on the board: the bridge gives it its ID and boot ID,
+ * and the host tests run it over the stub TLS client.
+ */
+class ReadingUplink {
+ private:
+    StaticPool<SensorReading, READING_POOL_SIZE> pool;
+    QueueHandle_t queue {nullptr};
+
+    RtdbUplink *uplink;
+    PacketLog  *log;
+    const char *database_path {""};
+
+    // Records of the frames that do not identify their sensor are keyed by the
+    // bridge instead, see submit().
+    uint32_t bridge_id {0};
+    uint32_t boot_id {0};
+    uint32_t record_count {0};
+
+    // Counted by the radio and uplink tasks, which run on different cores.
+    std::atomic<uint32_t> drop_count {0};
+
+    // Capture to upload acknowledgment latency, owned by the uplink task
+    uint32_t latency_avg_ms {0};
+    uint32_t latency_max_ms {0};
+
+    void submit(SensorReading *reading);
+
+ public:
+    ReadingUplink(RtdbUplink *rtdbUplink, PacketLog *packetLog)
+        : uplink(rtdbUplink), log(packetLog) {}
+
+    bool begin(const char *databasePath, uint32_t bridgeId, uint32_t bootId);
+    void queueReading(const ReceivePipeline &pipeline, const ReceivedReading &received);
+    void submitQueued();
+    void waitQueued(uint32_t timeoutMs);
+    void done(SensorReading *reading, int status);
+
+    uint32_t waiting() const { return uxQueueMessagesWaiting(queue); }
+    uint32_t dropped() const { return drop_count.load(); }
+    uint32_t latencyAvgMs() const { return latency_avg_ms; }
+    uint32_t latencyMaxMs() const { return latency_max_ms; }
+    const StaticPool<SensorReading, READING_POOL_SIZE> &readingPool() const { return pool; }
+};
+
+#endif  // INCLUDE_READING_UPLINK_H_
@@ -0,0 +1,190 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// receive_pipeline.h - Header file containing the interface for the receive pipeline.
+
+#ifndef INCLUDE_RECEIVE_PIPELINE_H_
+#define INCLUDE_RECEIVE_PIPELINE_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <Arduino.h>
+#include "gui_data.h"           // NOLINT
+#include "history.h"            // NOLINT
+#include "json_writer.h"        // NOLINT
+#include "link_stats.h"         // NOLINT
+#include "packet_log.h"         // NOLINT
+#include "payload_registry.h"   // NOLINT
+#include "radio_profile.h"      // NOLINT
+#include "reading.h"            // NOLINT
+#include "recent_filter.h"      // NOLINT
+
+constexpr auto REPLAY_RESULT_SIZE {768};      // See ReceivePipeline::replayJson()
+
+enum class ReceiveStage : uint8_t {
+    DECODE = 0,
+    DEDUP,
+    GUI,
+    UPLINK,
+    COUNT,
+};
+
+// Nanoseconds, from any fixed origin
+typedef int64_t (*stage_clock_t)(void);
+
+/**
+ * @brief The StageTimer class measures the time spent in each stage of the receive
+ *        pipeline during a replay.
+ *
+ * Each lap() charges the time since the previous mark to a stage. The timer
+ * does nothing until it is enabled, so the marks can stay in the pipeline.
+ * The clock is the caller's, in nanoseconds: the bridge scales its
+ * microsecond clock, the host benchmarks use their steady clock.
+ */
+class StageTimer {
+ private:
+    static constexpr size_t STAGES {static_cast<size_t>(ReceiveStage::COUNT)};
+
+    stage_clock_t clock {nullptr};
+    int64_t last {0};
+    std::array<int64_t, STAGES>  total_ns {};
+    std::array<int64_t, STAGES>  max_ns {};
+    std::array<uint32_t, STAGES> laps {};
+
+ public:
+    void enable(stage_clock_t stageClock);
+    void disable() { clock = nullptr; }
+    void mark();
+    void lap(ReceiveStage stage);
+    void addJson(JsonWriter *json) const;
+};
+
+typedef struct {
+    uint32_t frames;                                    // Frames given to receive()
+    uint32_t readings;                                  // New readings, passed to the hooks
+    uint32_t errors;                                    // Readings after missed packets
+    uint32_t missed;                                    // Packets missed
+    uint32_t suppressed;                                // Already seen, see RecentFilter
+    uint32_t unknown;                                   // Unknown message type
+    uint32_t oversize;
+    uint32_t undecodable;
+} receive_counters_t;
+
+using ReceiveCounters = receive_counters_t;
+
+// A new reading, valid until the hook returns
+typedef struct {
+    PayloadTypeId       type;
+    PayloadHeader       header;
+    const PayloadBody  *body;
+    const link_stats_t *link;
+    const uint8_t      *frame;                          // As received, for a relay
+    size_t              size;
+    int16_t             rssi;
+    int8_t              snr;
+    int64_t             captured_us;                    // Monotonic, see wall_clock.h
+    uint32_t            hops;                           // Relays the frame went through
+    uint32_t            missed;                         // Packets missed just before
+} received_reading_t;
+
+using ReceivedReading = received_reading_t;
+
+typedef void (*receive_hook_t)(const ReceivedReading &reading);
+
+typedef struct {
+    receive_hook_t gui;                                 // The GUI data changed, or nullptr
+    receive_hook_t reading;                             // Queue or relay the reading, or nullptr
+} receive_hooks_t;
+
+using ReceiveHooks = receive_hooks_t;
+
+typedef struct {
+    bool     real_time;
+    uint32_t frames;
+    uint32_t passes;                                    // Over the capture
+    int64_t  duration_us;
+    uint32_t allocations;                               // During the replay
+} replay_result_t;
+
+using ReplayResult = replay_result_t;
+
+/**
+ * @brief The ReceivePipeline class takes a received frame through the stages of
+ *        the bridge: decode, dedup, GUI data and uplink.
+ *
+ * It does not depend on the board: the radio task of the bridge, the capture
+ * replay, the host benchmarks, the fuzz harness and the tests all run frames
+ * through it. Each pipeline has its own receive state, so a replay runs into
+ * a scratch pipeline and leaves the live one alone. What happens to a new
+ * reading, queued for the uplink or added to a relay batch, is up to the
+ * hooks.
+ *
+ * The class has no lock, except around the GUI data, which the display task
+ * copies with copyGui(). The bridge runs the live pipeline and reads its link
+ * statistics and history under the radio mutex.
+ */
+class ReceivePipeline {
+ private:
+    LinkStats       link_stats;
+#ifndef BRIDGE_NO_RECENT_FILTER
+    RecentFilter    recent_frames;
+#endif
+    LevelHistory    level_history;
+    OledGuiData     gui_data {};
+    ReceiveCounters counters {};
+
+    ReceiveHooks  hooks;
+    PacketLog    *log;
+    StageTimer   *timer {nullptr};
+    portMUX_TYPE  gui_lock = portMUX_INITIALIZER_UNLOCKED;
+
+    void decodeFrame(const uint8_t *frame, size_t size, int16_t rssi, int8_t snr,
+                     int64_t capturedUs, uint32_t hops);
+    void unpackRelayBatch(const uint8_t *body, size_t bodySize, int16_t rssi, int8_t snr,
+                          int64_t capturedUs);
+    void processPayload(ReceivedReading *reading);
+    void lap(ReceiveStage stage);
+
+ public:
+    ReceivePipeline(const ReceiveHooks &receiveHooks, PacketLog *packetLog);
+
+    void reset(uint8_t sf);
+    void setSpreadingFactor(uint8_t sf) { link_stats.setSpreadingFactor(sf); }
+    void setTimer(StageTimer *stageTimer) { timer = stageTimer; }
+    void receive(const uint8_t *frame, size_t size, int16_t rssi, int8_t snr, int64_t capturedUs);
+    void fillReading(const ReceivedReading &received, SensorReading *reading) const;
+    void copyGui(OledGuiData *data);
+    size_t replayJson(const ReplayResult &result, char *text, size_t size) const;
+
+    const LinkStats &linkStats() const { return link_stats; }
+    const LevelHistory &history() const { return level_history; }
+    const ReceiveCounters &statistics() const { return counters; }
+};
+
+#endif  // INCLUDE_RECEIVE_PIPELINE_H_
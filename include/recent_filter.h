@@ -0,0 +1,88 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// recent_filter.h - Header file containing the recently-seen frame filter.
+
+#ifndef INCLUDE_RECENT_FILTER_H_
+#define INCLUDE_RECENT_FILTER_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+constexpr auto RECENT_FILTER_CAPACITY   {64};                           // Keys remembered
+constexpr auto RECENT_FILTER_TABLE_BITS {7};
+constexpr auto RECENT_FILTER_TABLE_SIZE {1 << RECENT_FILTER_TABLE_BITS};  // Load <= 50 %
+
+static_assert(RECENT_FILTER_TABLE_SIZE >= 2 * RECENT_FILTER_CAPACITY,
+              "The hash table must stay at most half full");
+
+/**
+ * @brief The RecentFilter class remembers the last RECENT_FILTER_CAPACITY keys
+ *        inserted, in a fixed-size open addressing hash set.
+ *
+ * When full, inserting a key forgets the oldest one. Lookups and inserts are O(1)
+ * and never allocate. Key 0 is reserved.
+ */
+class RecentFilter {
+ private:
+    std::array<uint64_t, RECENT_FILTER_TABLE_SIZE> table {};
+    std::array<uint64_t, RECENT_FILTER_CAPACITY>   fifo {};
+
+    size_t next {0};
+    size_t count {0};
+
+    static size_t home(uint64_t key);
+
+    // splitmix64 finalizer
+    static uint64_t mix(uint64_t value) {
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+        return value ^ (value >> 31);
+    }
+    int  find(uint64_t key) const;
+    void remove(uint64_t key);
+
+ public:
+    bool contains(uint64_t key) const { return find(key) >= 0; }
+    bool insert(uint64_t key);
+
+    /**
+     * @brief Return the key of a frame.
+     *
+     * A source, a boot ID and a packet ID take more than 64 bits, so the key is
+     * a hash of all three. A collision would need two of the keys remembered to
+     * share 64 bits.
+     */
+    static uint64_t frameKey(uint64_t source, uint32_t bootId, uint32_t packetId) {
+        uint64_t key = mix(mix(source) ^ ((static_cast<uint64_t>(bootId) << 32) | packetId));
+        return (key != 0) ? key : 1;
+    }
+};
+
+#endif  // INCLUDE_RECENT_FILTER_H_
@@ -0,0 +1,81 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// relay.h - Header file containing the interface for the relay aggregator.
+
+#ifndef INCLUDE_RELAY_H_
+#define INCLUDE_RELAY_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "lora_payload.pb.h"    // NOLINT
+
+constexpr auto RELAY_MAX_ENTRIES   {pb_arraysize(RelayBatch, entries)};
+constexpr auto RELAY_MAX_HOLD_MS   {2000};              // Oldest entry age before sending
+constexpr auto RELAY_MAX_HOPS      {3};
+constexpr auto RELAY_MAX_AGE_MS    {60 * 1000};         // Highest age reported for an entry
+constexpr auto RELAY_TX_POWER      {14};                // dBm
+constexpr auto RELAY_TX_TIMEOUT_MS {3000};
+
+typedef struct {
+    uint32_t frames_in;
+    uint32_t frames_dropped;                            // Batch full or too many hops
+    uint32_t batches_out;
+    uint32_t entries_out;
+    uint32_t hold_avg_ms;                               // Moving average of the hold time
+} relay_stats_t;
+
+using RelayStats = relay_stats_t;
+
+/**
+ * @brief The RelayAggregator class packs the sensor frames heard by a relay into
+ *        RelayBatch frames for the upstream bridge.
+ *
+ * Frames are kept as received, along with their RSSI, SNR and hop count, so the
+ * upstream bridge decodes them exactly as if it had heard them directly. A batch is
+ * sent when it is full or when its oldest frame has waited RELAY_MAX_HOLD_MS.
+ */
+class RelayAggregator {
+ private:
+    RelayBatch batch = RelayBatch_init_zero;
+    std::array<int64_t, RELAY_MAX_ENTRIES> captured_us {};
+
+    RelayStats stats {};
+
+ public:
+    void begin(uint32_t relayId);
+    bool add(const uint8_t *frame, size_t size, int16_t rssi, int8_t snr,
+             uint32_t hops, int64_t capturedUs);
+    bool ready(int64_t now) const;
+    size_t encode(uint8_t *buffer, size_t size, int64_t now);
+
+    const RelayStats &statistics() const { return stats; }
+};
+
+#endif  // INCLUDE_RELAY_H_
@@ -0,0 +1,150 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// rtdb_uplink.h - Header file containing the interface for the asynchronous RTDB uplink.
+
+#ifndef INCLUDE_RTDB_UPLINK_H_
+#define INCLUDE_RTDB_UPLINK_H_
+
+#include <array>
+#include <cstdint>
+#include <WiFiClientSecure.h>
+
+constexpr auto UPLINK_MAX_PENDING          {8};         // Requests held by the uplink
+constexpr auto UPLINK_MAX_IN_FLIGHT        {4};         // Requests sent without a response
+constexpr auto UPLINK_MAX_RETRIES          {3};
+constexpr auto UPLINK_PATH_SIZE            {96};
+constexpr auto UPLINK_BODY_SIZE            {512};
+constexpr auto UPLINK_TOKEN_SIZE           {1280};      // Firebase ID tokens are about 1 KB
+constexpr auto UPLINK_HOST_SIZE            {64};
+constexpr auto UPLINK_HEAD_SIZE            {UPLINK_TOKEN_SIZE + UPLINK_HOST_SIZE + UPLINK_PATH_SIZE + 192};
+constexpr auto UPLINK_LINE_SIZE            {96};
+constexpr auto UPLINK_PORT                 {443};
+constexpr auto UPLINK_CONNECT_TIMEOUT_MS   {2000};      // TCP connection, then TLS handshake
+constexpr auto UPLINK_RECONNECT_PERIOD_MS  {5000};
+constexpr auto UPLINK_RESPONSE_TIMEOUT_MS  {10 * 1000};
+constexpr auto UPLINK_STATUS_FAILED        {-1};        // No HTTP response
+
+/**
+ * @brief Called by RtdbUplink::poll() when a request is done.
+ *
+ * @param context The context given to RtdbUplink::submit() or RtdbUplink::fetch().
+ * @param status The HTTP status, or UPLINK_STATUS_FAILED.
+ * @param rttMs The time between the last send of the request and its response.
+ * @param response The body of a fetch response, NUL terminated, or nullptr for a write.
+ */
+typedef void (*uplink_done_fn)(void *context, int status, uint32_t rttMs, const char *response);
+
+typedef struct {
+    std::array<char, UPLINK_PATH_SIZE> path;
+    std::array<char, UPLINK_BODY_SIZE> body;
+    size_t   body_length;
+    void    *context;
+    uint32_t sent_ms;
+    uint8_t  retries;
+    bool     fetch;                                     // GET, the response replaces the body
+} uplink_request_t;
+
+using UplinkRequest = uplink_request_t;
+
+typedef struct {
+    uint32_t requests;
+    uint32_t completed;                                 // 2xx responses
+    uint32_t errors;                                    // Other responses and failures
+    uint32_t timeouts;
+    uint32_t connections;
+    uint32_t rtt_avg_ms;                                // Moving average of the round trip
+    uint32_t in_flight_max;
+} uplink_stats_t;
+
+using UplinkStats = uplink_stats_t;
+
+/**
+ * @brief The RtdbUplink class writes records to the Realtime Database REST API over
+ *        one persistent TLS connection.
+ *
+ * Requests are pipelined: up to UPLINK_MAX_IN_FLIGHT are sent before the first
+ * response, and the responses, which come back in order, complete them through
+ * a callback. Nothing blocks on the server, except the TLS handshake of a new
+ * connection. Requests are PUTs to deterministic keys, or GETs, so the ones
+ * still waiting for a response when the connection drops are simply sent again
+ * on the next connection.
+ */
+class RtdbUplink {
+ private:
+    enum class Parse { STATUS, HEADERS, BODY };
+
+    WiFiClientSecure client;
+    uplink_done_fn done;
+
+    std::array<char, UPLINK_HOST_SIZE>  host {};
+    std::array<char, UPLINK_TOKEN_SIZE> token {};
+    std::array<char, UPLINK_HEAD_SIZE>  head {};
+
+    // FIFO of requests, the first in_flight ones have been sent
+    std::array<UplinkRequest, UPLINK_MAX_PENDING> requests {};
+    size_t first {0};
+    size_t count {0};
+    size_t in_flight {0};
+    uint32_t last_connect {0};
+
+    // Response parser
+    Parse parse {Parse::STATUS};
+    std::array<char, UPLINK_LINE_SIZE> line {};
+    size_t   line_length {0};
+    int      status {0};
+    uint32_t body_left {0};
+    bool     close_after {false};
+
+    UplinkStats stats {};
+
+    bool connect();
+    void disconnect();
+    void fail(size_t attempted);
+    void send();
+    void receive();
+    void parseLine();
+    void responseDone();
+    void complete(int httpStatus);
+
+ public:
+    explicit RtdbUplink(uplink_done_fn doneFn) : done(doneFn) {}
+
+    void begin(const char *databaseUrl);
+    void setToken(const char *idToken);
+    char *nextBody();
+    bool submit(const char *path, size_t length, void *context);
+    bool fetch(const char *path, void *context);
+    void poll(bool authorized);
+
+    size_t room() const { return UPLINK_MAX_PENDING - count; }
+    bool   idle() const { return count == 0; }
+    const UplinkStats &statistics() const { return stats; }
+};
+
+#endif  // INCLUDE_RTDB_UPLINK_H_
@@ -0,0 +1,150 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// static_pool.h - Fixed-size object pool used for the per-packet objects.
+
+#ifndef INCLUDE_STATIC_POOL_H_
+#define INCLUDE_STATIC_POOL_H_
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <Arduino.h>
+
+/**
+ * @brief The StaticPool class hands out objects from storage reserved at boot.
+ *
+ * Objects are acquired and released in O(1) from a free list, so per-packet objects
+ * never touch the heap and cannot fragment it. The pool can be shared between tasks:
+ * the free list is protected by a spinlock. Each object has an in-use flag, so
+ * releasing an object twice, or one that does not come from the pool, trips an
+ * assertion instead of corrupting the free list.
+ *
+ * @tparam T The type of the pooled objects.
+ * @tparam N The number of objects in the pool.
+ */
+template <typename T, size_t N>
+class StaticPool {
+ private:
+    std::array<T, N>   storage {};
+    std::array<T *, N> free_list {};
+    std::array<bool, N> in_use {};
+
+    size_t   free_count {N};
+    size_t   min_free {N};
+    uint32_t failures {0};
+    uint32_t bad_releases {0};
+
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+    /**
+     * @brief Return the index of an object in the storage, or N if it does not
+     *        point to the start of one of the pooled objects.
+     */
+    size_t indexOf(const T *item) const {
+        uintptr_t first  = reinterpret_cast<uintptr_t>(storage.data());
+        uintptr_t offset = reinterpret_cast<uintptr_t>(item) - first;
+
+        if (reinterpret_cast<uintptr_t>(item) < first || offset % sizeof(T) != 0 ||
+            offset / sizeof(T) >= N) {
+            return N;
+        }
+
+        return offset / sizeof(T);
+    }
+
+ public:
+    StaticPool() {
+        for (size_t i = 0; i < N; ++i) {
+            free_list[i] = &storage[i];
+        }
+    }
+
+    StaticPool(const StaticPool &) = delete;
+    StaticPool &operator=(const StaticPool &) = delete;
+
+    /**
+     * @brief Take an object from the pool.
+     *
+     * @return The object, or nullptr if the pool is exhausted.
+     */
+    T *acquire() {
+        T *item = nullptr;
+
+        portENTER_CRITICAL(&lock);
+        if (free_count > 0) {
+            item = free_list[--free_count];
+            in_use[indexOf(item)] = true;
+            min_free = std::min(min_free, free_count);
+        } else {
+            ++failures;
+        }
+        portEXIT_CRITICAL(&lock);
+
+        return item;
+    }
+
+    /**
+     * @brief Return an object to the pool.
+     *
+     * A double release or a foreign pointer asserts. When assertions are
+     * disabled, the release is ignored and counted instead.
+     *
+     * @param item The object, which must come from this pool. nullptr is ignored.
+     */
+    void release(T *item) {
+        if (item == nullptr) {
+            return;
+        }
+
+        size_t index = indexOf(item);
+        bool   valid {false};
+
+        portENTER_CRITICAL(&lock);
+        if (index < N && in_use[index]) {
+            in_use[index] = false;
+            free_list[free_count++] = item;
+            valid = true;
+        } else {
+            ++bad_releases;
+        }
+        portEXIT_CRITICAL(&lock);
+
+        assert(valid && "StaticPool: double release or foreign object");
+        (void)valid;
+    }
+
+    size_t available() const { return free_count; }
+    size_t lowWater() const { return min_free; }
+    uint32_t failureCount() const { return failures; }
+    uint32_t badReleaseCount() const { return bad_releases; }
+    static constexpr size_t capacity() { return N; }
+};
+
+#endif  // INCLUDE_STATIC_POOL_H_
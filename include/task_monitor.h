@@ -0,0 +1,65 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// task_monitor.h - Header file containing the interface for the task runtime report.
+
+#ifndef INCLUDE_TASK_MONITOR_H_
+#define INCLUDE_TASK_MONITOR_H_
+
+#include <array>
+#include <Arduino.h>
+
+constexpr auto TASK_MONITOR_MAX_TASKS  {32};
+constexpr auto TASK_STACK_WARN_BYTES   {512};   // Warn below this stack headroom
+
+typedef struct {
+    TaskHandle_t handle;
+    uint32_t     run_time;
+} task_monitor_sample_t;
+
+/**
+ * @brief The TaskMonitor class prints a periodic report of the FreeRTOS tasks: CPU
+ *        usage over the last period, core affinity and stack high-water mark.
+ *
+ * CPU usage needs configGENERATE_RUN_TIME_STATS, it is reported as n/a otherwise.
+ */
+class TaskMonitor {
+ private:
+    std::array<TaskStatus_t, TASK_MONITOR_MAX_TASKS> status {};
+    std::array<task_monitor_sample_t, TASK_MONITOR_MAX_TASKS> previous {};
+
+    UBaseType_t previous_count {0};
+    uint32_t    previous_total {0};
+
+    uint32_t previousRunTime(TaskHandle_t handle) const;
+
+ public:
+    void report();
+};
+
+#endif  // INCLUDE_TASK_MONITOR_H_
@@ -0,0 +1,12 @@
+# Host builds with sanitizers: env:fuzz and env:fuzz-libfuzzer.
+#
+# SCons hands the -fsanitize flags of build_flags to the compiler only, the
+# linker needs them too. With custom_host_compiler = clang, the program is
+# built with clang, which has libFuzzer.
+
+Import("env")
+
+if env.GetProjectOption("custom_host_compiler", "") == "clang":
+    env.Replace(CC="clang", CXX="clang++", LINK="clang++")
+
+env.Append(LINKFLAGS=[flag for flag in env.get("CCFLAGS", []) if str(flag).startswith("-fsanitize")])
@@ -0,0 +1,257 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// capture.cpp - Implementation of the RF capture and replay.
+//
+// A capture is a LittleFS file: the CAPTURE_MAGIC header, then one record per
+// frame received, see capture_format.h. It keeps the frames exactly as the
+// radio delivered them, along with their RSSI, SNR and timing, so a replay
+// through the receive pipeline is repeatable from one firmware to the next.
+// The capture can be copied to a host with the dump command.
+
+#include <algorithm>
+#include <cstring>
+#include <LittleFS.h>
+#include "capture.h"            // NOLINT
+
+/**
+ * @brief Mount the file system, formatting it on first use.
+ *
+ * @return true if the file system is mounted.
+ */
+bool FrameCapture::mount() {
+    static bool mounted {false};
+
+    if (!mounted) {
+        mounted = LittleFS.begin(true);
+
+        if (!mounted) {
+            Serial.println("Capture: cannot mount LittleFS");
+        }
+    }
+
+    return mounted;
+}
+
+/**
+ * @brief Start recording to a new capture, replacing the previous one.
+ *
+ * @return true if the capture was started.
+ */
+bool FrameCapture::start() {
+    if (recording || !mount()) {
+        return false;
+    }
+
+    if (stream == nullptr) {
+        stream = xStreamBufferCreateStatic(CAPTURE_BUFFER_SIZE, 1, stream_storage.data(), &stream_struct);
+    } else {
+        xStreamBufferReset(stream);
+    }
+
+    file = LittleFS.open(CAPTURE_PATH, FILE_WRITE);
+
+    if (!file) {
+        Serial.println("Capture: cannot create the file");
+        return false;
+    }
+
+    file.write(reinterpret_cast<const uint8_t *>(CAPTURE_MAGIC), CAPTURE_MAGIC_SIZE);
+
+    written   = CAPTURE_MAGIC_SIZE;
+    frames    = 0;
+    dropped   = 0;
+    last_us   = 0;
+    recording = true;
+
+    return true;
+}
+
+/**
+ * @brief Stop recording and close the capture.
+ */
+void FrameCapture::stop() {
+    if (!recording) {
+        return;
+    }
+
+    recording = false;
+    drain();
+    file.close();
+    printStatus();
+}
+
+/**
+ * @brief Record a frame received by the radio.
+ *
+ * Runs in the radio task. Only copies the record into the stream buffer.
+ *
+ * @param frame The frame, as received.
+ * @param size The size of the frame.
+ * @param rssi The RSSI of the frame.
+ * @param snr The SNR of the frame.
+ * @param capturedUs The capture time of the frame, see wall_clock.h.
+ */
+void FrameCapture::record(const uint8_t *frame, size_t size, int16_t rssi, int8_t snr,
+                          int64_t capturedUs) {
+    if (!recording) {
+        return;
+    }
+
+    CaptureHeader header;
+    size = std::min<size_t>(size, CAPTURE_MAX_FRAME);
+
+    captureEncodeHeader(static_cast<uint8_t>(size), rssi, snr, captureDelta(last_us, capturedUs), &header);
+    last_us = capturedUs;
+
+    if (xStreamBufferSpacesAvailable(stream) < CAPTURE_HEADER_SIZE + size) {
+        ++dropped;
+        return;
+    }
+
+    // Only the radio task sends, so the header and the frame stay together.
+    xStreamBufferSend(stream, header.data(), header.size(), 0);
+    xStreamBufferSend(stream, frame, size, 0);
+    ++frames;
+}
+
+/**
+ * @brief Write the recorded frames to the capture file.
+ *
+ * Runs in the loop task. The recording stops when the capture reaches
+ * CAPTURE_MAX_BYTES.
+ */
+void FrameCapture::drain() {
+    if (stream == nullptr || !file) {
+        return;
+    }
+
+    std::array<uint8_t, 256> chunk;
+    size_t length {0};
+
+    while ((length = xStreamBufferReceive(stream, chunk.data(), chunk.size(), 0)) > 0) {
+        written += file.write(chunk.data(), length);
+    }
+
+    if (recording && written >= CAPTURE_MAX_BYTES) {
+        Serial.println("Capture: full");
+        stop();
+    }
+}
+
+/**
+ * @brief Print the capture file on the serial console, in hexadecimal.
+ *
+ * The file is framed by "capture begin <size>" and "capture end" lines, and
+ * each line in between holds 32 bytes, prefixed with "CAP ".
+ */
+void FrameCapture::dump() {
+    if (recording || !mount()) {
+        return;
+    }
+
+    File input = LittleFS.open(CAPTURE_PATH, FILE_READ);
+
+    if (!input) {
+        Serial.println("Capture: no capture");
+        return;
+    }
+
+    std::array<uint8_t, 32> chunk;
+    size_t length {0};
+
+    Serial.printf("capture begin %u\n", static_cast<unsigned>(input.size()));
+
+    while ((length = input.read(chunk.data(), chunk.size())) > 0) {
+        Serial.print("CAP ");
+        for (size_t i = 0; i < length; ++i) {
+            Serial.printf("%02x", chunk[i]);
+        }
+        Serial.println();
+    }
+
+    Serial.println("capture end");
+    input.close();
+}
+
+/**
+ * @brief Print the state of the capture on the serial console.
+ */
+void FrameCapture::printStatus() const {
+    Serial.printf("Capture: %s, %u frames, %u dropped, %u bytes\n",
+                  recording ? "recording" : "stopped", frames, dropped, written);
+}
+
+/**
+ * @brief Open the capture for a replay.
+ *
+ * @return true if the capture exists and has the current format.
+ */
+bool FrameCapture::openReplay() {
+    if (recording || !mount()) {
+        return false;
+    }
+
+    std::array<char, CAPTURE_MAGIC_SIZE> magic {};
+
+    file = LittleFS.open(CAPTURE_PATH, FILE_READ);
+
+    if (!file || file.read(reinterpret_cast<uint8_t *>(magic.data()), magic.size()) != magic.size() ||
+        memcmp(magic.data(), CAPTURE_MAGIC, CAPTURE_MAGIC_SIZE) != 0) {
+        Serial.println("Capture: no valid capture");
+        file.close();
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Read the next record of the capture.
+ *
+ * @param record Set to the record.
+ * @return true if a whole record was read, false at the end of the capture.
+ */
+bool FrameCapture::next(CaptureRecord *record) {
+    CaptureHeader header;
+
+    if (file.read(header.data(), header.size()) != header.size()) {
+        return false;
+    }
+
+    captureDecodeHeader(header, record);
+
+    return file.read(record->frame.data(), record->size) == record->size;
+}
+
+/**
+ * @brief Close the capture after a replay.
+ */
+void FrameCapture::closeReplay() {
+    file.close();
+}
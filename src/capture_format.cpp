@@ -0,0 +1,135 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// File description
+// =========================================================
+// capture_format.cpp - Implementation of the on-flash format of the RF captures.
+//
+// The format has no dependency on the board, so the bridge writes and reads
+// the captures with the same code as the host tests and the replay benchmark.
+
+#include <algorithm>
+#include <cstring>
+#include "capture_format.h"     // NOLINT
+
+/**
+ * @brief Return the time between two frames, as stored in a record.
+ *
+ * A relayed frame is stamped with its capture time at the first relay, which
+ * may be earlier than the previous frame: the delta is then 0. A gap longer
+ * than the 32-bit range is stored as the longest one.
+ *
+ * @param lastUs The capture time of the previous frame, or 0 for the first one.
+ * @param capturedUs The capture time of the frame, see wall_clock.h.
+ * @return The delta in microseconds.
+ */
+uint32_t captureDelta(int64_t lastUs, int64_t capturedUs) {
+    if (lastUs == 0 || capturedUs <= lastUs) {
+        return 0;
+    }
+
+    return static_cast<uint32_t>(std::min<int64_t>(capturedUs - lastUs, UINT32_MAX));
+}
+
+/**
+ * @brief Pack the header of a record.
+ *
+ * @param size The size of the frame.
+ * @param rssi The RSSI of the frame.
+ * @param snr The SNR of the frame.
+ * @param deltaUs The time since the previous frame, see captureDelta().
+ * @param header Set to the header.
+ */
+void captureEncodeHeader(uint8_t size, int16_t rssi, int8_t snr, uint32_t deltaUs,
+                         CaptureHeader *header) {
+    (*header)[0] = size;
+    (*header)[1] = static_cast<uint8_t>(rssi);
+    (*header)[2] = static_cast<uint8_t>(static_cast<uint16_t>(rssi) >> 8);
+    (*header)[3] = static_cast<uint8_t>(snr);
+    (*header)[4] = static_cast<uint8_t>(deltaUs);
+    (*header)[5] = static_cast<uint8_t>(deltaUs >> 8);
+    (*header)[6] = static_cast<uint8_t>(deltaUs >> 16);
+    (*header)[7] = static_cast<uint8_t>(deltaUs >> 24);
+}
+
+/**
+ * @brief Unpack the header of a record.
+ *
+ * @param header The header.
+ * @param record Set to the size, RSSI, SNR and delta of the record.
+ */
+void captureDecodeHeader(const CaptureHeader &header, CaptureRecord *record) {
+    record->size     = header[0];
+    record->rssi     = static_cast<int16_t>(header[1] | (header[2] << 8));
+    record->snr      = static_cast<int8_t>(header[3]);
+    record->delta_us = header[4] | (header[5] << 8) | (header[6] << 16) |
+                       (static_cast<uint32_t>(header[7]) << 24);
+}
+
+/**
+ * @brief Start reading a capture.
+ *
+ * @param capture The capture, magic included.
+ * @param length The size of the capture.
+ * @return true if the capture has the current format.
+ */
+bool CaptureReader::begin(const uint8_t *capture, size_t length) {
+    bool valid = length >= CAPTURE_MAGIC_SIZE && memcmp(capture, CAPTURE_MAGIC, CAPTURE_MAGIC_SIZE) == 0;
+
+    data   = capture;
+    size   = length;
+    offset = valid ? CAPTURE_MAGIC_SIZE : length;
+
+    return valid;
+}
+
+/**
+ * @brief Read the next record.
+ *
+ * @param record Set to the record.
+ * @return true if a whole record was read, false at the end of the capture
+ *         or on a truncated record.
+ */
+bool CaptureReader::next(CaptureRecord *record) {
+    CaptureHeader header;
+
+    if (size - offset < CAPTURE_HEADER_SIZE) {
+        return false;
+    }
+
+    std::copy_n(data + offset, CAPTURE_HEADER_SIZE, header.begin());
+    captureDecodeHeader(header, record);
+
+    if (size - offset - CAPTURE_HEADER_SIZE < record->size) {
+        return false;
+    }
+
+    std::copy_n(data + offset + CAPTURE_HEADER_SIZE, record->size, record->frame.begin());
+    offset += CAPTURE_HEADER_SIZE + record->size;
+
+    return true;
+}
@@ -35,9 +35,20 @@
 // refresh the display. The library also provides a simple interface to update
 // the displayed information.
 
+#include <algorithm>
 #include "gui.h"        // NOLINT
 #include "logo.h"       // NOLINT
 
+constexpr auto SCREEN_INFO          {0};
+constexpr auto SCREEN_STATS         {1};
+constexpr auto SCREEN_HISTORY       {2};                // First history page
+
+constexpr auto HISTORY_GRAPH_X      {(DISPLAY_WIDTH - HISTORY_COLUMNS) / 2};
+constexpr auto HISTORY_GRAPH_TOP    {15};
+constexpr auto HISTORY_GRAPH_BOTTOM {DISPLAY_HEIGHT - 2};
+constexpr auto HISTORY_GRAPH_HEIGHT {HISTORY_GRAPH_BOTTOM - HISTORY_GRAPH_TOP};
+
+constexpr auto GUI_LINE_SIZE        {48};               // Longest line of text, terminator included
 
 /**
  * @brief Constructs an OledGui object.
@@ -65,7 +76,7 @@ void OledGui::init() {
  *
  * @param header The header text to display.
  */
-void OledGui::screenHeader(String header) {
+void OledGui::screenHeader(const char *header) {
     display->clear();
     display->setTextAlignment(TEXT_ALIGN_CENTER);
     display->setFont(ArialMT_Plain_10);
@@ -77,12 +88,17 @@ void OledGui::screenHeader(String header) {
 
 /**
  * @brief Show the info screen, displaying the water level as a string and a progress bar.
+ *
+ * The text lines of the screens are formatted into a fixed buffer, so
+ * rendering does not build heap strings.
  */
 void OledGui::showInfoScreen() {
+    char line[GUI_LINE_SIZE];
+
     screenHeader("Info");
 
-    String waterLevelStr = "Water level: " + String(data->info.water_level) + " %";
-    display->drawString(0, 20, waterLevelStr);
+    snprintf(line, sizeof(line), "Water level: %u %%", data->info.water_level);
+    display->drawString(0, 20, line);
 
     display->drawProgressBar(4, 40, 120, 10, data->info.water_level);
     display->display();
@@ -90,20 +106,62 @@ void OledGui::showInfoScreen() {
 
 
 /**
- * @brief Show the stats screen, displaying the received packet ID, RSSI, and error count.
+ * @brief Show the stats screen, displaying the received packet ID, RSSI, SNR, link margin
+ *        and error count.
  */
 void OledGui::showStatsScreen() {
+    char line[GUI_LINE_SIZE];
+
     screenHeader("Stats");
 
-    String packetIdStr = "Received Packet ID: " + String(data->stats.received_packet_id);
-    String rssiStr = "RSSI: " + String(data->stats.rssi);
-    String rxErrorsStr = "Rx Errors: " + String(data->stats.receive_error_count);
-    String sensorErrorsStr = "Sensor Errors: " + String(data->stats.sensor_error_count);
+    snprintf(line, sizeof(line), "Received Packet ID: %u", data->stats.received_packet_id);
+    display->drawString(0, 20, line);
+    snprintf(line, sizeof(line), "RSSI: %d  SNR: %d", data->stats.rssi, data->stats.snr);
+    display->drawString(0, 30, line);
+    snprintf(line, sizeof(line), "Link margin: %.1f dB", data->stats.link_margin / 10.0F);
+    display->drawString(0, 40, line);
+    snprintf(line, sizeof(line), "Errors Rx: %u  Sensor: %u",
+             data->stats.receive_error_count, data->stats.sensor_error_count);
+    display->drawString(0, 50, line);
+    display->display();
+}
+
+/**
+ * @brief Show the history screen, displaying the water level of one sensor over the last 24 h.
+ *
+ * Each column of the history is drawn as a vertical bar from its minimum to
+ * its maximum level, so the rendering is a single pass over the columns.
+ * Columns without readings are left blank.
+ */
+void OledGui::showHistoryScreen() {
+    const oled_gui_history_t &history = data->history;
+
+    if (historyPage() >= history.sensors) {
+        screenHeader("History");
+        display->drawString(0, 20, "No history yet");
+        display->display();
+        return;
+    }
+
+    char header[GUI_LINE_SIZE];
+
+    snprintf(header, sizeof(header), "Level 24 h #%u", history.sensor_id);
+    screenHeader(header);
+
+    for (size_t i = 0; i < history.columns.size(); ++i) {
+        const HistoryColumn &column = history.columns[i];
+
+        if (column.min > column.max) {
+            continue;
+        }
+
+        int16_t top    = HISTORY_GRAPH_BOTTOM - (std::min<uint8_t>(column.max, 100) * HISTORY_GRAPH_HEIGHT) / 100;
+        int16_t bottom = HISTORY_GRAPH_BOTTOM - (std::min<uint8_t>(column.min, 100) * HISTORY_GRAPH_HEIGHT) / 100;
 
-    display->drawString(0, 20, packetIdStr);
-    display->drawString(0, 30, rssiStr);
-    display->drawString(0, 40, rxErrorsStr);
-    display->drawString(0, 50, sensorErrorsStr);
+        display->drawVerticalLine(HISTORY_GRAPH_X + i, top, bottom - top + 1);
+    }
+
+    display->drawHorizontalLine(HISTORY_GRAPH_X, DISPLAY_HEIGHT - 1, HISTORY_COLUMNS);
     display->display();
 }
 
@@ -181,31 +239,42 @@ void OledGui::splashScreen() {
 /**
  * @brief Refresh the current screen.
  *
- * This function is a wrapper around the two show screens functions. It
+ * This function is a wrapper around the show screens functions. It
  * refreshes the current screen by calling the relevant show screen
  * function.
  */
 void OledGui::refresh() {
-    if (current_screen == 0) {
+    if (current_screen == SCREEN_INFO) {
         showInfoScreen();
-    } else if (current_screen == 1) {
+    } else if (current_screen == SCREEN_STATS) {
         showStatsScreen();
+    } else {
+        showHistoryScreen();
     }
 }
 
 /**
  * @brief Switch to the next screen.
  *
- * This function switches the current screen from the Info screen to the Stats
- * screen and vice versa. It calls the refresh() function to update the
- * display.
+ * The screens cycle from the Info screen to the Stats screen, then through
+ * one History page per sensor, and back to the Info screen. The display is
+ * not updated: the caller fills the history of the new page, if any, and
+ * calls refresh().
  */
 void OledGui::nextScreen() {
-    if (current_screen == 0) {
-        current_screen = 1;
-    } else if (current_screen == 1) {
-        current_screen = 0;
+    if (current_screen + 1 < SCREEN_HISTORY + std::max<uint8_t>(data->history.sensors, 1)) {
+        ++current_screen;
+    } else {
+        current_screen = SCREEN_INFO;
     }
+}
 
-    refresh();
+/**
+ * @brief Return the index of the sensor shown on the current screen.
+ *
+ * @return The index among the sensors with a history, or -1 if the current
+ *         screen is not a History page.
+ */
+int OledGui::historyPage() const {
+    return (current_screen >= SCREEN_HISTORY) ? current_screen - SCREEN_HISTORY : -1;
 }
@@ -0,0 +1,70 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// heap_monitor.cpp - Implementation of the heap budget instrumentation.
+//
+// The internal 8-bit capable heap is the one used by String, FirebaseJson and
+// the TLS buffers. Comparing its free size with its largest free block gives
+// a fragmentation estimate: after days of uptime, a heap with plenty of free
+// memory but no large block left is the one that makes TLS handshakes fail.
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include "heap_monitor.h"       // NOLINT
+
+/**
+ * @brief Take a snapshot of the heap usage.
+ *
+ * @return The current heap statistics.
+ */
+HeapStats readHeapStats() {
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+
+    HeapStats stats;
+    stats.free_size          = info.total_free_bytes;
+    stats.largest_free_block = info.largest_free_block;
+    stats.min_free_size      = info.minimum_free_bytes;
+    stats.allocated_blocks   = info.allocated_blocks;
+    stats.fragmentation      = (stats.free_size > 0)
+                               ? 100 - ((stats.largest_free_block * 100) / stats.free_size)
+                               : 0;
+
+    return stats;
+}
+
+/**
+ * @brief Print a heap snapshot on the serial console.
+ *
+ * @param stats The heap statistics to print.
+ */
+void printHeapStats(const HeapStats &stats) {
+    Serial.printf("Heap: free=%u largest=%u min=%u blocks=%u frag=%u %%\n",
+                  stats.free_size, stats.largest_free_block, stats.min_free_size,
+                  stats.allocated_blocks, stats.fragmentation);
+}
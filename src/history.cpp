@@ -0,0 +1,151 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// history.cpp - Implementation of the level history.
+//
+// The column of a reading is its capture time divided by HISTORY_COLUMN_US,
+// see wall_clock.h. Each column keeps the minimum and maximum level seen
+// during its 12 minutes, so the sparkline shows the spread of the level as
+// well as its trend without storing every reading.
+
+#include <algorithm>
+#include "history.h"            // NOLINT
+
+/**
+ * @brief Find the series of a sensor, or take one for it.
+ *
+ * @param source The sensor, see payloadSource().
+ * @return The series of the sensor.
+ */
+LevelSeries *LevelHistory::find(uint64_t source) {
+    LevelSeries *slot {nullptr};
+
+    for (auto &entry : series) {
+        if (entry.used && entry.source == source) {
+            return &entry;
+        }
+
+        // The first unused series, or else the one updated least recently
+        if (slot == nullptr || (slot->used && (!entry.used || entry.newest < slot->newest))) {
+            slot = &entry;
+        }
+    }
+
+    slot->used   = true;
+    slot->source = source;
+    slot->newest = 0;
+    slot->ring.fill(HISTORY_COLUMN_EMPTY);
+
+    return slot;
+}
+
+/**
+ * @brief Fold a reading into the history of its sensor.
+ *
+ * Moving to a new column empties the columns skipped since the last reading.
+ * A reading older than the newest column, such as a relayed one, goes to its
+ * own column if that column is still within the history. A reading captured
+ * before boot, which only a relayed reading can be, has no column and is
+ * ignored.
+ *
+ * @param source The sensor, see payloadSource().
+ * @param level The water level in percent.
+ * @param capturedUs The capture time of the reading, see wall_clock.h.
+ */
+void LevelHistory::update(uint64_t source, uint8_t level, int64_t capturedUs) {
+    if (capturedUs < 0) {
+        return;
+    }
+
+    LevelSeries *entry = find(source);
+    int64_t column = capturedUs / HISTORY_COLUMN_US;
+
+    if (column > entry->newest) {
+        int64_t skipped = std::min<int64_t>(column - entry->newest, HISTORY_COLUMNS);
+
+        for (int64_t i = column - skipped + 1; i <= column; ++i) {
+            entry->ring[i % HISTORY_COLUMNS] = HISTORY_COLUMN_EMPTY;
+        }
+
+        entry->newest = column;
+    } else if (entry->newest - column >= HISTORY_COLUMNS) {
+        return;
+    }
+
+    HistoryColumn &slot = entry->ring[column % HISTORY_COLUMNS];
+
+    slot.min = std::min(slot.min, level);
+    slot.max = std::max(slot.max, level);
+}
+
+/**
+ * @brief Return the number of sensors with a history.
+ */
+uint8_t LevelHistory::count() const {
+    uint8_t used {0};
+
+    for (const auto &entry : series) {
+        used += entry.used ? 1 : 0;
+    }
+
+    return used;
+}
+
+/**
+ * @brief Copy the history of a sensor, oldest column first, ending at the current column.
+ *
+ * @param page The index of the sensor among the sensors with a history.
+ * @param nowUs The current time, see wall_clock.h.
+ * @param source Set to the sensor, see payloadSource().
+ * @param columns Set to the columns.
+ * @return true if the sensor exists.
+ */
+bool LevelHistory::copy(uint8_t page, int64_t nowUs, uint64_t *source,
+                        HistoryColumns *columns) const {
+    for (const auto &entry : series) {
+        if (!entry.used || page-- > 0) {
+            continue;
+        }
+
+        int64_t first = nowUs / HISTORY_COLUMN_US - (HISTORY_COLUMNS - 1);
+
+        for (size_t i = 0; i < HISTORY_COLUMNS; ++i) {
+            int64_t column = first + static_cast<int64_t>(i);
+
+            bool inRing = column >= 0 && column <= entry.newest &&
+                          entry.newest - column < HISTORY_COLUMNS;
+
+            (*columns)[i] = inRing ? entry.ring[column % HISTORY_COLUMNS] : HISTORY_COLUMN_EMPTY;
+        }
+
+        *source = entry.source;
+        return true;
+    }
+
+    return false;
+}
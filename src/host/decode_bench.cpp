@@ -0,0 +1,221 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// decode_bench.cpp - Host benchmark of the receive path over mixed-type traffic.
+//
+// Run with: pio run -e decode-bench -t exec
+//
+// The frames mix legacy water level frames, enveloped water level frames and
+// air frames, in the proportions given on each line. Each frame is length
+// checked, split, looked up in the payload registry, decoded and serialized
+// to JSON, as in the radio and uplink tasks. Two more lines time the bare
+// pb_decode(LoraPayload_fields) of a legacy frame and the rejection of
+// oversized frames.
+//
+// Cycles are read from the time stamp counter on x86 hosts, which counts at
+// the nominal frequency of the CPU.
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <pb_decode.h>
+#include <pb_encode.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "json_writer.h"        // NOLINT
+#include "payload_registry.h"   // NOLINT
+
+constexpr uint32_t BENCH_FRAMES  {2000000};
+constexpr auto     BENCH_KINDS   {3};
+constexpr auto     BENCH_OVERSIZE {64};         // Bytes
+
+typedef struct {
+    uint8_t size;
+    std::array<uint8_t, BENCH_OVERSIZE> bytes;
+} bench_frame_t;
+
+using BenchFrame = bench_frame_t;
+
+typedef struct {
+    const char *name;
+    uint8_t     legacy;                         // Out of 4 frames
+    uint8_t     water_level;
+    uint8_t     air;
+} bench_mix_t;
+
+static const bench_mix_t MIXES[] = {
+    {"legacy water level", 4, 0, 0},
+    {"water level",        0, 4, 0},
+    {"air",                0, 0, 4},
+    {"mixed",              1, 2, 1},
+};
+
+/**
+ * @brief The BenchClock class times a run in wall time and in cycles.
+ */
+class BenchClock {
+ private:
+    std::chrono::steady_clock::time_point start {std::chrono::steady_clock::now()};
+    uint64_t start_cycles {cycles()};
+
+    static uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+
+ public:
+    void report(const char *name, uint32_t accepted) const {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        double frameCycles = static_cast<double>(cycles() - start_cycles) / BENCH_FRAMES;
+
+        printf("%-20s %7u/%u frames, %9.0f frames/s, %6.1f ns/frame, %6.0f cycles/frame\n",
+               name, accepted, BENCH_FRAMES, BENCH_FRAMES / elapsed.count(),
+               elapsed.count() * 1e9 / BENCH_FRAMES, frameCycles);
+    }
+};
+
+static BenchFrame encode(bool legacy, PayloadTypeId typeId, const void *message) {
+    BenchFrame frame {};
+    size_t offset = legacy ? 0 : 1;
+
+    frame.bytes[0] = static_cast<uint8_t>(typeId);
+
+    pb_ostream_t stream = pb_ostream_from_buffer(frame.bytes.data() + offset, frame.bytes.size() - offset);
+    pb_encode(&stream, payloadType(static_cast<uint8_t>(typeId))->fields, message);
+    frame.size = static_cast<uint8_t>(stream.bytes_written + offset);
+
+    return frame;
+}
+
+/**
+ * @brief Run a frame through the receive path.
+ *
+ * @return true if the frame was decoded and serialized.
+ */
+static bool receive(const BenchFrame &frame, std::array<char, 256> *text) {
+    if (frame.size > LORA_SENSOR_MAX_PAYLOAD) {
+        return false;
+    }
+
+    const uint8_t *body {nullptr};
+    size_t bodySize {0};
+
+    PayloadTypeId typeId = payloadFrameType(frame.bytes.data(), frame.size, &body, &bodySize);
+    const PayloadType *type = payloadType(static_cast<uint8_t>(typeId));
+    PayloadBody payload {};
+    pb_istream_t stream = pb_istream_from_buffer(body, bodySize);
+
+    if (type == nullptr || !pb_decode(&stream, type->fields, &payload)) {
+        return false;
+    }
+
+    JsonWriter json(text->data(), text->size());
+
+    type->serialize(payload, &json);
+    json.addInt("packet_id", type->header(payload).packet_id);
+
+    return json.finish() > 0;
+}
+
+int main(int /* argc */, char ** /* argv */) {
+    LoraPayload level = LoraPayload_init_zero;
+    AirPayload  air   = AirPayload_init_zero;
+
+    level.id            = 123456;
+    level.distance      = 1234;
+    level.level         = 87;
+    level.has_sensor_id = true;
+    level.sensor_id     = 0x00A1B2C3;
+
+    air.id            = 123456;
+    air.temperature   = -75;
+    air.has_sensor_id = true;
+    air.sensor_id     = 0x00A1B2C3;
+
+    const std::array<BenchFrame, BENCH_KINDS> kinds = {{
+        encode(true, PayloadTypeId::PAYLOAD_TYPE_WATER_LEVEL, &level),
+        encode(false, PayloadTypeId::PAYLOAD_TYPE_WATER_LEVEL, &level),
+        encode(false, PayloadTypeId::PAYLOAD_TYPE_AIR, &air),
+    }};
+
+    std::array<char, 256> text;
+
+    for (const auto &mix : MIXES) {
+        std::array<const BenchFrame *, 4> frames;
+        size_t next {0};
+
+        for (uint8_t i = 0; i < mix.legacy; ++i) {
+            frames[next++] = &kinds[0];
+        }
+        for (uint8_t i = 0; i < mix.water_level; ++i) {
+            frames[next++] = &kinds[1];
+        }
+        for (uint8_t i = 0; i < mix.air; ++i) {
+            frames[next++] = &kinds[2];
+        }
+
+        uint32_t accepted {0};
+        BenchClock clock;
+
+        for (uint32_t i = 0; i < BENCH_FRAMES; ++i) {
+            accepted += receive(*frames[i % frames.size()], &text) ? 1 : 0;
+        }
+
+        clock.report(mix.name, accepted);
+    }
+
+    uint32_t accepted {0};
+    BenchClock decodeClock;
+
+    for (uint32_t i = 0; i < BENCH_FRAMES; ++i) {
+        LoraPayload decoded = LoraPayload_init_zero;
+        pb_istream_t stream = pb_istream_from_buffer(kinds[0].bytes.data(), kinds[0].size);
+
+        accepted += pb_decode(&stream, LoraPayload_fields, &decoded) ? 1 : 0;
+    }
+
+    decodeClock.report("pb_decode only", accepted);
+
+    BenchFrame oversized = kinds[1];
+    oversized.size = BENCH_OVERSIZE;
+    accepted = 0;
+
+    BenchClock oversizeClock;
+
+    for (uint32_t i = 0; i < BENCH_FRAMES; ++i) {
+        accepted += receive(oversized, &text) ? 1 : 0;
+    }
+
+    oversizeClock.report("oversized", accepted);
+
+    return 0;
+}
@@ -0,0 +1,258 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// decode_fuzzer.cpp - Fuzz harness of the frame decoding.
+//
+// Run with: pio run -e fuzz -t exec
+//       or: pio run -e fuzz-libfuzzer -t exec (clang, libFuzzer)
+//
+// Each input goes through ReceivePipeline::receive(), the function the radio
+// task calls for a received frame, into an empty pipeline. The harness is
+// built as an upstream bridge, so relay batches are unpacked and their
+// frames go through the pipeline in turn. Each new reading is serialized to
+// its JSON document, as by the uplink task, and packed into a relay batch
+// again, as by a relay.
+//
+// Built without FUZZ_LIBFUZZER, the harness has its own driver: it runs the
+// files given on the command line, or else mutates a few valid frames for
+// FUZZ_RUNS inputs. Both builds use the address and undefined behavior
+// sanitizers.
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <pb_encode.h>
+#include "json_writer.h"        // NOLINT
+#include "payload_registry.h"   // NOLINT
+#include "reading.h"            // NOLINT
+#include "receive_pipeline.h"   // NOLINT
+#include "relay.h"              // NOLINT
+#include "rtdb_uplink.h"        // NOLINT
+
+static_assert(LORA_RELAY_BATCHES, "The harness unpacks relay batches, build it with BRIDGE_RELAY_UPSTREAM");
+
+constexpr int64_t FUZZ_CAPTURED_US {INT64_C(3600) * 1000000};
+
+static void onReading(const ReceivedReading &received);
+
+static ReceivePipeline pipeline({nullptr, onReading}, nullptr);
+static RelayAggregator relay;
+static SensorReading   reading;
+
+/**
+ * @brief Serialize a new reading, then forward its frame as a relay would.
+ */
+static void onReading(const ReceivedReading &received) {
+    std::array<char, UPLINK_BODY_SIZE> text;
+    JsonWriter json(text.data(), text.size());
+
+    pipeline.fillReading(received, &reading);
+    buildReadingJson(reading, &json);
+
+    if (json.finish() == 0) {
+        abort();                                // Any sensor reading must fit
+    }
+
+    relay.add(received.frame, received.size, received.rssi, received.snr, received.hops,
+              received.captured_us);
+
+    std::array<uint8_t, LORA_RELAY_MAX_PAYLOAD> frame;
+
+    if (relay.ready(received.captured_us) &&
+        relay.encode(frame.data(), frame.size(), received.captured_us) == 0) {
+        abort();                                // A full batch must always fit
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    pipeline.reset(7);
+    relay = RelayAggregator();
+
+    pipeline.receive(data, size, -90, 5, FUZZ_CAPTURED_US);
+
+    return 0;
+}
+
+#ifndef FUZZ_LIBFUZZER
+constexpr uint32_t FUZZ_RUNS     {2000000};
+constexpr auto     FUZZ_MAX_SIZE {LORA_RELAY_MAX_PAYLOAD + 16};
+
+typedef struct {
+    size_t size;
+    std::array<uint8_t, FUZZ_MAX_SIZE> bytes;
+} fuzz_input_t;
+
+using FuzzInput = fuzz_input_t;
+
+static uint32_t random_state {0x2545F491};
+
+static uint32_t nextRandom() {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+static void encodeSeed(FuzzInput *seed, PayloadTypeId typeId, const pb_msgdesc_t *fields,
+                       const void *message) {
+    seed->bytes[0] = static_cast<uint8_t>(typeId);
+
+    pb_ostream_t stream = pb_ostream_from_buffer(seed->bytes.data() + 1, seed->bytes.size() - 1);
+    pb_encode(&stream, fields, message);
+    seed->size = 1 + stream.bytes_written;
+}
+
+/**
+ * @brief Build a valid frame of each kind: legacy, water level, air and relay batch.
+ */
+static void buildSeeds(std::array<FuzzInput, 4> *seeds) {
+    LoraPayload level = LoraPayload_init_zero;
+    AirPayload  air   = AirPayload_init_zero;
+
+    level.id            = 1234;
+    level.distance      = 150;
+    level.level         = 60;
+    level.has_sensor_id = true;
+    level.sensor_id     = 0xFFFFFFFF;
+    level.has_boot_id   = true;
+    level.boot_id       = 0xFFFFFFFF;
+
+    air.id            = 1234;
+    air.temperature   = -2000;
+    air.has_sensor_id = true;
+    air.sensor_id     = 7;
+    air.has_boot_id   = true;
+    air.boot_id       = 3;
+
+    FuzzInput &legacy = (*seeds)[0];
+    pb_ostream_t stream = pb_ostream_from_buffer(legacy.bytes.data(), legacy.bytes.size());
+    pb_encode(&stream, LoraPayload_fields, &level);
+    legacy.size = stream.bytes_written;
+
+    encodeSeed(&(*seeds)[1], PayloadTypeId::PAYLOAD_TYPE_WATER_LEVEL, LoraPayload_fields, &level);
+    encodeSeed(&(*seeds)[2], PayloadTypeId::PAYLOAD_TYPE_AIR, AirPayload_fields, &air);
+
+    RelayAggregator packer;
+    packer.begin(99);
+
+    for (size_t i = 0; i < RELAY_MAX_ENTRIES; ++i) {
+        const FuzzInput &frame = (*seeds)[1 + i % 2];
+        packer.add(frame.bytes.data(), frame.size, -100, -5, 0, 0);
+    }
+
+    (*seeds)[3].size = packer.encode((*seeds)[3].bytes.data(), (*seeds)[3].bytes.size(), 0);
+}
+
+static void mutate(FuzzInput *input, const std::array<FuzzInput, 4> &seeds) {
+    uint32_t count = 1 + nextRandom() % 4;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        size_t position = (input->size > 0) ? nextRandom() % input->size : 0;
+
+        switch (nextRandom() % 6) {
+        case 0:                                 // Flip a bit
+            if (input->size > 0) {
+                input->bytes[position] ^= static_cast<uint8_t>(1 << (nextRandom() % 8));
+            }
+        break;
+
+        case 1:                                 // Random byte
+            if (input->size > 0) {
+                input->bytes[position] = static_cast<uint8_t>(nextRandom());
+            }
+        break;
+
+        case 2:                                 // Insert a byte
+            if (input->size < input->bytes.size()) {
+                memmove(&input->bytes[position + 1], &input->bytes[position], input->size - position);
+                input->bytes[position] = static_cast<uint8_t>(nextRandom());
+                ++input->size;
+            }
+        break;
+
+        case 3:                                 // Remove a byte
+            if (input->size > 0) {
+                memmove(&input->bytes[position], &input->bytes[position + 1], input->size - position - 1);
+                --input->size;
+            }
+        break;
+
+        case 4:                                 // Truncate
+            input->size = position;
+        break;
+
+        default: {                              // Splice the tail of a seed
+            const FuzzInput &seed = seeds[nextRandom() % seeds.size()];
+            size_t from = (seed.size > 0) ? nextRandom() % seed.size : 0;
+            size_t length = std::min(seed.size - from, input->bytes.size() - position);
+
+            memcpy(&input->bytes[position], &seed.bytes[from], length);
+            input->size = std::max(input->size, position + length);
+        }
+        break;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) {
+        static std::array<uint8_t, 4096> data;
+
+        for (int i = 1; i < argc; ++i) {
+            FILE *file = fopen(argv[i], "rb");
+
+            if (file == nullptr) {
+                fprintf(stderr, "Cannot open %s\n", argv[i]);
+                return 1;
+            }
+
+            size_t size = fread(data.data(), 1, data.size(), file);
+            fclose(file);
+            LLVMFuzzerTestOneInput(data.data(), size);
+        }
+
+        printf("%d inputs, no failure\n", argc - 1);
+        return 0;
+    }
+
+    std::array<FuzzInput, 4> seeds;
+    buildSeeds(&seeds);
+
+    for (uint32_t run = 0; run < FUZZ_RUNS; ++run) {
+        FuzzInput input = seeds[run % seeds.size()];
+
+        mutate(&input, seeds);
+        LLVMFuzzerTestOneInput(input.bytes.data(), input.size);
+    }
+
+    printf("%u inputs, no failure\n", FUZZ_RUNS);
+    return 0;
+}
+#endif  // FUZZ_LIBFUZZER
@@ -0,0 +1,352 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// File description
+// =========================================================
+// relay_sim.cpp - Host simulation of the relay throughput and added latency.
+//
+// Run with: pio run -e relay-sim -t exec
+//
+// Each relay serves a cell of sensors on the sensor channel and forwards what
+// it hears to a single upstream bridge on the uplink channel, shared by every
+// relay. The relays run the RelayAggregator of the firmware, the upstream
+// bridge decodes the batches. Both channels are pure ALOHA: transmissions
+// that overlap on a channel are lost, and a relay hears nothing from its
+// sensors while it transmits a batch.
+//
+// Each configuration runs twice: with batching, and with one frame per relay
+// frame, sent as soon as the relay is free. The added latency is the time
+// from the end of a sensor frame at the relay to the end of the relay frame
+// at the upstream bridge: the hold time plus the air time of the batch.
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+#include <pb_decode.h>
+#include <pb_encode.h>
+#include "payload_registry.h"   // NOLINT
+#include "relay.h"              // NOLINT
+
+constexpr int64_t  SIM_DURATION_US       {INT64_C(3600) * 1000000};
+constexpr int64_t  SIM_STEP_US           {1000};
+constexpr int64_t  SIM_SENSOR_PERIOD_US  {INT64_C(60) * 1000000};
+constexpr uint32_t SIM_SENSOR_JITTER_US  {2 * 1000000};
+
+// Radio settings of both channels, as in the sf7bw125 profiles.
+constexpr auto     SIM_SPREADING_FACTOR  {7};
+constexpr uint32_t SIM_BANDWIDTH_HZ      {125000};
+constexpr auto     SIM_CODING_RATE       {1};           // 4/5
+constexpr auto     SIM_PREAMBLE_LENGTH   {8};
+
+static const uint32_t RELAY_COUNTS[] {1, 4, 8};
+static const uint32_t CELL_SENSORS[] {10, 50};
+
+enum class SimLoss : uint8_t {
+    NONE = 0,
+    COLLISION,                                          // Another frame on the channel
+    DEAF,                                               // The relay was transmitting
+};
+
+typedef struct {
+    int64_t  start_us;
+    int64_t  end_us;
+    uint16_t sender;                                    // Sensor or relay index
+    SimLoss  loss;
+    uint8_t  size;
+    std::array<uint8_t, LORA_RELAY_MAX_PAYLOAD> bytes;
+} sim_tx_t;
+
+using SimTx = sim_tx_t;
+
+typedef struct {
+    uint32_t sent;
+    uint32_t delivered;
+    uint32_t collisions;                                // On the sensor channel
+    uint32_t deaf;
+    uint32_t full;                                      // Dropped by the aggregator
+    uint32_t uplink_lost;                               // Frames in lost relay frames
+    uint32_t batches;
+    int64_t  latency_total_us;
+    int64_t  latency_max_us;
+    int64_t  uplink_air_us;
+} sim_result_t;
+
+using SimResult = sim_result_t;
+
+/**
+ * @brief The SimChannel class holds the transmissions on air on one channel.
+ */
+class SimChannel {
+ private:
+    std::vector<SimTx> on_air;
+
+ public:
+    void start(SimTx tx) {
+        for (auto &other : on_air) {
+            other.loss = (other.loss == SimLoss::NONE) ? SimLoss::COLLISION : other.loss;
+            tx.loss    = (tx.loss == SimLoss::NONE) ? SimLoss::COLLISION : tx.loss;
+        }
+
+        on_air.push_back(tx);
+    }
+
+    void deafen() {
+        for (auto &tx : on_air) {
+            tx.loss = SimLoss::DEAF;
+        }
+    }
+
+    void finish(int64_t now, const std::function<void(const SimTx &)> &done) {
+        for (size_t i = 0; i < on_air.size();) {
+            if (on_air[i].end_us <= now) {
+                done(on_air[i]);
+                on_air.erase(on_air.begin() + i);
+            } else {
+                ++i;
+            }
+        }
+    }
+};
+
+typedef struct {
+    RelayAggregator aggregator;
+    SimChannel cell;
+    bool     busy;
+    uint32_t pending;
+} sim_relay_t;
+
+using SimRelay = sim_relay_t;
+
+static uint32_t random_state {0x2545F491};
+
+static uint32_t nextRandom() {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+/**
+ * @brief Compute the time on air of a LoRa frame, explicit header and CRC on.
+ *
+ * See the Semtech SX126x datasheet, section 6.1.4. The low data rate
+ * optimization is off at SF7.
+ */
+static int64_t airTimeUs(size_t length) {
+    const int64_t symbolUs = (INT64_C(1) << SIM_SPREADING_FACTOR) * 1000000 / SIM_BANDWIDTH_HZ;
+    const int64_t bits = 8 * static_cast<int64_t>(length) - 4 * SIM_SPREADING_FACTOR + 28 + 16;
+    const int64_t perBlock = 4 * SIM_SPREADING_FACTOR;
+    int64_t payloadSymbols = 8;
+
+    if (bits > 0) {
+        payloadSymbols += ((bits + perBlock - 1) / perBlock) * (SIM_CODING_RATE + 4);
+    }
+
+    return (symbolUs * (4 * SIM_PREAMBLE_LENGTH + 17)) / 4 + symbolUs * payloadSymbols;
+}
+
+/**
+ * @brief Encode the frame of a water level sensor.
+ */
+static SimTx sensorFrame(uint32_t sensorId, uint32_t packetId) {
+    LoraPayload level = LoraPayload_init_zero;
+    SimTx tx {};
+
+    level.id            = packetId;
+    level.distance      = 1234;
+    level.level         = 87;
+    level.has_sensor_id = true;
+    level.sensor_id     = sensorId;
+
+    tx.bytes[0] = static_cast<uint8_t>(PayloadTypeId::PAYLOAD_TYPE_WATER_LEVEL);
+
+    pb_ostream_t stream = pb_ostream_from_buffer(tx.bytes.data() + 1, LORA_SENSOR_MAX_PAYLOAD - 1);
+    pb_encode(&stream, LoraPayload_fields, &level);
+    tx.size = static_cast<uint8_t>(1 + stream.bytes_written);
+
+    return tx;
+}
+
+/**
+ * @brief Account a relay frame received by the upstream bridge.
+ */
+static void uplinkDone(const SimTx &tx, SimResult *result) {
+    RelayBatch batch = RelayBatch_init_zero;
+    pb_istream_t stream = pb_istream_from_buffer(tx.bytes.data() + 1, tx.size - 1);
+
+    if (!pb_decode(&stream, RelayBatch_fields, &batch)) {
+        return;
+    }
+
+    if (tx.loss != SimLoss::NONE) {
+        result->uplink_lost += batch.entries_count;
+        return;
+    }
+
+    for (pb_size_t i = 0; i < batch.entries_count; ++i) {
+        int64_t latencyUs = static_cast<int64_t>(batch.entries[i].age_ms) * 1000 +
+                            (tx.end_us - tx.start_us);
+
+        ++result->delivered;
+        result->latency_total_us += latencyUs;
+        result->latency_max_us    = std::max(result->latency_max_us, latencyUs);
+    }
+}
+
+/**
+ * @brief Run one configuration for SIM_DURATION_US.
+ *
+ * @param relayCount The number of relays.
+ * @param cellSensors The number of sensors heard by each relay.
+ * @param batching true to batch the frames, false to send each one alone.
+ */
+static SimResult run(uint32_t relayCount, uint32_t cellSensors, bool batching) {
+    typedef std::pair<int64_t, uint32_t> due_t;        // Next frame time, sensor
+
+    std::vector<SimRelay> relays(relayCount);
+    std::priority_queue<due_t, std::vector<due_t>, std::greater<due_t>> sensors;
+    std::vector<uint32_t> packetIds(relayCount * cellSensors, 0);
+    std::array<uint8_t, LORA_RELAY_MAX_PAYLOAD> relayFrame;
+    SimChannel uplink;
+    SimResult result {};
+
+    random_state = 0x2545F491;
+
+    for (uint32_t i = 0; i < relayCount; ++i) {
+        relays[i].aggregator.begin(i);
+    }
+
+    for (uint32_t i = 0; i < relayCount * cellSensors; ++i) {
+        sensors.push(due_t(nextRandom() % SIM_SENSOR_PERIOD_US, i));
+    }
+
+    for (int64_t now = 0; now < SIM_DURATION_US; now += SIM_STEP_US) {
+        uplink.finish(now, [&](const SimTx &tx) {
+            relays[tx.sender].busy = false;
+            uplinkDone(tx, &result);
+        });
+
+        for (auto &relay : relays) {
+            relay.cell.finish(now, [&](const SimTx &tx) {
+                if (tx.loss == SimLoss::COLLISION) {
+                    ++result.collisions;
+                } else if (tx.loss == SimLoss::DEAF) {
+                    ++result.deaf;
+                } else if (relay.aggregator.add(tx.bytes.data(), tx.size, -90, 7, 0, tx.end_us)) {
+                    ++relay.pending;
+                } else {
+                    ++result.full;
+                }
+            });
+        }
+
+        while (sensors.top().first <= now) {
+            uint32_t sensor = sensors.top().second;
+            SimRelay &relay = relays[sensor / cellSensors];
+            SimTx tx = sensorFrame(sensor + 1, packetIds[sensor]++);
+
+            sensors.pop();
+            sensors.push(due_t(now + SIM_SENSOR_PERIOD_US - SIM_SENSOR_JITTER_US / 2 +
+                               nextRandom() % SIM_SENSOR_JITTER_US, sensor));
+
+            tx.start_us = now;
+            tx.end_us   = now + airTimeUs(tx.size);
+            tx.sender   = static_cast<uint16_t>(sensor);
+            tx.loss     = relay.busy ? SimLoss::DEAF : SimLoss::NONE;
+
+            relay.cell.start(tx);
+            ++result.sent;
+        }
+
+        for (uint32_t i = 0; i < relayCount; ++i) {
+            SimRelay &relay = relays[i];
+            bool due = batching ? relay.aggregator.ready(now) : relay.pending > 0;
+
+            if (relay.busy || !due) {
+                continue;
+            }
+
+            SimTx tx {};
+            size_t length = relay.aggregator.encode(relayFrame.data(), relayFrame.size(), now);
+
+            relay.pending = 0;
+
+            if (length == 0) {
+                continue;
+            }
+
+            std::copy_n(relayFrame.data(), length, tx.bytes.data());
+            tx.size     = static_cast<uint8_t>(length);
+            tx.start_us = now;
+            tx.end_us   = now + airTimeUs(length);
+            tx.sender   = static_cast<uint16_t>(i);
+
+            relay.busy = true;
+            relay.cell.deafen();
+            uplink.start(tx);
+
+            ++result.batches;
+            result.uplink_air_us += tx.end_us - tx.start_us;
+        }
+    }
+
+    return result;
+}
+
+int main(int /* argc */, char ** /* argv */) {
+    printf("SF%u BW%u, one frame per sensor every %u s, %u s simulated\n\n",
+           SIM_SPREADING_FACTOR, SIM_BANDWIDTH_HZ / 1000,
+           static_cast<uint32_t>(SIM_SENSOR_PERIOD_US / 1000000),
+           static_cast<uint32_t>(SIM_DURATION_US / 1000000));
+
+    for (uint32_t relayCount : RELAY_COUNTS) {
+        for (uint32_t cellSensors : CELL_SENSORS) {
+            for (bool batching : {true, false}) {
+                SimResult result = run(relayCount, cellSensors, batching);
+                double seconds = SIM_DURATION_US / 1e6;
+
+                printf("%-6s relays=%u sensors=%3u offered=%5.2f/s delivered=%5.1f %% (%5.2f/s) "
+                       "lost: collision=%u deaf=%u full=%u uplink=%u, "
+                       "added latency avg=%4.0f ms max=%4.0f ms, uplink busy=%4.1f %%\n",
+                       batching ? "batch" : "single", relayCount, cellSensors,
+                       result.sent / seconds,
+                       result.sent > 0 ? 100.0 * result.delivered / result.sent : 0.0,
+                       result.delivered / seconds,
+                       result.collisions, result.deaf, result.full, result.uplink_lost,
+                       result.delivered > 0 ? result.latency_total_us / 1e3 / result.delivered : 0.0,
+                       result.latency_max_us / 1e3,
+                       100.0 * result.uplink_air_us / SIM_DURATION_US);
+            }
+        }
+    }
+
+    return 0;
+}
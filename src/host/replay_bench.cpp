@@ -0,0 +1,327 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// File description
+// =========================================================
+// replay_bench.cpp - Host benchmark of the receive pipeline over an RF capture.
+//
+// Run with: pio run -e replay-bench -t exec
+//       or: .pio/build/replay-bench/program [--1x] [capture.bin]
+//
+// The host counterpart of the capture replay command of the bridge. Each
+// record of the capture goes through the same ReceivePipeline as a replayed
+// frame, from decoding to the JSON document of the reading, into an empty
+// pipeline before each pass, and the result is the same JSON line, see
+// ReceivePipeline::replayJson().
+//
+// At max speed, the passes repeat up to BENCH_MIN_FRAMES frames. With --1x,
+// the capture is played once with its own timing. The heap allocations made
+// during the replay are counted by a counting allocator.
+//
+// A capture is copied from the bridge with the capture dump command: keep the
+// lines starting with "CAP ", drop that prefix and convert the hexadecimal
+// with xxd -r -p. Without a file, the benchmark builds a capture of water
+// level, air, legacy and relayed frames, with repeated and missed frames.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <vector>
+#include <Arduino.h>
+#include <pb_encode.h>
+#include "capture_format.h"     // NOLINT
+#include "json_writer.h"        // NOLINT
+#include "payload_registry.h"   // NOLINT
+#include "reading.h"            // NOLINT
+#include "receive_pipeline.h"   // NOLINT
+#include "relay.h"              // NOLINT
+#include "wall_clock.h"         // NOLINT
+
+static_assert(LORA_RELAY_BATCHES, "The replay benchmark unpacks relay batches, build it with BRIDGE_RELAY_UPSTREAM");
+
+constexpr uint32_t BENCH_MIN_FRAMES     {1000000};      // Passes repeat up to this count
+constexpr uint32_t BENCH_CAPTURE_FRAMES {2000};         // Records of the built capture
+constexpr uint32_t BENCH_SENSORS        {6};
+constexpr uint32_t BENCH_FRAME_DELTA_US {100000};
+constexpr auto     BENCH_SPREADING_FACTOR {7};
+
+static bool   countAllocations {false};
+static size_t allocations {0};
+
+#ifdef __GLIBC__
+// Every allocation, operator new included, goes through malloc.
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+
+void *malloc(size_t size) noexcept {
+    allocations += countAllocations ? 1 : 0;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) noexcept {
+    allocations += countAllocations ? 1 : 0;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size) noexcept {
+    allocations += countAllocations ? 1 : 0;
+    return __libc_realloc(pointer, size);
+}
+}
+#else
+void *operator new(size_t size) {
+    allocations += countAllocations ? 1 : 0;
+
+    void *pointer = std::malloc(size);
+
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    return pointer;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+    std::free(pointer);
+}
+#endif
+
+static void onReading(const ReceivedReading &received);
+
+static ReceivePipeline pipeline({nullptr, onReading}, nullptr);
+static StageTimer stageTimer;
+static SensorReading reading;
+static std::array<char, 512> body;
+
+/**
+ * @brief Serialize a reading as the uplink task would, then throw it away.
+ */
+static void onReading(const ReceivedReading &received) {
+    JsonWriter json(body.data(), body.size());
+
+    pipeline.fillReading(received, &reading);
+    buildReadingJson(reading, &json);
+    json.finish();
+}
+
+static int64_t steadyClockNs(void) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void appendRecord(std::vector<uint8_t> *capture, const uint8_t *frame, size_t size, int16_t rssi,
+                         int8_t snr) {
+    CaptureHeader header;
+
+    captureEncodeHeader(static_cast<uint8_t>(size), rssi, snr, BENCH_FRAME_DELTA_US, &header);
+    capture->insert(capture->end(), header.begin(), header.end());
+    capture->insert(capture->end(), frame, frame + size);
+}
+
+static size_t encodeFrame(uint32_t sensor, uint32_t packetId, std::array<uint8_t, LORA_MAX_PAYLOAD_LENGTH> *frame) {
+    LoraPayload level = LoraPayload_init_zero;
+    AirPayload  air   = AirPayload_init_zero;
+    bool legacy = sensor == 0;
+    const void *message = &level;
+    PayloadTypeId typeId = PayloadTypeId::PAYLOAD_TYPE_WATER_LEVEL;
+
+    level.id            = packetId;
+    level.distance      = 1000 + packetId % 200;
+    level.level         = 40 + packetId % 20;
+    level.has_sensor_id = !legacy;
+    level.sensor_id     = sensor;
+    level.has_boot_id   = !legacy;
+    level.boot_id       = 0x5EED0000 + sensor;
+
+    if (sensor == 1) {
+        air.id            = packetId;
+        air.temperature   = -50 + static_cast<int32_t>(packetId % 100);
+        air.has_sensor_id = true;
+        air.sensor_id     = sensor;
+        air.has_boot_id   = true;
+        air.boot_id       = 0x5EED0000 + sensor;
+        message = &air;
+        typeId  = PayloadTypeId::PAYLOAD_TYPE_AIR;
+    }
+
+    size_t offset = legacy ? 0 : 1;
+    (*frame)[0] = static_cast<uint8_t>(typeId);
+
+    pb_ostream_t stream = pb_ostream_from_buffer(frame->data() + offset, frame->size() - offset);
+    pb_encode(&stream, payloadType(static_cast<uint8_t>(typeId))->fields, message);
+
+    return offset + stream.bytes_written;
+}
+
+/**
+ * @brief Build a capture: sensor 0 is legacy, sensor 1 sends air frames, the
+ *        last two sensors are heard through a relay. Every tenth frame is
+ *        heard twice, every 25th is lost.
+ */
+static std::vector<uint8_t> buildCapture() {
+    std::vector<uint8_t> capture(CAPTURE_MAGIC, CAPTURE_MAGIC + CAPTURE_MAGIC_SIZE);
+    std::array<uint8_t, LORA_MAX_PAYLOAD_LENGTH> frame;
+    RelayAggregator relay;
+
+    relay.begin(0x00C0FFEE);
+
+    for (uint32_t i = 0; i < BENCH_CAPTURE_FRAMES; ++i) {
+        uint32_t sensor   = i % BENCH_SENSORS;
+        uint32_t packetId = i / BENCH_SENSORS;
+
+        if (i % 25 == 24) {
+            continue;
+        }
+
+        size_t size = encodeFrame(sensor, packetId, &frame);
+
+        if (sensor >= BENCH_SENSORS - 2) {
+            relay.add(frame.data(), size, -118, -9, 0, 0);
+
+            if (relay.ready(0)) {
+                size = relay.encode(frame.data(), frame.size(), 0);
+                appendRecord(&capture, frame.data(), size, -95, 4);
+            }
+            continue;
+        }
+
+        appendRecord(&capture, frame.data(), size, static_cast<int16_t>(-70 - 5 * sensor), 8);
+
+        if (i % 10 == 0) {
+            appendRecord(&capture, frame.data(), size, static_cast<int16_t>(-72 - 5 * sensor), 7);
+        }
+    }
+
+    return capture;
+}
+
+static bool readCapture(const char *path, std::vector<uint8_t> *capture) {
+    FILE *file = fopen(path, "rb");
+
+    if (file == nullptr) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return false;
+    }
+
+    std::array<uint8_t, 4096> chunk;
+    size_t length {0};
+
+    while ((length = fread(chunk.data(), 1, chunk.size(), file)) > 0) {
+        capture->insert(capture->end(), chunk.begin(), chunk.begin() + length);
+    }
+
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    std::vector<uint8_t> capture;
+    bool realTime {false};
+    const char *path {nullptr};
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--1x") == 0) {
+            realTime = true;
+        } else {
+            path = argv[i];
+        }
+    }
+
+    if (path != nullptr) {
+        if (!readCapture(path, &capture)) {
+            return 1;
+        }
+    } else {
+        capture = buildCapture();
+    }
+
+    static CaptureRecord record;
+    static char result[REPLAY_RESULT_SIZE];
+    CaptureReader reader;
+    uint32_t frames {0};
+    uint32_t passes {0};
+
+    if (!reader.begin(capture.data(), capture.size()) || !reader.next(&record)) {
+        fprintf(stderr, "Not a capture, or an empty one\n");
+        return 1;
+    }
+
+    pipeline.setTimer(&stageTimer);
+    stageTimer.enable(steadyClockNs);
+    countAllocations = true;
+
+    int64_t start = steadyClockNs();
+
+    do {
+        reader.begin(capture.data(), capture.size());
+        pipeline.reset(BENCH_SPREADING_FACTOR);
+        ++passes;
+
+        while (reader.next(&record)) {
+            if (realTime) {
+                std::this_thread::sleep_for(std::chrono::microseconds(record.delta_us));
+            }
+
+            // The capture time of the frames follows the capture, as on the bridge.
+            hostMicros() += record.delta_us;
+
+            ++frames;
+            pipeline.receive(record.frame.data(), record.size, record.rssi, record.snr, monotonicUs());
+        }
+    } while (!realTime && frames < BENCH_MIN_FRAMES);
+
+    int64_t elapsedUs = (steadyClockNs() - start) / 1000;
+
+    countAllocations = false;
+    stageTimer.disable();
+
+    ReplayResult replay {realTime, frames, passes, elapsedUs, static_cast<uint32_t>(allocations)};
+
+    if (pipeline.replayJson(replay, result, sizeof(result)) == 0) {
+        fprintf(stderr, "Result too large\n");
+        return 1;
+    }
+
+    puts(result);
+
+    return 0;
+}
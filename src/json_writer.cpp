@@ -0,0 +1,207 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// json_writer.cpp - Implementation of the JSON writer.
+//
+// The records and the bridge status are small flat JSON objects with a few
+// nested server timestamps. They are written straight into the body buffer
+// of an uplink request, instead of going through FirebaseJson and a String
+// on the heap for every packet.
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include "json_writer.h"        // NOLINT
+
+/**
+ * @brief Constructs a JsonWriter object and opens the top level object.
+ *
+ * @param text The buffer receiving the document, NUL terminated.
+ * @param textSize The size of the buffer.
+ */
+JsonWriter::JsonWriter(char *text, size_t textSize) : buffer(text), size(textSize) {
+    overflow = (buffer == nullptr || size == 0);
+    begin();
+}
+
+/**
+ * @brief Append text to the document, keeping room for the terminator.
+ */
+void JsonWriter::append(const char *text, size_t textLength) {
+    if (overflow || length + textLength >= size) {
+        overflow = true;
+        return;
+    }
+
+    memcpy(buffer + length, text, textLength);
+    length += textLength;
+    buffer[length] = '\0';
+}
+
+/**
+ * @brief Append formatted text to the document.
+ */
+void JsonWriter::appendf(const char *format, ...) {
+    if (overflow) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(buffer + length, size - length, format, args);
+    va_end(args);
+
+    if (written < 0 || length + static_cast<size_t>(written) >= size) {
+        overflow = true;
+        return;
+    }
+
+    length += static_cast<size_t>(written);
+}
+
+/**
+ * @brief Append a quoted string, escaping the quotes, backslashes and control characters.
+ */
+void JsonWriter::appendString(const char *text) {
+    append("\"", 1);
+
+    for (const char *c = text; *c != '\0'; ++c) {
+        if (*c == '"' || *c == '\\') {
+            char escaped[2] {'\\', *c};
+            append(escaped, sizeof(escaped));
+        } else if (static_cast<unsigned char>(*c) < 0x20) {
+            appendf("\\u%04x", static_cast<unsigned>(*c));
+        } else {
+            append(c, 1);
+        }
+    }
+
+    append("\"", 1);
+}
+
+/**
+ * @brief Start a member of the current object.
+ *
+ * @param name The name of the member.
+ */
+void JsonWriter::key(const char *name) {
+    if (!empty) {
+        append(",", 1);
+    }
+
+    empty = false;
+    appendString(name);
+    append(":", 1);
+}
+
+/**
+ * @brief Open an object.
+ *
+ * @param name The name of the object in the current one, nullptr for the top level object.
+ */
+void JsonWriter::begin(const char *name) {
+    if (depth >= JSON_WRITER_MAX_DEPTH) {
+        overflow = true;
+        return;
+    }
+
+    if (name != nullptr) {
+        key(name);
+    }
+
+    append("{", 1);
+    ++depth;
+    empty = true;
+}
+
+/**
+ * @brief Close the current object.
+ */
+void JsonWriter::end() {
+    if (depth == 0) {
+        overflow = true;
+        return;
+    }
+
+    append("}", 1);
+    --depth;
+    empty = false;
+}
+
+/**
+ * @brief Add a string member.
+ */
+void JsonWriter::addString(const char *name, const char *value) {
+    key(name);
+    appendString(value);
+}
+
+/**
+ * @brief Add an integer member.
+ */
+void JsonWriter::addInt(const char *name, int64_t value) {
+    key(name);
+    appendf("%lld", static_cast<long long>(value));
+}
+
+/**
+ * @brief Add a decimal member with one digit, such as a value in 0.1 dB.
+ *
+ * @param name The name of the member.
+ * @param tenths The value, in tenths.
+ */
+void JsonWriter::addTenths(const char *name, int32_t tenths) {
+    int64_t magnitude = (tenths < 0) ? -static_cast<int64_t>(tenths) : tenths;
+
+    key(name);
+    appendf("%s%lld.%lld", (tenths < 0) ? "-" : "",
+            static_cast<long long>(magnitude / 10), static_cast<long long>(magnitude % 10));
+}
+
+/**
+ * @brief Add a member the Realtime Database replaces with its own time on write.
+ */
+void JsonWriter::addServerTimestamp(const char *name) {
+    begin(name);
+    addString(".sv", "timestamp");
+    end();
+}
+
+/**
+ * @brief Close the open objects and return the length of the document.
+ *
+ * @return The length of the document, without the terminator, or 0 if it did
+ *         not fit in the buffer.
+ */
+size_t JsonWriter::finish() {
+    while (depth > 0 && !overflow) {
+        end();
+    }
+
+    return overflow ? 0 : length;
+}
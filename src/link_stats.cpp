@@ -0,0 +1,281 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// link_stats.cpp - Implementation of the per-sensor link-quality statistics.
+//
+// RSSI and SNR are folded into an exponentially weighted moving average, a
+// min/max pair and a coarse histogram every time a packet is received. The
+// SNR average is compared against the demodulation floor of the active
+// spreading factor to estimate the remaining link margin.
+
+#include <algorithm>
+#include "link_stats.h"     // NOLINT
+
+// SX126x demodulation floor in 0.1 dB, indexed by SF - 7 (SF7..SF12).
+static constexpr std::array<int16_t, 6> DEMOD_FLOOR_TENTHS = {-75, -100, -125, -150, -175, -200};
+
+/**
+ * @brief Return the histogram bin of a value.
+ *
+ * @param value The value to classify.
+ * @param min The lower edge of the first bin.
+ * @param step The width of a bin.
+ * @return The bin index, clamped to the histogram range.
+ */
+static size_t histBin(int32_t value, int32_t min, int32_t step) {
+    int32_t bin = (value - min) / step;
+
+    return static_cast<size_t>(std::min<int32_t>(std::max<int32_t>(bin, 0), LINK_HIST_BINS - 1));
+}
+
+/**
+ * @brief Convert a sample to Q4.
+ *
+ * Multiplies rather than shifts, since RSSI and SNR samples are negative.
+ *
+ * @param sample The sample.
+ * @return The sample, in Q4.
+ */
+static int32_t toQ4(int32_t sample) {
+    return sample * (1 << LINK_EWMA_SHIFT);
+}
+
+/**
+ * @brief Fold a new sample into a Q4 moving average.
+ *
+ * @param ewma The current average, in Q4.
+ * @param sample The new sample.
+ * @return The updated average, in Q4.
+ */
+static int32_t ewmaUpdate(int32_t ewma, int32_t sample) {
+    return ewma + (toQ4(sample) - ewma) / LINK_EWMA_WEIGHT;
+}
+
+/**
+ * @brief Constructs a LinkStats object.
+ *
+ * @param sf The spreading factor used to compute the link margin.
+ */
+LinkStats::LinkStats(uint8_t sf) {
+    setSpreadingFactor(sf);
+}
+
+/**
+ * @brief Set the spreading factor used to compute the link margin.
+ *
+ * @param sf The spreading factor [SF7..SF12]. Out of range values are clamped.
+ */
+void LinkStats::setSpreadingFactor(uint8_t sf) {
+    spreading_factor = std::min<uint8_t>(std::max<uint8_t>(sf, 7), 12);
+}
+
+/**
+ * @brief Return the table entry of a sensor, claiming one if the sensor is new.
+ *
+ * When the table is full, the least recently updated entry is recycled.
+ *
+ * @param source The sensor source key.
+ * @return The table entry of the sensor.
+ */
+link_stats_t *LinkStats::slot(uint64_t source) {
+    link_stats_t *victim = &table[0];
+
+    for (auto &entry : table) {
+        if (entry.used && entry.source == source) {
+            return &entry;
+        }
+
+        if (!entry.used) {
+            if (victim->used) {
+                victim = &entry;
+            }
+        } else if (victim->used && entry.last_update < victim->last_update) {
+            victim = &entry;
+        }
+    }
+
+    *victim = link_stats_t {};
+    victim->used   = true;
+    victim->source = source;
+
+    return victim;
+}
+
+/**
+ * @brief Record the RSSI and SNR of a received packet.
+ *
+ * @param source The source key of the sensor that sent the packet.
+ * @param rssi The RSSI of the packet, in dBm.
+ * @param snr The SNR of the packet, in dB.
+ * @return The updated statistics of the sensor.
+ */
+const link_stats_t *LinkStats::update(uint64_t source, int16_t rssi, int8_t snr) {
+    link_stats_t *stats = slot(source);
+
+    if (stats->samples == 0) {
+        stats->rssi_ewma = toQ4(rssi);
+        stats->snr_ewma  = toQ4(snr);
+        stats->rssi_min  = rssi;
+        stats->rssi_max  = rssi;
+        stats->snr_min   = snr;
+        stats->snr_max   = snr;
+    } else {
+        stats->rssi_ewma = ewmaUpdate(stats->rssi_ewma, rssi);
+        stats->snr_ewma  = ewmaUpdate(stats->snr_ewma, snr);
+        stats->rssi_min  = std::min(stats->rssi_min, rssi);
+        stats->rssi_max  = std::max(stats->rssi_max, rssi);
+        stats->snr_min   = std::min(stats->snr_min, snr);
+        stats->snr_max   = std::max(stats->snr_max, snr);
+    }
+
+    ++stats->rssi_hist[histBin(rssi, LINK_RSSI_HIST_MIN, LINK_RSSI_HIST_STEP)];
+    ++stats->snr_hist[histBin(snr, LINK_SNR_HIST_MIN, LINK_SNR_HIST_STEP)];
+
+    ++stats->samples;
+    stats->last_update = ++update_count;
+
+    return stats;
+}
+
+/**
+ * @brief Look up the statistics of a sensor.
+ *
+ * @param source The sensor source key.
+ * @return The statistics of the sensor, or nullptr if the sensor was never heard.
+ */
+const link_stats_t *LinkStats::find(uint64_t source) const {
+    for (const auto &entry : table) {
+        if (entry.used && entry.source == source) {
+            return &entry;
+        }
+    }
+
+    return nullptr;
+}
+
+/**
+ * @brief Track the packet sequence of a sensor.
+ *
+ * Must be called after update() for the same packet. A packet ID slightly lower
+ * than the last one is a late frame, for instance one that came through a relay,
+ * and is no longer counted as missed. A packet ID much lower than the last one is
+ * taken as a sensor restart.
+ *
+ * @param source The sensor source key.
+ * @param packetId The ID of the received packet.
+ * @param[out] missed The number of packets lost just before this one.
+ * @return true if the packet is new, false if it repeats the previous packet.
+ */
+bool LinkStats::sequence(uint64_t source, uint32_t packetId, uint32_t *missed) {
+    link_stats_t *stats = slot(source);
+
+    *missed = 0;
+
+    if (stats->has_packet) {
+        if (packetId == stats->last_packet_id) {
+            return false;
+        }
+
+        if (packetId < stats->last_packet_id &&
+            (stats->last_packet_id - packetId) <= LINK_REORDER_WINDOW) {
+            if (stats->missed > 0) {
+                --stats->missed;
+            }
+
+            return true;
+        }
+
+        if (packetId > (stats->last_packet_id + 1)) {
+            *missed = packetId - stats->last_packet_id - 1;
+            stats->missed += *missed;
+        }
+    }
+
+    stats->has_packet     = true;
+    stats->last_packet_id = packetId;
+
+    return true;
+}
+
+/**
+ * @brief Return the RSSI moving average of a sensor, in dBm.
+ */
+int16_t LinkStats::rssiAverage(const link_stats_t &stats) const {
+    return static_cast<int16_t>(stats.rssi_ewma / (1 << LINK_EWMA_SHIFT));
+}
+
+/**
+ * @brief Return the SNR moving average of a sensor, in 0.1 dB.
+ */
+int16_t LinkStats::snrAverageTenths(const link_stats_t &stats) const {
+    return static_cast<int16_t>((stats.snr_ewma * 10) / (1 << LINK_EWMA_SHIFT));
+}
+
+/**
+ * @brief Estimate the link margin of a sensor, in 0.1 dB.
+ *
+ * The margin is the distance between the SNR moving average and the demodulation
+ * floor of the current spreading factor. A negative margin means the sensor is
+ * below the floor and only gets through on favorable packets.
+ */
+int16_t LinkStats::marginTenths(const link_stats_t &stats) const {
+    return snrAverageTenths(stats) - demodFloorTenths(spreading_factor);
+}
+
+/**
+ * @brief Suggest a data rate change for a sensor based on its link margin.
+ *
+ * Each spreading factor step moves the demodulation floor by 2.5 dB, so a sensor
+ * is only advised to go faster when it keeps a comfortable margin after the step.
+ */
+LinkAdvice LinkStats::advice(const link_stats_t &stats) const {
+    if (stats.samples < LINK_ADVICE_MIN_SAMPLES) {
+        return LinkAdvice::LINK_ADVICE_NONE;
+    }
+
+    int16_t margin = marginTenths(stats);
+
+    if (margin < LINK_MARGIN_SLOWER && spreading_factor < 12) {
+        return LinkAdvice::LINK_ADVICE_SLOWER;
+    }
+
+    if (margin > LINK_MARGIN_FASTER && spreading_factor > 7) {
+        return LinkAdvice::LINK_ADVICE_FASTER;
+    }
+
+    return LinkAdvice::LINK_ADVICE_KEEP;
+}
+
+/**
+ * @brief Return the demodulation floor of a spreading factor, in 0.1 dB.
+ *
+ * @param sf The spreading factor [SF7..SF12]. Out of range values are clamped.
+ */
+int16_t LinkStats::demodFloorTenths(uint8_t sf) {
+    return DEMOD_FLOOR_TENTHS[std::min<uint8_t>(std::max<uint8_t>(sf, 7), 12) - 7];
+}
@@ -0,0 +1,419 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// low_power.cpp - Implementation of the low-power receiver.
+//
+// A bridge built with BRIDGE_LOW_POWER does not keep the radio in continuous
+// reception. Each cycle, the radio sleeps, then runs a Channel Activity
+// Detection (CAD). A cycle is shorter than the preamble of the active profile,
+// so a CAD always falls within the preamble of a frame, early enough for the
+// radio to lock on it. Only a detection opens a reception window.
+//
+// The saving grows with the preamble. The 8 symbol preamble of the sensors
+// leaves no room for a CAD cycle at SF7: the radio then stays in reception
+// and only the ESP32 sleeps, woken by DIO1. From SF9, or with a longer sensor
+// preamble, the radio sleeps between the CADs and the ESP32 light sleeps as
+// well.
+//
+// The radio task runs at a high priority, so it never waits by spinning. A
+// CAD long enough is waited for in light sleep, woken by DIO1. The waits
+// shorter than a light sleep block the task in whole ticks, and the CAD
+// result is then polled once per tick, which lets the other tasks of the core
+// run at every cycle.
+//
+// The radio task only holds the radio mutex while it uses the radio, in
+// cycle(): for the CAD, which is noticed within a tick of its end, and for
+// a reception window, which must not see the profile change under it. The
+// wait between two cycles, in idle(), runs without the mutex.
+
+#include <algorithm>
+#include <Arduino.h>
+#include <LoRaWan_APP.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include "low_power.h"          // NOLINT
+#include "wall_clock.h"         // NOLINT
+
+constexpr uint32_t LOW_POWER_TICK_US {portTICK_PERIOD_MS * 1000};
+
+/**
+ * @brief Start the low-power reception.
+ *
+ * @param profile The active radio profile.
+ */
+void CadReceiver::begin(const RadioProfile &profile) {
+    esp_sleep_enable_gpio_wakeup();
+    size(profile);
+    period_start = monotonicUs();
+}
+
+/**
+ * @brief Tell whether a profile differs from the one the cycle is sized for.
+ *
+ * @param profile The radio profile.
+ */
+bool CadReceiver::changed(const RadioProfile &profile) const {
+    return profile.frequency != sized.frequency ||
+           profile.bandwidth != sized.bandwidth ||
+           profile.spreading_factor != sized.spreading_factor ||
+           profile.coding_rate != sized.coding_rate ||
+           profile.preamble_length != sized.preamble_length;
+}
+
+/**
+ * @brief Size the CAD cycle and the reception window for a radio profile.
+ *
+ * A preamble starts at most one cycle before a CAD. The CAD then ends and is
+ * noticed up to a tick later, see sleepFor(), and the reception window has to
+ * open before the last LOW_POWER_LOCK_SYMBOLS of the preamble. The cycle, a
+ * CAD and a tick must therefore fit in the rest of the preamble, and the
+ * cycle is a CAD, a tick and the sleep. When they do not fit, the radio stays
+ * in continuous reception.
+ *
+ * @param profile The radio profile.
+ */
+void CadReceiver::size(const RadioProfile &profile) {
+    sized = profile;
+
+    uint32_t bandwidthHz = 125000U << profile.bandwidth;
+    symbol_us = static_cast<uint32_t>((static_cast<uint64_t>(1) << profile.spreading_factor) *
+                                      1000000U / bandwidthHz);
+
+    uint32_t reachUs {0};
+
+    if (profile.preamble_length > LOW_POWER_LOCK_SYMBOLS) {
+        reachUs = (profile.preamble_length - LOW_POWER_LOCK_SYMBOLS) * symbol_us;
+    }
+
+    uint32_t cadUs  = LOW_POWER_CAD_SYMBOLS * symbol_us;
+    uint32_t busyUs = cadUs + LOW_POWER_TICK_US;
+
+    cad_cycles     = reachUs >= 2 * busyUs;
+    sleep_us       = cad_cycles ? reachUs - 2 * busyUs : 0;
+    light_sleep    = sleep_us >= LOW_POWER_LIGHT_SLEEP_MIN_US + LOW_POWER_WAKE_OVERHEAD_US;
+    sleep_us       = light_sleep ? sleep_us - LOW_POWER_WAKE_OVERHEAD_US : sleep_us;
+    cad_timeout_us = cadUs + symbol_us + LOW_POWER_WAKE_OVERHEAD_US;
+    rx_window_ms   = ((profile.preamble_length + LOW_POWER_RX_WINDOW_SYMBOLS) * symbol_us + 999) / 1000;
+    last_cycle     = monotonicUs();
+
+    // The Rx timeout stops on a valid header, the guard also covers the longest frame.
+    int sf  = profile.spreading_factor;
+    int de  = (sf >= 11 && profile.bandwidth == 0) ? 1 : 0;     // Low data rate optimization
+    int num = 8 * LORA_MAX_PAYLOAD_LENGTH - 4 * sf + 28 + 16;
+    int den = 4 * (sf - 2 * de);
+    uint32_t payloadSymbols = 8 + ((num + den - 1) / den) * (profile.coding_rate + 4);
+
+    rx_guard_us = rx_window_ms * 1000 + payloadSymbols * symbol_us;
+
+    if (cad_cycles) {
+        Serial.printf("Low power: symbol %u us, CAD every %u us at most, Rx window %u ms, %s\n",
+                      symbol_us, sleep_us + busyUs, rx_window_ms,
+                      light_sleep ? "light sleep" : "no light sleep");
+    } else {
+        Serial.printf("Low power: symbol %u us, preamble too short for CAD, continuous reception\n",
+                      symbol_us);
+    }
+}
+
+/**
+ * @brief Wait, in light sleep if the time allows it.
+ *
+ * The light sleep ends with the timer, or with DIO1 when wakeOnDio1 is set.
+ * A wakeup turns the rising edge interrupt of the radio driver into a level
+ * interrupt, so the interrupts of this core stay masked until the edge is
+ * restored. The interrupt latched by the wakeup is then delivered once to the
+ * driver, which attaches it from setup(), on the core of the radio task.
+ *
+ * A wait too short for a light sleep blocks the task instead, see waitDio1().
+ * Without DIO1, it blocks in whole ticks and never longer than asked, so a
+ * wait shorter than a tick only brings the next CAD forward.
+ *
+ * @param us The time to wait in microseconds.
+ * @param wakeOnDio1 true to end the wait on a radio interrupt.
+ */
+void CadReceiver::sleepFor(uint32_t us, bool wakeOnDio1) {
+    if (us < LOW_POWER_LIGHT_SLEEP_MIN_US) {
+        if (wakeOnDio1) {
+            waitDio1(us);
+        } else if (us >= LOW_POWER_TICK_US) {
+            vTaskDelay(us / LOW_POWER_TICK_US);
+        }
+        return;
+    }
+
+    int64_t start = monotonicUs();
+    auto dio1 = static_cast<gpio_num_t>(RADIO_DIO1_IO);
+
+    esp_sleep_enable_timer_wakeup(us);
+
+    if (wakeOnDio1) {
+        portDISABLE_INTERRUPTS();
+        gpio_wakeup_enable(dio1, GPIO_INTR_HIGH_LEVEL);
+        esp_light_sleep_start();
+        gpio_wakeup_disable(dio1);
+        gpio_set_intr_type(dio1, GPIO_INTR_POSEDGE);
+        portENABLE_INTERRUPTS();
+    } else {
+        esp_light_sleep_start();
+    }
+
+    cpu_sleep_us += monotonicUs() - start;
+}
+
+/**
+ * @brief Block the task until DIO1 rises, or until a timeout.
+ *
+ * DIO1 is read once per tick, and the other tasks of the core run in between.
+ * The time is counted as CPU awake, the idle task does not light sleep.
+ *
+ * @param us The timeout in microseconds.
+ */
+void CadReceiver::waitDio1(uint32_t us) {
+    int64_t start = monotonicUs();
+
+    while ((monotonicUs() - start) < us && digitalRead(RADIO_DIO1_IO) == LOW) {
+        vTaskDelay(1);
+    }
+}
+
+/**
+ * @brief Keep the radio in reception, when the preamble is too short for CAD cycles.
+ *
+ * The radio leaves the reception after each frame, see rxDone(), and is put
+ * back in it here. The whole time counts as reception.
+ */
+void CadReceiver::listen() {
+    int64_t now = monotonicUs();
+
+    rx_us     += now - last_cycle;
+    last_cycle = now;
+
+    if (state != State::RX) {
+        state = State::RX;
+        Radio.Rx(0);
+    }
+}
+
+/**
+ * @brief Run one CAD cycle, and the reception window if the CAD found a preamble.
+ *
+ * Runs in the radio task, which holds the radio mutex. The cycle is sized
+ * again whenever the active profile changes. The radio is left asleep for
+ * idle(), except in continuous reception, where this only restarts it.
+ *
+ * @param profile The active radio profile.
+ */
+void CadReceiver::cycle(const RadioProfile &profile) {
+    if (changed(profile)) {
+        size(profile);
+        state        = State::SLEEP;
+        radio_asleep = false;
+    }
+
+    ++stats.cycles;
+
+    if (!cad_cycles) {
+        listen();
+        return;
+    }
+
+    // Applying a profile or sending a batch leaves the radio receiving.
+    if (!radio_asleep) {
+        Radio.Standby();
+    }
+
+    int64_t start = monotonicUs();
+
+    state = State::CAD;
+    Radio.StartCad();
+    sleepFor(cad_timeout_us, true);
+    Radio.IrqProcess();
+
+    if (state == State::CAD) {
+        ++stats.cad_timeouts;
+        state = State::SLEEP;
+    }
+
+    int64_t now = monotonicUs();
+    cad_us += now - start;
+
+    if (state != State::RX) {
+        Radio.Sleep();
+    } else {
+        start = now;
+
+        while (state == State::RX && (monotonicUs() - start) < rx_guard_us) {
+            sleepFor(LOW_POWER_RX_POLL_US, true);
+            Radio.IrqProcess();
+        }
+
+        rx_us += monotonicUs() - start;
+
+        // The end of a reception puts the radio to sleep, the guard does not.
+        if (state == State::RX) {
+            Radio.Sleep();
+            ++stats.false_wakeups;
+            state = State::SLEEP;
+        }
+    }
+
+    radio_asleep = true;
+}
+
+/**
+ * @brief Wait for the next cycle.
+ *
+ * Runs in the radio task, without the radio mutex. Between two CADs, the radio
+ * sleeps and the ESP32 light sleeps when the cycle allows it. In continuous
+ * reception, the ESP32 sleeps until a frame raises DIO1.
+ */
+void CadReceiver::idle() {
+    if (cad_cycles) {
+        sleepFor(sleep_us, false);
+    } else {
+        sleepFor(LOW_POWER_RX_POLL_US, true);
+    }
+}
+
+/**
+ * @brief Called when a CAD is done. Opens a reception window on a detection.
+ *
+ * @param detected true if the CAD found a preamble.
+ */
+void CadReceiver::cadDone(bool detected) {
+    if (!detected) {
+        state = State::SLEEP;
+        return;
+    }
+
+    ++stats.detections;
+    state = State::RX;
+    Radio.Rx(rx_window_ms);
+}
+
+/**
+ * @brief Called when a reception window ends.
+ *
+ * @param packet true if a packet was received, false on a timeout or an error.
+ */
+void CadReceiver::rxDone(bool packet) {
+    if (state != State::RX) {
+        return;
+    }
+
+    if (packet) {
+        ++stats.packets;
+    } else {
+        ++stats.false_wakeups;
+    }
+
+    state = State::SLEEP;
+}
+
+/**
+ * @brief Called when a relay batch has been sent.
+ *
+ * The radio goes back to reception after a transmission, so the next cycle
+ * puts it in standby before the CAD.
+ *
+ * @param ms The time on air in milliseconds.
+ */
+void CadReceiver::txDone(uint32_t ms) {
+    tx_us       += static_cast<int64_t>(ms) * 1000;
+    radio_asleep = false;
+}
+
+/**
+ * @brief Return the duty cycle and the estimated average current since the last report.
+ *
+ * The current is estimated from the time spent in each state and the typical
+ * supply currents of the SX1262 and the ESP32-S3.
+ */
+LowPowerDuty CadReceiver::duty() const {
+    LowPowerDuty measured {};
+    int64_t now = monotonicUs();
+
+    // In continuous reception, the radio has listened since the last cycle.
+    int64_t rxUs = cad_cycles ? rx_us : rx_us + (now - last_cycle);
+
+    measured.period_us    = now - period_start;
+    measured.radio_on_us  = cad_us + rxUs + tx_us;
+    measured.cpu_sleep_us = cpu_sleep_us;
+
+    if (measured.period_us <= 0) {
+        return measured;
+    }
+
+    int64_t radioSleep = std::max<int64_t>(measured.period_us - measured.radio_on_us, 0);
+    int64_t cpuAwake   = std::max<int64_t>(measured.period_us - cpu_sleep_us, 0);
+
+    int64_t chargeUaUs = (cad_us + rxUs) * SX126X_RX_UA + tx_us * SX126X_TX_UA +
+                         radioSleep * SX126X_SLEEP_UA +
+                         cpu_sleep_us * ESP32_LIGHT_SLEEP_UA + cpuAwake * ESP32_ACTIVE_UA;
+
+    measured.current_ua = static_cast<uint32_t>(chargeUaUs / measured.period_us);
+
+    return measured;
+}
+
+/**
+ * @brief Print the duty cycle, the estimated average current and the capture rate.
+ *
+ * The duty cycle and the current are measured over the time since the last
+ * report, see duty(). The capture rate is
+ * the share of the sensor frames received since boot, the others being counted
+ * as missed by the link statistics.
+ *
+ * @param missed The number of sensor frames missed since boot.
+ */
+void CadReceiver::report(uint32_t missed) {
+    LowPowerDuty measured = duty();
+
+    if (measured.period_us <= 0) {
+        return;
+    }
+
+    int64_t  period   = measured.period_us;
+    int64_t  cpuAwake = std::max<int64_t>(period - measured.cpu_sleep_us, 0);
+    uint32_t expected = stats.packets + missed;
+
+    Serial.printf("Low power: radio on %.1f%%, CPU awake %.1f%%, est. %.2f mA, "
+                  "cycles=%u detections=%u false=%u cad timeouts=%u, capture %.1f%% (%u/%u)\n",
+                  100.0 * measured.radio_on_us / period, 100.0 * cpuAwake / period,
+                  measured.current_ua / 1000.0,
+                  stats.cycles, stats.detections, stats.false_wakeups, stats.cad_timeouts,
+                  expected > 0 ? 100.0 * stats.packets / expected : 0.0,
+                  stats.packets, expected);
+
+    period_start += period;
+    last_cycle    = period_start;
+    cad_us        = 0;
+    rx_us         = 0;
+    tx_us         = 0;
+    cpu_sleep_us  = 0;
+}
@@ -33,11 +33,24 @@
 //
 // The application is event-driven, meaning that it waits for events from the
 // LoRa module and the OLED display, and then reacts accordingly.
+//
+// Built with BRIDGE_RELAY_MODE, the bridge has no internet uplink: it
+// forwards the frames it hears to an upstream bridge instead, on the uplink
+// radio profile, see relay.cpp. The upstream bridge is built with
+// BRIDGE_RELAY_UPSTREAM, so its radio accepts the relay batches. A relay
+// built with BRIDGE_LOW_POWER also listens with CAD duty cycling and sleeps
+// between frames, see low_power.cpp.
+//
+// The work is split between dedicated tasks:
+//   - radio   (core 1): radio IRQ processing, payload decoding and link statistics.
+//   - uplink  (core 0): Firebase authentication and uploads, next to the Wi-Fi stack.
+//   - display (core 0): OLED rendering, so I2C transfers never delay the radio.
+//   - loop    (core 1): application events, button and serial console.
 
 #include <Arduino.h>
+#include <atomic>
 #include <LoRaWan_APP.h>
 #include <pb_encode.h>
-#include <pb_decode.h>
 #include <WiFiProv.h>
 #include <WiFi.h>
 #include <Preferences.h>
@@ -47,38 +60,90 @@
 #include <qrcode.h>
 #include "lora_payload.pb.h"    // NOLINT
 #include "gui.h"                // NOLINT
+#include "link_stats.h"         // NOLINT
+#include "radio_profile.h"      // NOLINT
+#include "payload_registry.h"   // NOLINT
+#include "reading.h"            // NOLINT
+#include "relay.h"              // NOLINT
+#include "low_power.h"          // NOLINT
+#include "recent_filter.h"      // NOLINT
+#include "packet_log.h"         // NOLINT
+#include "heap_monitor.h"       // NOLINT
+#include "wall_clock.h"         // NOLINT
+#include "task_monitor.h"       // NOLINT
+#include "rtdb_uplink.h"        // NOLINT
+#include "json_writer.h"        // NOLINT
+#include "history.h"            // NOLINT
+#include "capture.h"            // NOLINT
+#include "receive_pipeline.h"   // NOLINT
+#include "reading_uplink.h"     // NOLINT
+#include "root_ca.h"            // NOLINT
 
 // Provide the token generation process info.
 #include "addons/TokenHelper.h"
-// Provide the RTDB payload printing info and other helper functions.
-#include "addons/RTDBHelper.h"
 
 //----------------------------------------------------------------
 // LoRa
 //----------------------------------------------------------------
-constexpr auto RF_FREQUENCY               {915000000};  // Hz
-
-constexpr auto TX_OUTPUT_POWER            {5};          // dBm
-
-constexpr auto LORA_BANDWIDTH             {0};          // [0: 125 kHz,
-                                                        //  1: 250 kHz,
-                                                        //  2: 500 kHz,
-                                                        //  3: Reserved]
-constexpr auto LORA_SPREADING_FACTOR      {7};          // [SF7..SF12]
-constexpr auto LORA_CODINGRATE            {1};          // [1: 4/5,
-                                                        //  2: 4/6,
-                                                        //  3: 4/7,
-                                                        //  4: 4/8]
-constexpr auto LORA_PREAMBLE_LENGTH       {8};          // Same for Tx and Rx
-constexpr auto LORA_SYMBOL_TIMEOUT        {0};          // Symbols
-constexpr auto LORA_FIX_LENGTH_PAYLOAD_ON {false};
-constexpr auto LORA_IQ_INVERSION_ON       {false};
-
+// The radio settings shared with the sensors are defined by the radio profiles,
+// see radio_profile.cpp.
 constexpr auto RX_TIMEOUT_VALUE {1000};
-constexpr auto BUFFER_SIZE      {30};                   // Define the payload size here
 
 static RadioEvents_t RadioEvents;
 
+static Preferences   radioPrefs;
+static RadioProfiles radioProfiles(&radioPrefs);
+
+//----------------------------------------------------------------
+// Tasks
+//----------------------------------------------------------------
+constexpr auto RADIO_TASK_CORE          {1};
+constexpr auto RADIO_TASK_PRIORITY      {5};
+constexpr auto RADIO_TASK_STACK         {6 * 1024};     // Bytes
+constexpr auto RADIO_TASK_POLL_TICKS    {1};
+
+constexpr auto UPLINK_TASK_CORE         {0};
+constexpr auto UPLINK_TASK_PRIORITY     {3};
+constexpr auto UPLINK_TASK_STACK        {12 * 1024};    // Bytes, TLS handshake included
+constexpr auto UPLINK_POLL_PERIOD_MS    {10};
+constexpr auto UPLINK_IDLE_WAIT_MS      {1000};
+
+constexpr auto DISPLAY_TASK_CORE        {0};
+constexpr auto DISPLAY_TASK_PRIORITY    {1};
+constexpr auto DISPLAY_TASK_STACK       {4 * 1024};     // Bytes
+constexpr auto DISPLAY_HISTORY_WAIT_MS  {50};           // A replay holds the radio for longer
+
+constexpr auto LOOP_PERIOD_MS           {10};
+constexpr auto TASK_REPORT_PERIOD_MS    {60 * 1000};
+constexpr auto FIREBASE_POLL_PERIOD_MS  {20 * 1000};
+
+// Display task notification bits
+constexpr uint32_t DISPLAY_REFRESH           {1 << 0};
+constexpr uint32_t DISPLAY_NEXT_SCREEN       {1 << 1};
+constexpr uint32_t DISPLAY_WIFI_PROV         {1 << 2};
+constexpr uint32_t DISPLAY_WIFI_ERROR        {1 << 3};
+constexpr uint32_t DISPLAY_WIFI_DISCONNECTED {1 << 4};
+
+static TaskHandle_t radioTaskHandle {nullptr};
+static TaskHandle_t uplinkTaskHandle {nullptr};
+static TaskHandle_t displayTaskHandle {nullptr};
+
+// Serializes the radio, the radio profiles and the link statistics between tasks.
+static SemaphoreHandle_t radioMutex;
+
+static TaskMonitor taskMonitor;
+
+// Per-packet log lines, printed by the loop task.
+static PacketLog packetLog;
+
+//----------------------------------------------------------------
+// Serial console
+//----------------------------------------------------------------
+constexpr auto SERIAL_LINE_SIZE {80};
+
+static std::array<char, SERIAL_LINE_SIZE> serialLine;
+static size_t serialLineLength {0};
+
 //----------------------------------------------------------------
 // Button
 //----------------------------------------------------------------
@@ -138,65 +203,150 @@ const String USER_PASSWORD {"a1b2c3d4e5!"};
 //----------------------------------------------------------------
 // Private data
 //----------------------------------------------------------------
-// Define Firebase Data object
-// FirebaseData stream;
-FirebaseData fbdo;
+#ifndef BRIDGE_RELAY_MODE
+// The Firebase client only signs in, the database goes through the uplink.
 FirebaseAuth auth;
 FirebaseConfig config;
+#endif
 
 // Variable to save USER UID
 const String uid;
 
 // Variables to save database paths
 const String databasePath {"water_tank"};
-const String sensorPath {databasePath + "/sensors"};
 
 // Database child nodes
-// Water level sensor path
-const String sensorWaterPath {sensorPath + "/water_level/"};
-const String levelPath {"/level"};
-const String distancePath {"/distance"};
-const String errorPath {"/error"};
-const String timePath {"/timestamp/.sv"};
-
-// Temperature sensor path
-const String sensorAirPath {sensorPath + "/air/"};
-const String tempPath {"/temperature"};
-
-// Time stamp path
-
-// JSON object to save sensor readings and timestamp
-static FirebaseJson json;
+// The sensor nodes and their fields are defined by the payload registry,
+// see payload_registry.cpp, and the link quality nodes by reading.cpp.
+constexpr char timePath[] {"timestamp"};
+
+// Bridge configuration path
+const String bridgeConfigPath {databasePath + "/bridge/config"};
+const String radioProfilePath {bridgeConfigPath + "/radio_profile"};
+
+// Bridge status path
+const String bridgeStatusPath {databasePath + "/bridge/status"};
+constexpr char heapFreePath[] {"heap_free"};
+constexpr char heapLargestPath[] {"heap_largest_block"};
+constexpr char heapMinPath[] {"heap_min_free"};
+constexpr char heapFragPath[] {"heap_fragmentation"};
+constexpr char poolLowPath[] {"reading_pool_low_water"};
+constexpr char dropPath[] {"uplink_dropped"};
+constexpr char latencyAvgPath[] {"latency_avg_ms"};
+constexpr char latencyMaxPath[] {"latency_max_ms"};
+constexpr char uplinkRttPath[] {"uplink_rtt_avg_ms"};
+constexpr char uplinkErrorPath[] {"uplink_errors"};
+constexpr char uplinkInFlightPath[] {"uplink_in_flight_max"};
+
+// The JSON documents of the readings and the bridge status are written in
+// place into the body buffers of the uplink requests, see json_writer.h.
+
+#ifndef BRIDGE_RELAY_MODE
+// Readings are written and the remote configuration read by the asynchronous
+// uplink, the Firebase client only signs in.
+static void onUplinkDone(void *context, int status, uint32_t rttMs, const char *response);
+static RtdbUplink rtdbUplink(onUplinkDone);
+static bool firebaseStarted {false};
+
+// Readings travel from the radio task to the uplink task as pool pointers,
+// see reading_uplink.h.
+static ReadingUplink readingUplink(&rtdbUplink, &packetLog);
+#endif
 
 static bool signupOK {false};
 
-static uint32_t prevPacketId {0};
-static uint32_t errorCount {0};
+#ifdef BRIDGE_RELAY_MODE
+static RelayAggregator relay;
+static std::array<uint8_t, LORA_MAX_PAYLOAD_LENGTH> relayFrame;
+static bool     relayTxBusy {false};
+static uint32_t relayTxStart {0};
+static uint32_t relayTxTimeoutCount {0};
+#endif
+
+#ifdef BRIDGE_LOW_POWER
+static CadReceiver cadReceiver;
+#endif
 
 static bool lora_idle {true};
 
 static QueueHandle_t eventQueue;
 
-static uint32_t lastTime {0};
+static uint32_t lastTaskReport {0};
+
+// The frames received by the radio task, see receive_pipeline.h. The link
+// statistics and the history are read under the radio mutex.
+static void onLiveGui(const ReceivedReading &reading);
+static void onLiveReading(const ReceivedReading &reading);
+static ReceivePipeline receivePipeline({onLiveGui, onLiveReading}, &packetLog);
+
+// RF capture and replay, see capture.cpp. A replay runs the captured frames
+// through a pipeline of its own, so the live receive state, the display and
+// the uplink are left alone. Its readings are encoded and thrown away.
+static void onReplayReading(const ReceivedReading &reading);
+static FrameCapture frameCapture;
+static ReceivePipeline replayPipeline({nullptr, onReplayReading}, &packetLog);
+static StageTimer stageTimer;
+#ifdef BRIDGE_RELAY_MODE
+static RelayAggregator replayRelay;
+static std::array<uint8_t, LORA_MAX_PAYLOAD_LENGTH> replayFrame;
+#else
+static SensorReading replayReading;
+static std::array<char, UPLINK_BODY_SIZE> replayBody;
+
+static char remoteProfile[RADIO_PROFILE_NAME_LEN] {};
+#endif
+
+// Heap allocations of the replaying task, counted by the malloc wrappers, see
+// the --wrap linker flags of the esp32 environment.
+static TaskHandle_t volatile replayTaskHandle {nullptr};
+static std::atomic<uint32_t> replayAllocations {0};
 
 //----------------------------------------------------------------
 // Display
 //----------------------------------------------------------------
 //                   addr , freq , i2c group ,         resolution ,     rst
 SSD1306Wire display(0x3c, 500000, SDA_OLED, SCL_OLED, GEOMETRY_128_64, RST_OLED);
-OledGuiData guiData = oled_gui_data_init_default;
+OledGuiData guiData = oled_gui_data_init_default;       // Owned by the display task
 OledGui     gui(&display, &guiData);
 
+static const char *volatile disconnectReason {""};
+
 //----------------------------------------------------------------
 // Private functions
 //----------------------------------------------------------------
+#ifndef BRIDGE_RELAY_MODE
 static void initFirebase(void);
 static void SysProvEvent(arduino_event_t *sys_event);
+#endif
 static void OnRxDone(uint8_t *, uint16_t, int16_t, int8_t);
+#ifdef BRIDGE_RELAY_MODE
+static void sendRelayBatch(void);
+static void OnTxDone(void);
+static void OnTxTimeout(void);
+#else
+#endif
+#ifdef BRIDGE_LOW_POWER
+static void OnCadDone(bool detected);
+static void OnRxTimeout(void);
+static void OnRxError(void);
+#endif
 void initWiFi(void);
 static void showStatus(uint32_t packetId, uint8_t level, int16_t rssi, uint32_t errCnt);
 static void buttonClick(void);
 static void buttonPress(void);
+static void printLinkReport(void);
+static void readSerialCommand(void);
+static void handleSerialCommand(char *line);
+#ifndef BRIDGE_RELAY_MODE
+static void pollRemoteProfile(void);
+static void applyRemoteProfile(const char *response);
+static void uploadStatus(void);
+static void uplinkTask(void *parameter);
+#endif
+static void replayCapture(bool realTime);
+static void radioTask(void *parameter);
+static void displayTask(void *parameter);
+static void notifyDisplay(uint32_t bits);
 
 /**
  * @brief Initializes the system components and configurations.
@@ -218,33 +368,56 @@ void setup() {
     Serial.println("LoRa Bridge");
 
     RadioEvents.RxDone = OnRxDone;
+#ifdef BRIDGE_RELAY_MODE
+    RadioEvents.TxDone    = OnTxDone;
+    RadioEvents.TxTimeout = OnTxTimeout;
+
+    relay.begin(static_cast<uint32_t>(ESP.getEfuseMac() & 0x00FFFFFF));
+#endif
+#ifdef BRIDGE_LOW_POWER
+    RadioEvents.CadDone   = OnCadDone;
+    RadioEvents.RxTimeout = OnRxTimeout;
+    RadioEvents.RxError   = OnRxError;
+
+    setCpuFrequencyMhz(LOW_POWER_CPU_MHZ);
+#endif
 
     Radio.Init(&RadioEvents);
-    Radio.SetChannel(RF_FREQUENCY);
-    Radio.SetRxConfig(MODEM_LORA,                   // modem
-                      LORA_BANDWIDTH,               // bandwidth
-                      LORA_SPREADING_FACTOR,        // datarate
-                      LORA_CODINGRATE,              // coderate
-                      0,                            // bandwidthAfc
-                      LORA_PREAMBLE_LENGTH,         // preambleLen
-                      LORA_SYMBOL_TIMEOUT,          // symbTimeout
-                      LORA_FIX_LENGTH_PAYLOAD_ON,   // fixLen
-                      0,                            // payloadLen
-                      true,                         // crcOn
-                      false,                        // freqHopOn
-                      0,                            // hopPeriod
-                      LORA_IQ_INVERSION_ON,         // iqInverted
-                      true);                        // rxContinuous
+    radioProfiles.begin();
+#ifdef BRIDGE_LOW_POWER
+    cadReceiver.begin(radioProfiles.active());
+#endif
 
     eventQueue = xQueueCreate(10, sizeof(AppEvent));
+    radioMutex = xSemaphoreCreateMutex();
 
-    if (eventQueue == nullptr) {
+    if (eventQueue == nullptr || radioMutex == nullptr) {
         Serial.println("Error creating the queue");
     }
 
+#ifndef BRIDGE_RELAY_MODE
+    if (!readingUplink.begin(databasePath.c_str(), static_cast<uint32_t>(ESP.getEfuseMac()),
+                             esp_random())) {
+        Serial.println("Error creating the uplink queue");
+    }
+#endif
+
     gui.init();
     gui.splashScreen();
 
+    // The radio task notifies the other two, so it is started last.
+    xTaskCreatePinnedToCore(displayTask, "display", DISPLAY_TASK_STACK, nullptr,
+                            DISPLAY_TASK_PRIORITY, &displayTaskHandle, DISPLAY_TASK_CORE);
+#ifndef BRIDGE_RELAY_MODE
+    xTaskCreatePinnedToCore(uplinkTask, "uplink", UPLINK_TASK_STACK, nullptr,
+                            UPLINK_TASK_PRIORITY, &uplinkTaskHandle, UPLINK_TASK_CORE);
+#endif
+    xTaskCreatePinnedToCore(radioTask, "radio", RADIO_TASK_STACK, nullptr,
+                            RADIO_TASK_PRIORITY, &radioTaskHandle, RADIO_TASK_CORE);
+
+#ifdef BRIDGE_RELAY_MODE
+    Serial.println("Relay mode, Wi-Fi disabled");
+#else
     WiFi.onEvent(SysProvEvent);
     WiFi.setAutoReconnect(true);
     WiFiProv.beginProvision(WIFI_PROV_SCHEME_BLE,
@@ -255,6 +428,7 @@ void setup() {
                             nullptr,
                             uuid.data(),
                             false);
+#endif
 
     Serial.println();
 }
@@ -263,10 +437,9 @@ void setup() {
  * @brief The main loop of the program.
  *
  * This function is called repeatedly after the setup() function. It is
- * responsible for processing any pending LoRa radio events and receiving any
- * incoming LoRa packets.
- *
- * When the radio is idle, this function starts the radio in receive mode.
+ * responsible for processing the application events, the button and the
+ * serial console, and for printing the periodic task report. The radio,
+ * uplink and display work is done by their own tasks.
  *
  * @note This function is called by the Arduino framework automatically.
  *       It should not be called directly.
@@ -277,25 +450,26 @@ void loop() {
     if (xQueueReceive(eventQueue, &event, 0) != 0) {
         switch (event.id) {
         case AppEventId::APPRICATION_EVENT_WIFI_CONNECTED:
-            initFirebase();
-            gui.refresh();
+            xTaskNotifyGive(uplinkTaskHandle);
+            notifyDisplay(DISPLAY_REFRESH);
         break;
 
         case AppEventId::APPRICATION_EVENT_WIFI_DISCONNECTED:
-            gui.showWifiDisconnectedScreen((const char *)event.info.data);
+            disconnectReason = (const char *)event.info.data;
+            notifyDisplay(DISPLAY_WIFI_DISCONNECTED);
         break;
 
         case AppEventId::APPRICATION_EVENT_WIFI_PROVISIONING_STARTED:
-            gui.showWifiProvScreen();
+            notifyDisplay(DISPLAY_WIFI_PROV);
         break;
 
         case AppEventId::APPRICATION_EVENT_WIFI_CONNECTION_ERROR:
             wifi_prov_mgr_reset_sm_state_on_failure();
-            gui.showWifiErrorScreen();
+            notifyDisplay(DISPLAY_WIFI_ERROR);
         break;
 
         case AppEventId::APPRICATION_EVENT_BUTTON_CLICKED:
-            gui.nextScreen();
+            notifyDisplay(DISPLAY_NEXT_SCREEN);
         break;
 
         case AppEventId::APPRICATION_EVENT_BUTTON_PRESSED:
@@ -312,25 +486,258 @@ void loop() {
 
     button.tick();
 
-    if (lora_idle) {
-        lora_idle = false;
-        Radio.Rx(0);
+    readSerialCommand();
+
+    frameCapture.drain();
+
+    packetLog.flush();
+
+    if (millis() - lastTaskReport > TASK_REPORT_PERIOD_MS) {
+        lastTaskReport = millis();
+
+        taskMonitor.report();
+
+        xSemaphoreTake(radioMutex, portMAX_DELAY);
+        printLinkReport();
+#ifdef BRIDGE_LOW_POWER
+        uint32_t missed {0};
+
+        for (const auto &link : receivePipeline.linkStats().entries()) {
+            missed += link.used ? link.missed : 0;
+        }
+
+        cadReceiver.report(missed);
+#endif
+        xSemaphoreGive(radioMutex);
+
+#ifndef BRIDGE_RELAY_MODE
+        Serial.printf("Uplink queue: %u waiting, %u dropped\n",
+                      readingUplink.waiting(), readingUplink.dropped());
+        const UplinkStats &uplinkStats = rtdbUplink.statistics();
+        Serial.printf("Uplink: requests=%u ok=%u errors=%u timeouts=%u connections=%u "
+                      "rtt=%u ms in flight max=%u\n",
+                      uplinkStats.requests, uplinkStats.completed, uplinkStats.errors,
+                      uplinkStats.timeouts, uplinkStats.connections, uplinkStats.rtt_avg_ms,
+                      uplinkStats.in_flight_max);
+#endif
+        const ReceiveCounters &receiveCounters = receivePipeline.statistics();
+        Serial.printf("Rejected frames: %u oversized, %u unknown type, %u undecodable\n",
+                      receiveCounters.oversize, receiveCounters.unknown, receiveCounters.undecodable);
+#ifndef BRIDGE_NO_RECENT_FILTER
+        Serial.printf("Suppressed duplicate frames: %u\n", receiveCounters.suppressed);
+#endif
+#ifdef BRIDGE_RELAY_MODE
+        const RelayStats &relayStats = relay.statistics();
+        Serial.printf("Relay: in=%u dropped=%u batches=%u entries=%u hold=%u ms tx timeouts=%u\n",
+                      relayStats.frames_in, relayStats.frames_dropped, relayStats.batches_out,
+                      relayStats.entries_out, relayStats.hold_avg_ms, relayTxTimeoutCount);
+#else
+        const auto &readingPool = readingUplink.readingPool();
+        Serial.printf("Reading pool: %u/%u free, low water %u\n",
+                      readingPool.available(), readingPool.capacity(), readingPool.lowWater());
+        Serial.printf("Latency: avg=%u ms max=%u ms, clock %s\n", readingUplink.latencyAvgMs(),
+                      readingUplink.latencyMaxMs(), wallClockSynced() ? "synced" : "not synced");
+#endif
+        Serial.printf("Packet log: %u dropped\n", packetLog.droppedCount());
+        printHeapStats(readHeapStats());
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(LOOP_PERIOD_MS));
+}
+
+/**
+ * @brief The radio task.
+ *
+ * Restarts the reception when the radio is idle and processes the radio
+ * interrupts, which calls OnRxDone() for every received packet. Since the
+ * interrupts are polled every RADIO_TASK_POLL_TICKS, a frame is stamped at
+ * most one poll period after its RX done interrupt. In relay mode, it also
+ * sends the pending relay batch when it is due. The radio mutex is held
+ * while the radio is in use so other tasks can safely change the radio
+ * profile.
+ *
+ * In low-power mode, the CAD cycles pace the task instead of the poll period.
+ * Each cycle blocks the task while the CAD runs, so the loop task still gets
+ * to run without losing a preamble. The wait for the next cycle runs after
+ * the radio mutex is given back, so a profile change does not wait for it.
+ *
+ * @param parameter Unused.
+ */
+static void radioTask(void * /* parameter */) {
+    for (;;) {
+        xSemaphoreTake(radioMutex, portMAX_DELAY);
+
+#ifdef BRIDGE_RELAY_MODE
+        // A profile change during a transmission cancels it without a TX event.
+        if (relayTxBusy && (millis() - relayTxStart) > (2 * RELAY_TX_TIMEOUT_MS)) {
+            OnTxTimeout();
+        }
+
+        if (!relayTxBusy && relay.ready(monotonicUs())) {
+            sendRelayBatch();
+        }
+
+#ifdef BRIDGE_LOW_POWER
+        if (!relayTxBusy) {
+            cadReceiver.cycle(radioProfiles.active());
+        }
+#else
+        if (lora_idle && !relayTxBusy) {
+            lora_idle = false;
+            Radio.Rx(0);
+        }
+#endif
+#else
+        if (lora_idle) {
+            lora_idle = false;
+            Radio.Rx(0);
+        }
+#endif
+
+        Radio.IrqProcess();
+        radioProfiles.tick(millis());
+
+        xSemaphoreGive(radioMutex);
+
+#ifdef BRIDGE_LOW_POWER
+        if (relayTxBusy) {
+            vTaskDelay(RADIO_TASK_POLL_TICKS);
+        } else {
+            cadReceiver.idle();
+        }
+#else
+        vTaskDelay(RADIO_TASK_POLL_TICKS);
+#endif
     }
+}
+
+#ifndef BRIDGE_RELAY_MODE
+/**
+ * @brief The uplink task.
+ *
+ * Owns the Firebase client and the asynchronous uplink: initializes the
+ * Firebase and SNTP clients once Wi-Fi is connected, hands the readings
+ * queued by the radio task to the uplink, refreshes the token, uploads the
+ * bridge status and reads the remote configuration node through the uplink.
+ * The uplink only connects and sends once the Firebase client has a token.
+ *
+ * Readings are only taken from the queue while the uplink has room. When the
+ * database is slow or unreachable, they wait in the queue, then the pool runs
+ * out and the radio task drops the new ones, see ReadingUplink. Readings
+ * return to the pool when their write is done, see onUplinkDone().
+ *
+ * @param parameter Unused.
+ */
+static void uplinkTask(void * /* parameter */) {
+    uint32_t lastPoll {0};
+
+    rtdbUplink.begin(DATABASE_URL.c_str());
+
+    for (;;) {
+        if (ulTaskNotifyTake(pdTRUE, 0) != 0) {
+            beginWallClock();
+            initFirebase();
+            firebaseStarted = true;
+        }
+
+        bool authorized = firebaseStarted && Firebase.ready();
+
+        if (authorized) {
+            rtdbUplink.setToken(Firebase.getToken());
+        }
+
+        readingUplink.submitQueued();
+
+        rtdbUplink.poll(authorized);
+
+        if (millis() - lastPoll > FIREBASE_POLL_PERIOD_MS) {
+            lastPoll = millis();
+
+            if (Firebase.isTokenExpired()) {
+                Serial.println("Firebase token expired, refreshing...");
+                Firebase.refreshToken(&config);
+            } else {
+                Firebase.ready();
+            }
 
-    Radio.IrqProcess();
+            uploadStatus();
 
-    if (millis() - lastTime > 20000) {
-        lastTime = millis();
+            if (authorized) {
+                pollRemoteProfile();
+            }
+        }
 
-        if (Firebase.isTokenExpired()) {
-            Serial.println("Firebase token expired, refreshing...");
-            Firebase.refreshToken(&config);
+        if (rtdbUplink.idle()) {
+            readingUplink.waitQueued(UPLINK_IDLE_WAIT_MS);
         } else {
-            Firebase.ready();
+            vTaskDelay(pdMS_TO_TICKS(UPLINK_POLL_PERIOD_MS));
+        }
+    }
+}
+#endif
+
+/**
+ * @brief The display task.
+ *
+ * Waits for display notifications, takes a copy of the latest radio data and
+ * renders the requested screen. On a History page, only the history of the
+ * sensor shown is copied, under the radio mutex.
+ *
+ * @param parameter Unused.
+ */
+static void displayTask(void * /* parameter */) {
+    uint32_t bits {0};
+
+    for (;;) {
+        xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+
+        if (bits & DISPLAY_NEXT_SCREEN) {
+            gui.nextScreen();
+        }
+
+        int historyPage = gui.historyPage();
+
+        receivePipeline.copyGui(&guiData);
+
+        // Without the mutex, the previous copy of the history is shown again.
+        if (xSemaphoreTake(radioMutex, pdMS_TO_TICKS(DISPLAY_HISTORY_WAIT_MS)) == pdTRUE) {
+            uint64_t source {0};
+
+            const LevelHistory &levelHistory = receivePipeline.history();
+
+            guiData.history.sensors = levelHistory.count();
+
+            if (historyPage >= 0 &&
+                levelHistory.copy(static_cast<uint8_t>(historyPage), monotonicUs(),
+                                  &source, &guiData.history.columns)) {
+                guiData.history.sensor_id = payloadSourceSensor(source);
+            }
+
+            xSemaphoreGive(radioMutex);
+        }
+
+        if (bits & DISPLAY_WIFI_ERROR) {
+            gui.showWifiErrorScreen();
+        } else if (bits & DISPLAY_WIFI_DISCONNECTED) {
+            gui.showWifiDisconnectedScreen(disconnectReason);
+        } else if (bits & DISPLAY_WIFI_PROV) {
+            gui.showWifiProvScreen();
+        } else if (bits & (DISPLAY_NEXT_SCREEN | DISPLAY_REFRESH)) {
+            gui.refresh();
         }
     }
 }
 
+/**
+ * @brief Ask the display task to render a screen.
+ *
+ * @param bits The DISPLAY_* notification bits.
+ */
+static void notifyDisplay(uint32_t bits) {
+    xTaskNotify(displayTaskHandle, bits, eSetBits);
+}
+
+#ifndef BRIDGE_RELAY_MODE
 /**
  * @brief Initialize Firebase configuration and connection settings.
  *
@@ -362,13 +769,8 @@ static void initFirebase(void) {
     // Enable automatic WiFi reconnection
     Firebase.reconnectWiFi(true);
 
-    // Configure SSL buffer sizes for BearSSL engine
-    // RX buffer size (bytes): 512 - 16384
-    // TX buffer size (bytes): 512 - 16384
-    fbdo.setBSSLBufferSize(4096, 1024);
-
-    // Limit the size of response payload to be collected in FirebaseData
-    fbdo.setResponseSize(2048);
+    // Check the certificates of the token servers
+    config.cert.data = ROOT_CA_PEM;
 
     // Initialize Firebase with the provided configuration and authentication
     Firebase.begin(&config, &auth);
@@ -470,6 +872,7 @@ static void SysProvEvent(arduino_event_t *sys_event) {
         break;
     }
 }
+#endif
 
 /**
  * @brief Called when a LoRa packet has been received.
@@ -479,56 +882,536 @@ static void SysProvEvent(arduino_event_t *sys_event) {
  * @param rssi The RSSI value of the received packet.
  * @param snr The SNR value of the received packet.
  *
- * Decodes the received packet as a LoraPayload message and displays the
- * received packet ID, water level and RSSI value on the OLED display.
- * If the Firebase Realtime Database is ready, the water level value is
- * written to the water level node in the Realtime Database.
+ * Runs in the radio task. Stamps the packet with its capture time and runs
+ * it through the receive pipeline, which decodes it in place from the radio
+ * driver buffer. The buffer stays valid until this callback returns.
+ */
+static void OnRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr) {
+    int64_t capturedUs = monotonicUs();
+
+    frameCapture.record(payload, size, rssi, snr, capturedUs);
+
+    receivePipeline.setSpreadingFactor(radioProfiles.active().spreading_factor);
+    receivePipeline.receive(payload, size, rssi, snr, capturedUs);
+
+    digitalWrite(LED, HIGH);
+    Radio.Sleep();
+    lora_idle = true;
+#ifdef BRIDGE_LOW_POWER
+    cadReceiver.rxDone(true);
+#endif
+}
+
+/**
+ * @brief Called by the receive pipeline when the GUI data changed. Wakes up the display task.
+ */
+static void onLiveGui(const ReceivedReading & /* reading */) {
+    notifyDisplay(DISPLAY_REFRESH);
+}
+
+/**
+ * @brief Called by the receive pipeline for each new reading.
+ *
+ * Runs in the radio task. Counts the reading for the probation of the radio
+ * profile, then adds the frame as received to the pending batch of a relay,
+ * or queues the reading for the uplink task of a bridge.
+ *
+ * @param reading The reading.
+ */
+static void onLiveReading(const ReceivedReading &reading) {
+    radioProfiles.packetReceived(reading.missed);
+
+#ifdef BRIDGE_RELAY_MODE
+    relay.add(reading.frame, reading.size, reading.rssi, reading.snr, reading.hops,
+              reading.captured_us);
+#else
+    readingUplink.queueReading(receivePipeline, reading);
+#endif
+}
+
+#ifdef BRIDGE_RELAY_MODE
+/**
+ * @brief Send the pending relay batch to the upstream bridge.
+ *
+ * Runs in the radio task. The radio is switched to the uplink profile for
+ * the transmission, and back to the active profile by OnTxDone().
  */
-static void OnRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t /* snr */) {
-    std::array<uint8_t, BUFFER_SIZE> rxpacket;
-    rxpacket.fill(0);
+static void sendRelayBatch(void) {
+    // Held while the active profile shares the uplink channel, see uplinkUsable().
+    if (!radioProfiles.uplinkUsable()) {
+        return;
+    }
+
+    size_t length = relay.encode(relayFrame.data(), relayFrame.size(), monotonicUs());
 
-    std::copy_n(payload, size, rxpacket.begin());
+    if (length == 0 || !radioProfiles.configureUplinkTx(RELAY_TX_POWER, RELAY_TX_TIMEOUT_MS)) {
+        Serial.println("Cannot send relay batch");
+        return;
+    }
 
-    /* Allocate space for the decoded message. */
-    LoraPayload loraPayload = LoraPayload_init_default;
+    relayTxBusy  = true;
+    relayTxStart = millis();
+    Radio.Send(relayFrame.data(), static_cast<uint8_t>(length));
+}
 
-    /* Create a stream that reads from the buffer. */
-    pb_istream_t stream = pb_istream_from_buffer(rxpacket.data(), size);
+/**
+ * @brief Called when the relay batch has been sent. Resumes reception.
+ */
+static void OnTxDone(void) {
+#ifdef BRIDGE_LOW_POWER
+    cadReceiver.txDone(millis() - relayTxStart);
+#endif
+    relayTxBusy = false;
+    lora_idle   = false;
+    radioProfiles.resumeRx();
+}
+
+/**
+ * @brief Called when the relay batch could not be sent in time. Resumes reception.
+ */
+static void OnTxTimeout(void) {
+    ++relayTxTimeoutCount;
+    OnTxDone();
+}
+#endif
+
+#ifdef BRIDGE_LOW_POWER
+/**
+ * @brief Called when a CAD is done.
+ *
+ * @param detected true if the CAD found a preamble.
+ */
+static void OnCadDone(bool detected) {
+    cadReceiver.cadDone(detected);
+}
 
-    /* Now we are ready to decode the message. */
-    if (pb_decode(&stream, LoraPayload_fields, &loraPayload)) {
-        if (loraPayload.id != prevPacketId) {
-            if (loraPayload.id > (prevPacketId + 1)) {
-                ++errorCount;
+/**
+ * @brief Called when a reception window opened by a CAD ends without a packet.
+ */
+static void OnRxTimeout(void) {
+    Radio.Sleep();
+    cadReceiver.rxDone(false);
+}
+
+/**
+ * @brief Called when a packet is received with a CRC or header error.
+ */
+static void OnRxError(void) {
+    Radio.Sleep();
+    cadReceiver.rxDone(false);
+}
+#endif
+
+/**
+ * @brief Called by the replay pipeline for each new reading.
+ *
+ * Does the work of the live reading up to the network: a bridge serializes
+ * the reading to its JSON text, a relay adds the frame to a scratch batch and
+ * encodes the batch when it is due. Nothing is queued or sent.
+ *
+ * @param reading The reading.
+ */
+static void onReplayReading(const ReceivedReading &reading) {
+#ifdef BRIDGE_RELAY_MODE
+    replayRelay.add(reading.frame, reading.size, reading.rssi, reading.snr, reading.hops,
+                    reading.captured_us);
+
+    if (replayRelay.ready(reading.captured_us)) {
+        replayRelay.encode(replayFrame.data(), replayFrame.size(), reading.captured_us);
+    }
+#else
+    JsonWriter json(replayBody.data(), replayBody.size());
+
+    replayPipeline.fillReading(reading, &replayReading);
+    buildReadingJson(replayReading, &json);
+    json.finish();
+#endif
+}
+
+/**
+ * @brief Return the monotonic time in nanoseconds, the clock of the replay stage timer.
+ */
+static int64_t replayClockNs(void) {
+    return monotonicUs() * 1000;
+}
+
+/**
+ * @brief Replay the capture through the receive pipeline and print the results.
+ *
+ * The captured frames go through the same pipeline as the live ones, from
+ * decoding to the uplink, but into an empty pipeline of its own: every run of
+ * the same capture takes the same path and the live receive state, display
+ * and uplink are not touched. The loop task holds the radio mutex for the
+ * whole replay, so the radio task does not run between the stages timed.
+ *
+ * The result is one JSON line, see ReceivePipeline::replayJson(): the frame
+ * count, the duration and throughput, the time spent in each stage, the heap
+ * allocations made by the loop task, and the pipeline counters. At max
+ * speed, the throughput includes reading the capture from flash, the stages
+ * do not.
+ *
+ * @param realTime true to keep the timing of the capture, false to replay at max speed.
+ */
+static void replayCapture(bool realTime) {
+    static CaptureRecord record;
+    static char result[REPLAY_RESULT_SIZE];
+
+    if (!frameCapture.openReplay()) {
+        return;
+    }
+
+    xSemaphoreTake(radioMutex, portMAX_DELAY);
+
+    replayPipeline.reset(radioProfiles.active().spreading_factor);
+    replayPipeline.setTimer(&stageTimer);
+#ifdef BRIDGE_RELAY_MODE
+    replayRelay = RelayAggregator();
+#endif
+
+    uint32_t frames {0};
+
+    stageTimer.enable(replayClockNs);
+    replayAllocations = 0;
+    replayTaskHandle  = xTaskGetCurrentTaskHandle();
+
+    int64_t start = monotonicUs();
+    int64_t due   = start;
+
+    while (frameCapture.next(&record)) {
+        if (realTime) {
+            due += record.delta_us;
+            int64_t wait = due - monotonicUs();
+
+            if (wait >= 1000) {
+                vTaskDelay(pdMS_TO_TICKS(wait / 1000));
             }
+        }
 
-            prevPacketId = loraPayload.id;
+        ++frames;
+        replayPipeline.receive(record.frame.data(), record.size, record.rssi, record.snr,
+                               monotonicUs());
+    }
 
-            guiData.info.water_level = loraPayload.level;
-            guiData.stats.received_packet_id  = loraPayload.id;
-            guiData.stats.receive_error_count = errorCount;
-            guiData.stats.sensor_error_count  = loraPayload.err_sensor;
-            guiData.stats.rssi = rssi;
-            gui.refresh();
+    int64_t elapsed = monotonicUs() - start;
+
+    replayTaskHandle = nullptr;
+    stageTimer.disable();
+
+    xSemaphoreGive(radioMutex);
+    frameCapture.closeReplay();
+
+    ReplayResult replay {realTime, frames, 1, elapsed, replayAllocations.load()};
+
+    if (replayPipeline.replayJson(replay, result, sizeof(result)) > 0) {
+        Serial.println(result);
+    }
+}
+
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *pointer, size_t size);
+
+/**
+ * @brief Count an allocation made by the replaying task.
+ */
+static inline void countReplayAllocation(void) {
+    if (replayTaskHandle != nullptr && xTaskGetCurrentTaskHandle() == replayTaskHandle) {
+        ++replayAllocations;
+    }
+}
+
+/**
+ * @brief The heap allocators, wrapped by the linker to count the allocations of a replay.
+ *
+ * Every malloc(), calloc() and realloc() of the firmware goes through these,
+ * the libraries and operator new included. Outside a replay, they only compare a handle.
+ */
+IRAM_ATTR void *__wrap_malloc(size_t size) {
+    countReplayAllocation();
+    return __real_malloc(size);
+}
 
-            if (Firebase.ready()) {
-                json.set(levelPath.c_str(), String(loraPayload.level));
-                json.set(distancePath.c_str(), String(loraPayload.distance));
-                json.set(errorPath.c_str(), String(loraPayload.err_sensor));
-                json.set(timePath, "timestamp");
-                bool result = Firebase.RTDB.pushJSON(&fbdo, sensorWaterPath.c_str(), &json);
-                Serial.printf("Set json... %s\n", result ? "ok" : fbdo.errorReason().c_str());
+IRAM_ATTR void *__wrap_calloc(size_t count, size_t size) {
+    countReplayAllocation();
+    return __real_calloc(count, size);
+}
+
+IRAM_ATTR void *__wrap_realloc(void *pointer, size_t size) {
+    countReplayAllocation();
+    return __real_realloc(pointer, size);
+}
+}
+
+#ifndef BRIDGE_RELAY_MODE
+/**
+ * @brief Called by the uplink when a write is done.
+ *
+ * Runs in the uplink task. Hands the writes of the readings back to the
+ * reading uplink, which returns them to the pool.
+ *
+ * @param context The reading, nullptr for the bridge status, or remoteProfile
+ *        for the read of the remote radio profile.
+ * @param status The HTTP status, or UPLINK_STATUS_FAILED.
+ * @param rttMs The round trip time of the request.
+ * @param response The body of the remote radio profile read.
+ */
+static void onUplinkDone(void *context, int status, uint32_t /* rttMs */, const char *response) {
+    bool result = status >= 200 && status < 300;
+
+    if (context == remoteProfile) {
+        if (result && response != nullptr) {
+            applyRemoteProfile(response);
+        }
+        return;
+    }
+
+    if (context == nullptr) {
+        if (!result) {
+            packetLog.printf("Set status... failed (%d)\n", status);
+        }
+        return;
+    }
+
+    readingUplink.done(static_cast<SensorReading *>(context), status);
+}
+
+/**
+ * @brief Queue the heap, reading pool, uplink and latency statistics for the bridge status node.
+ *
+ * Runs in the uplink task, at the Firebase poll period. The status is skipped
+ * when the uplink is full.
+ */
+static void uploadStatus(void) {
+    if (rtdbUplink.room() == 0) {
+        return;
+    }
+
+    HeapStats heap = readHeapStats();
+    const UplinkStats &uplinkStats = rtdbUplink.statistics();
+    JsonWriter json(rtdbUplink.nextBody(), UPLINK_BODY_SIZE);
+
+    json.addInt(heapFreePath, heap.free_size);
+    json.addInt(heapLargestPath, heap.largest_free_block);
+    json.addInt(heapMinPath, heap.min_free_size);
+    json.addInt(heapFragPath, heap.fragmentation);
+    json.addInt(poolLowPath, readingUplink.readingPool().lowWater());
+    json.addInt(dropPath, readingUplink.dropped());
+    json.addInt(latencyAvgPath, readingUplink.latencyAvgMs());
+    json.addInt(latencyMaxPath, readingUplink.latencyMaxMs());
+    json.addInt(uplinkRttPath, uplinkStats.rtt_avg_ms);
+    json.addInt(uplinkErrorPath, uplinkStats.errors);
+    json.addInt(uplinkInFlightPath, uplinkStats.in_flight_max);
+    json.addServerTimestamp(timePath);
+
+    rtdbUplink.submit(bridgeStatusPath.c_str(), json.finish(), nullptr);
+}
+#endif
+
+/**
+ * @brief Print the link statistics of every sensor heard so far on the serial console.
+ *
+ * Each line gives the RSSI and SNR averages and ranges, the link margin against the
+ * current spreading factor, the data rate advice and both histograms.
+ */
+static void printLinkReport(void) {
+    static const char *const adviceStr[] = {"n/a", "keep", "faster", "slower"};
+
+    const LinkStats &linkStats = receivePipeline.linkStats();
+
+    for (const auto &link : linkStats.entries()) {
+        if (!link.used) {
+            continue;
+        }
+
+        Serial.printf("Link %u:%u: n=%u lost=%u rssi=%d [%d, %d] snr=%.1f [%d, %d] margin=%.1f dB advice=%s\n",
+                      payloadSourceType(link.source), payloadSourceSensor(link.source), link.samples, link.missed,
+                      linkStats.rssiAverage(link), link.rssi_min, link.rssi_max,
+                      linkStats.snrAverageTenths(link) / 10.0, link.snr_min, link.snr_max,
+                      linkStats.marginTenths(link) / 10.0,
+                      adviceStr[static_cast<int>(linkStats.advice(link))]);
+
+        Serial.print("  rssi hist:");
+        for (auto count : link.rssi_hist) {
+            Serial.printf(" %u", count);
+        }
+
+        Serial.print("\n  snr hist:");
+        for (auto count : link.snr_hist) {
+            Serial.printf(" %u", count);
+        }
+        Serial.println();
+    }
+}
+
+/**
+ * @brief Accumulate characters from the serial console and run complete command lines.
+ */
+static void readSerialCommand(void) {
+    while (Serial.available() > 0) {
+        char c = static_cast<char>(Serial.read());
+
+        if (c == '\r' || c == '\n') {
+            if (serialLineLength > 0) {
+                serialLine[serialLineLength] = '\0';
+                handleSerialCommand(serialLine.data());
+                serialLineLength = 0;
             }
+        } else if (serialLineLength < (SERIAL_LINE_SIZE - 1)) {
+            serialLine[serialLineLength++] = c;
         }
+    }
+}
+
+/**
+ * @brief Run a serial console command.
+ *
+ * Supported commands:
+ *   link                                       Print the link statistics.
+ *   profile list                               List the radio profiles.
+ *   profile use <name>                         Select a radio profile.
+ *   profile save <name> <hz> <bw> <sf> <cr> [preamble]
+ *                                              Add or replace a user radio profile.
+ *   profile bench [seconds]                    Measure the capture rate of every profile.
+ *   profile uplink <name>                      Select the uplink profile of a relay.
+ *   capture start | stop | status              Record the received frames to flash.
+ *   capture dump                               Print the capture in hexadecimal.
+ *   capture replay [1x]                        Replay the capture at max speed, or in real time.
+ *
+ * @param line The command line, modified in place.
+ */
+static void handleSerialCommand(char *line) {
+    char *save    = nullptr;
+    char *command = strtok_r(line, " ", &save);
+    char *action  = strtok_r(nullptr, " ", &save);
+
+    if (command == nullptr) {
+        return;
+    }
+
+    if (strcmp(command, "link") == 0) {
+        xSemaphoreTake(radioMutex, portMAX_DELAY);
+        printLinkReport();
+        xSemaphoreGive(radioMutex);
+    } else if (strcmp(command, "capture") == 0 && action != nullptr) {
+        char *arg = strtok_r(nullptr, " ", &save);
+
+        if (strcmp(action, "start") == 0) {
+            if (!frameCapture.start()) {
+                Serial.println("Cannot start the capture");
+            }
+        } else if (strcmp(action, "stop") == 0) {
+            frameCapture.stop();
+        } else if (strcmp(action, "status") == 0) {
+            frameCapture.printStatus();
+        } else if (strcmp(action, "dump") == 0) {
+            frameCapture.dump();
+        } else if (strcmp(action, "replay") == 0) {
+            replayCapture(arg != nullptr && strcmp(arg, "1x") == 0);
+        } else {
+            Serial.println("Unknown capture command");
+        }
+    } else if (strcmp(command, "profile") == 0 && action != nullptr) {
+        char *arg = strtok_r(nullptr, " ", &save);
+
+        xSemaphoreTake(radioMutex, portMAX_DELAY);
+
+        if (strcmp(action, "list") == 0) {
+            radioProfiles.list();
+        } else if (strcmp(action, "use") == 0 && arg != nullptr) {
+            if (!radioProfiles.select(arg)) {
+                Serial.printf("Cannot select radio profile '%s'\n", arg);
+            }
+        } else if (strcmp(action, "save") == 0 && arg != nullptr) {
+            RadioProfile profile {};
+            std::array<uint32_t, 5> values {0, 0, 0, 0, 8};
+            size_t parsed {0};
+
+            strncpy(profile.name, arg, RADIO_PROFILE_NAME_LEN - 1);
+
+            for (char *value = strtok_r(nullptr, " ", &save);
+                 value != nullptr && parsed < values.size();
+                 value = strtok_r(nullptr, " ", &save)) {
+                values[parsed++] = strtoul(value, nullptr, 10);
+            }
+
+            profile.frequency        = values[0];
+            profile.bandwidth        = static_cast<uint8_t>(values[1]);
+            profile.spreading_factor = static_cast<uint8_t>(values[2]);
+            profile.coding_rate      = static_cast<uint8_t>(values[3]);
+            profile.preamble_length  = static_cast<uint16_t>(values[4]);
+
+            if (parsed < 4 || !radioProfiles.save(profile)) {
+                Serial.printf("Cannot save radio profile '%s'\n", profile.name);
+            }
+        } else if (strcmp(action, "bench") == 0) {
+            uint32_t seconds = (arg != nullptr) ? strtoul(arg, nullptr, 10) : 300;
+
+            if (!radioProfiles.startBenchmark(seconds * 1000)) {
+                Serial.println("Cannot start the radio profile benchmark");
+            }
+#ifdef BRIDGE_RELAY_MODE
+        } else if (strcmp(action, "uplink") == 0 && arg != nullptr) {
+            if (!radioProfiles.setUplink(arg)) {
+                Serial.printf("Cannot use radio profile '%s' for the uplink\n", arg);
+            }
+#endif
+        } else {
+            Serial.println("Unknown profile command");
+        }
+
+        xSemaphoreGive(radioMutex);
     } else {
-        Serial.printf("Decoding failed: %s\n", PB_GET_ERROR(&stream));
+        Serial.println("Unknown command");
     }
+}
 
-    digitalWrite(LED, HIGH);
-    Radio.Sleep();
-    lora_idle = true;
+#ifndef BRIDGE_RELAY_MODE
+/**
+ * @brief Queue a read of the remote configuration node on the uplink.
+ *
+ * The response is applied by applyRemoteProfile().
+ */
+static void pollRemoteProfile(void) {
+    rtdbUplink.fetch(radioProfilePath.c_str(), remoteProfile);
+}
+
+/**
+ * @brief Apply the radio profile requested by the remote configuration node.
+ *
+ * The profile is only selected when the requested name changes, so a profile that
+ * failed its probation is not reapplied on every poll.
+ *
+ * @param response The JSON value of the node: a string, or null if it is not set.
+ */
+static void applyRemoteProfile(const char *response) {
+    size_t length = strlen(response);
+
+    if (length < 3 || response[0] != '"' || response[length - 1] != '"' ||
+        length - 2 >= sizeof(remoteProfile)) {
+        return;
+    }
+
+    char requested[RADIO_PROFILE_NAME_LEN] {};
+    memcpy(requested, response + 1, length - 2);
+
+    if (strncmp(requested, remoteProfile, sizeof(remoteProfile)) == 0) {
+        return;
+    }
+
+    memcpy(remoteProfile, requested, sizeof(remoteProfile));
+
+    Serial.printf("Remote radio profile request: '%s'\n", remoteProfile);
+
+    xSemaphoreTake(radioMutex, portMAX_DELAY);
+
+    if (!radioProfiles.select(remoteProfile)) {
+        Serial.printf("Cannot select radio profile '%s'\n", remoteProfile);
+    }
+
+    xSemaphoreGive(radioMutex);
 }
+#endif
 
 /**
  * @brief Update the OLED display with the given packet ID, water level, RSSI and error count.
@@ -0,0 +1,88 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// packet_log.cpp - Implementation of the per-packet log.
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include "packet_log.h"         // NOLINT
+
+/**
+ * @brief Format a line and queue it for the loop task.
+ *
+ * Runs in the radio and uplink tasks. The line is formatted outside the
+ * spinlock, which is only held to take the entry and to queue it.
+ *
+ * @param format The printf format of the line.
+ */
+void PacketLog::printf(const char *format, ...) {
+    PacketLogEntry *entry = pool.acquire();
+
+    if (entry == nullptr) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(entry->text.data(), entry->text.size(), format, args);
+    va_end(args);
+
+    entry->length = std::min<size_t>(std::max(length, 0), entry->text.size() - 1);
+
+    portENTER_CRITICAL(&lock);
+    pending[(first + count) % PACKET_LOG_ENTRIES] = entry;
+    ++count;
+    portEXIT_CRITICAL(&lock);
+}
+
+/**
+ * @brief Print the waiting lines on the serial console and return their entries to the pool.
+ *
+ * Runs in the loop task.
+ */
+void PacketLog::flush() {
+    for (;;) {
+        PacketLogEntry *entry {nullptr};
+
+        portENTER_CRITICAL(&lock);
+        if (count > 0) {
+            entry = pending[first];
+            first = (first + 1) % PACKET_LOG_ENTRIES;
+            --count;
+        }
+        portEXIT_CRITICAL(&lock);
+
+        if (entry == nullptr) {
+            return;
+        }
+
+        Serial.write(reinterpret_cast<const uint8_t *>(entry->text.data()), entry->length);
+        pool.release(entry);
+    }
+}
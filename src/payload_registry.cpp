@@ -0,0 +1,121 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// payload_registry.cpp - Registry of the sensor payload types.
+//
+// Each payload type is a single entry of a constexpr table indexed by its
+// message type byte: the nanopb descriptor used to decode it, the RTDB node
+// it is written to, and two plain functions that extract the common header
+// and serialize the type specific fields. Supporting a new sensor type means
+// adding its message to lora_payload.proto and one entry to this table.
+
+#include <array>
+#include <cstdio>
+#include "json_writer.h"        // NOLINT
+#include "payload_registry.h"   // NOLINT
+
+/**
+ * @brief Format an unsigned value as a string field, the format used by the
+ *        water level node since the first sensors.
+ */
+static void setStringField(JsonWriter *json, const char *name, uint32_t value) {
+    std::array<char, 12> text;
+
+    snprintf(text.data(), text.size(), "%u", value);
+    json->addString(name, text.data());
+}
+
+static payload_header_t waterLevelHeader(const payload_body_t &body) {
+    return {body.water_level.sensor_id, body.water_level.id, body.water_level.err_sensor,
+            body.water_level.boot_id, body.water_level.has_sensor_id, body.water_level.has_boot_id};
+}
+
+static void waterLevelSerialize(const payload_body_t &body, JsonWriter *json) {
+    setStringField(json, "level", body.water_level.level);
+    setStringField(json, "distance", body.water_level.distance);
+    setStringField(json, "error", body.water_level.err_sensor);
+}
+
+static payload_header_t airHeader(const payload_body_t &body) {
+    return {body.air.sensor_id, body.air.id, body.air.err_sensor,
+            body.air.boot_id, body.air.has_sensor_id, body.air.has_boot_id};
+}
+
+static void airSerialize(const payload_body_t &body, JsonWriter *json) {
+    json->addTenths("temperature", body.air.temperature);
+    setStringField(json, "error", body.air.err_sensor);
+}
+
+// Indexed by PayloadTypeId.
+static constexpr std::array<PayloadType, PAYLOAD_TYPE_COUNT> PAYLOAD_TYPES = {{
+    //  name           fields              path                    header            serialize
+    {nullptr,       nullptr,            nullptr,                          nullptr,          nullptr},
+    {"water_level", LoraPayload_fields, "sensors/water_level/", waterLevelHeader, waterLevelSerialize},
+    {"air",         AirPayload_fields,  "sensors/air/",         airHeader,        airSerialize},
+}};
+
+/**
+ * @brief Look up a payload type.
+ *
+ * @param type The message type byte.
+ * @return The payload type, or nullptr if the type is unknown.
+ */
+const PayloadType *payloadType(uint8_t type) {
+    if (type >= PAYLOAD_TYPES.size() || PAYLOAD_TYPES[type].fields == nullptr) {
+        return nullptr;
+    }
+
+    return &PAYLOAD_TYPES[type];
+}
+
+/**
+ * @brief Split a frame into its message type and its encoded message.
+ *
+ * @param frame The received frame.
+ * @param size The size of the frame.
+ * @param[out] body The start of the encoded message.
+ * @param[out] bodySize The size of the encoded message.
+ * @return The message type, PAYLOAD_TYPE_NONE if the frame is empty.
+ */
+PayloadTypeId payloadFrameType(const uint8_t *frame, size_t size,
+                               const uint8_t **body, size_t *bodySize) {
+    if (size == 0) {
+        return PayloadTypeId::PAYLOAD_TYPE_NONE;
+    }
+
+    if (frame[0] == PAYLOAD_LEGACY_TAG) {
+        *body     = frame;
+        *bodySize = size;
+        return PayloadTypeId::PAYLOAD_TYPE_WATER_LEVEL;
+    }
+
+    *body     = frame + 1;
+    *bodySize = size - 1;
+
+    return static_cast<PayloadTypeId>(frame[0]);
+}
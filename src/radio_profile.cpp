@@ -0,0 +1,511 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// radio_profile.cpp - Implementation of the runtime-switchable radio profiles.
+//
+// A radio profile groups the settings that sensors and bridge must agree on
+// (frequency, bandwidth, spreading factor, coding rate and preamble length).
+// Profiles can be selected at runtime from the serial console or from the
+// remote configuration node, and are applied with Radio.SetRxConfig without
+// reflashing the bridge.
+//
+// The built-in benchmark steps through every profile for a fixed dwell time
+// and reports the packet capture rate measured with each one.
+//
+// A relay also transmits its batches with the uplink profile. It must be on
+// another channel than the active profile: on the same channel, the relays
+// would hear each other's batches along with the sensors, so it is rejected.
+// The bridge receiving the batches, built with BRIDGE_RELAY_UPSTREAM, listens
+// on the default uplink profile unless another profile is selected.
+
+#include <Arduino.h>
+#include <LoRaWan_APP.h>
+#include "radio_profile.h"      // NOLINT
+
+static constexpr char NVS_NAMESPACE[] {"radio"};
+static constexpr char NVS_KEY_VERSION[] {"version"};
+static constexpr char NVS_KEY_PROFILES[] {"profiles"};
+static constexpr char NVS_KEY_ACTIVE[] {"active"};
+static constexpr char NVS_KEY_UPLINK[] {"uplink"};
+
+// RADIO_PROFILE_DEFAULT is used when NVS holds nothing valid, and
+// RADIO_PROFILE_UPLINK is the default uplink of a relay.
+static const std::array<RadioProfile, RADIO_PROFILE_MAX_BUILTIN> BUILTIN_PROFILES = {{
+    //  name          frequency  bw  sf  cr  preamble
+    {"sf7bw125",    915000000,   0,  7,  1,  8},
+    {"sf7bw250",    915000000,   1,  7,  1,  8},
+    {"sf9bw125",    915000000,   0,  9,  1,  8},
+    {"sf12bw125",   915000000,   0, 12,  1,  8},
+    {"sf7bw125ch2", 903900000,   0,  7,  1,  8},    // Relay uplink channel
+}};
+
+/**
+ * @brief Constructs a RadioProfiles object.
+ *
+ * @param nvs Pointer to the Preferences object used to persist the profiles.
+ */
+RadioProfiles::RadioProfiles(Preferences *nvs) {
+    prefs = nvs;
+}
+
+/**
+ * @brief Load the profiles from NVS and apply the active one.
+ *
+ * User profiles that fail validation are dropped. If the stored active profile
+ * cannot be found, RADIO_PROFILE_DEFAULT is applied instead.
+ */
+void RadioProfiles::begin() {
+    std::copy(BUILTIN_PROFILES.begin(), BUILTIN_PROFILES.end(), profiles.begin());
+    count = RADIO_PROFILE_MAX_BUILTIN;
+
+    prefs->begin(NVS_NAMESPACE, false);
+
+    if (prefs->getUChar(NVS_KEY_VERSION, 0) == RADIO_PROFILE_NVS_VERSION) {
+        std::array<RadioProfile, RADIO_PROFILE_MAX_USER> stored {};
+        size_t length = prefs->getBytes(NVS_KEY_PROFILES, stored.data(), sizeof(stored));
+
+        for (size_t i = 0; i < length / sizeof(RadioProfile); ++i) {
+            if (isValid(stored[i]) && find(stored[i].name) < 0) {
+                profiles[count++] = stored[i];
+            }
+        }
+    }
+
+    char name[RADIO_PROFILE_NAME_LEN] {};
+    prefs->getString(NVS_KEY_ACTIVE, name, sizeof(name));
+
+    int index = find(name);
+
+    if (index < 0) {
+        Serial.printf("Radio profile '%s' not found, using '%s'\n", name, RADIO_PROFILE_DEFAULT);
+        index = std::max(find(RADIO_PROFILE_DEFAULT), 0);
+    }
+
+    fallback_index = static_cast<uint8_t>(index);
+    apply(static_cast<uint8_t>(index));
+
+    prefs->getString(NVS_KEY_UPLINK, name, sizeof(name));
+    index = find(name);
+
+    if (index < 0) {
+        index = std::max(find(RADIO_PROFILE_UPLINK), 0);
+    }
+
+    uplink_index = static_cast<uint8_t>(index);
+
+#ifdef BRIDGE_RELAY_MODE
+    if (!uplinkUsable()) {
+        Serial.printf("Uplink profile '%s' is on the receive channel, relaying stopped\n",
+                      profiles[uplink_index].name);
+    }
+#endif
+}
+
+/**
+ * @brief Check that a profile holds settings the radio can use.
+ *
+ * @param profile The profile to check.
+ * @return true if the profile is valid, false otherwise.
+ */
+bool RadioProfiles::isValid(const RadioProfile &profile) {
+    size_t nameLength = strnlen(profile.name, RADIO_PROFILE_NAME_LEN);
+
+    if (nameLength == 0 || nameLength == RADIO_PROFILE_NAME_LEN) {
+        return false;
+    }
+
+#ifdef REGION_US915
+    if (profile.frequency < 902000000 || profile.frequency > 928000000) {
+        return false;
+    }
+#endif
+
+    return profile.bandwidth <= 2 &&
+           profile.spreading_factor >= 7 && profile.spreading_factor <= 12 &&
+           profile.coding_rate >= 1 && profile.coding_rate <= 4 &&
+           profile.preamble_length >= 6;
+}
+
+/**
+ * @brief Find a profile by name.
+ *
+ * @param name The name of the profile.
+ * @return The index of the profile, or -1 if there is none with that name.
+ */
+int RadioProfiles::find(const char *name) const {
+    for (uint8_t i = 0; i < count; ++i) {
+        if (strncmp(profiles[i].name, name, RADIO_PROFILE_NAME_LEN) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Tell whether two profiles use the same channel.
+ *
+ * @param a The index of the first profile.
+ * @param b The index of the second profile.
+ */
+bool RadioProfiles::sameChannel(uint8_t a, uint8_t b) const {
+    return profiles[a].frequency == profiles[b].frequency;
+}
+
+/**
+ * @brief Configure the radio to receive with a profile and restart reception.
+ *
+ * The maximum payload length is bounded so the radio can drop oversized frames
+ * before they reach the decoder.
+ *
+ * @param index The index of the profile.
+ */
+void RadioProfiles::configureRx(uint8_t index) {
+    const RadioProfile &profile = profiles[index];
+
+    Radio.Standby();
+    Radio.SetChannel(profile.frequency);
+    Radio.SetRxConfig(MODEM_LORA,                   // modem
+                      profile.bandwidth,            // bandwidth
+                      profile.spreading_factor,     // datarate
+                      profile.coding_rate,          // coderate
+                      0,                            // bandwidthAfc
+                      profile.preamble_length,      // preambleLen
+                      LORA_SYMBOL_TIMEOUT,          // symbTimeout
+                      LORA_FIX_LENGTH_PAYLOAD_ON,   // fixLen
+                      0,                            // payloadLen
+                      true,                         // crcOn
+                      false,                        // freqHopOn
+                      0,                            // hopPeriod
+                      LORA_IQ_INVERSION_ON,         // iqInverted
+                      LORA_RX_CONTINUOUS);          // rxContinuous
+    Radio.SetMaxPayloadLength(MODEM_LORA, LORA_MAX_PAYLOAD_LENGTH);
+    Radio.Rx(0);
+}
+
+/**
+ * @brief Make a profile the active one and restart reception with it.
+ *
+ * @param index The index of the profile to apply.
+ */
+void RadioProfiles::apply(uint8_t index) {
+    const RadioProfile &profile = profiles[index];
+
+    configureRx(index);
+    active_index = index;
+
+    Serial.printf("Radio profile '%s': %u Hz, BW %u, SF%u, CR 4/%u, preamble %u\n",
+                  profile.name, profile.frequency, profile.bandwidth,
+                  profile.spreading_factor, profile.coding_rate + 4, profile.preamble_length);
+}
+
+/**
+ * @brief Select a profile by name.
+ *
+ * The profile is applied immediately but only persisted as the active profile
+ * once a packet has been decoded with it. If no packet is decoded within
+ * RADIO_PROFILE_PROBATION_MS, the previous profile is restored.
+ *
+ * A relay cannot receive on the channel of its uplink profile.
+ *
+ * @param name The name of the profile to select.
+ * @return true if the profile was applied, false if it is unknown, on the
+ *         uplink channel of a relay or a benchmark is running.
+ */
+bool RadioProfiles::select(const char *name) {
+    int index = find(name);
+
+    if (index < 0 || bench_running) {
+        return false;
+    }
+
+#ifdef BRIDGE_RELAY_MODE
+    if (sameChannel(static_cast<uint8_t>(index), uplink_index)) {
+        return false;
+    }
+#endif
+
+    if (index == active_index) {
+        return true;
+    }
+
+    if (!on_probation) {
+        fallback_index = active_index;
+    }
+
+    apply(static_cast<uint8_t>(index));
+
+    on_probation    = true;
+    probation_start = millis();
+
+    return true;
+}
+
+/**
+ * @brief Add or replace a user profile and persist it to NVS.
+ *
+ * Built-in profiles cannot be replaced, and the active profile cannot be modified
+ * while in use, nor can the uplink profile of a relay.
+ *
+ * @param profile The profile to save.
+ * @return true if the profile was saved, false otherwise.
+ */
+bool RadioProfiles::save(const RadioProfile &profile) {
+    if (!isValid(profile)) {
+        return false;
+    }
+
+    int index = find(profile.name);
+
+    if (index >= 0 && (index < RADIO_PROFILE_MAX_BUILTIN || index == active_index)) {
+        return false;
+    }
+
+#ifdef BRIDGE_RELAY_MODE
+    if (index == uplink_index) {
+        return false;
+    }
+#endif
+
+    if (index < 0) {
+        if (count >= RADIO_PROFILE_MAX) {
+            return false;
+        }
+
+        index = count++;
+    }
+
+    profiles[index] = profile;
+    persistUserProfiles();
+
+    return true;
+}
+
+/**
+ * @brief Write the user profiles to NVS.
+ */
+void RadioProfiles::persistUserProfiles() {
+    prefs->putUChar(NVS_KEY_VERSION, RADIO_PROFILE_NVS_VERSION);
+    prefs->putBytes(NVS_KEY_PROFILES, &profiles[RADIO_PROFILE_MAX_BUILTIN],
+                    (count - RADIO_PROFILE_MAX_BUILTIN) * sizeof(RadioProfile));
+}
+
+/**
+ * @brief Write the name of the active profile to NVS.
+ */
+void RadioProfiles::persistActive() {
+    prefs->putString(NVS_KEY_ACTIVE, profiles[active_index].name);
+}
+
+/**
+ * @brief Notify that a packet has been decoded with the active profile.
+ *
+ * Confirms a profile on probation and accounts the packet in the running benchmark.
+ *
+ * @param missed The number of packets missed before this one, from the packet sequence.
+ */
+void RadioProfiles::packetReceived(uint32_t missed) {
+    if (on_probation) {
+        on_probation = false;
+        persistActive();
+        Serial.printf("Radio profile '%s' confirmed\n", profiles[active_index].name);
+    }
+
+    if (bench_running) {
+        radio_bench_result_t &result = bench_results[bench_index];
+
+        // The gap seen by the first packet spans the previous profile's dwell time.
+        if (result.received > 0) {
+            result.missed += missed;
+        }
+
+        ++result.received;
+    }
+}
+
+/**
+ * @brief Run the probation timeout and the benchmark steps.
+ *
+ * @param now The current time, in milliseconds.
+ */
+void RadioProfiles::tick(uint32_t now) {
+    if (on_probation && (now - probation_start) > RADIO_PROFILE_PROBATION_MS) {
+        on_probation = false;
+        Serial.printf("No packet with radio profile '%s', falling back\n",
+                      profiles[active_index].name);
+        apply(fallback_index);
+    }
+
+    if (bench_running && (now - bench_start) >= bench_dwell_ms) {
+        if (++bench_index < count) {
+            bench_start = now;
+            apply(bench_index);
+        } else {
+            bench_running = false;
+            printBenchReport();
+            apply(bench_restore_index);
+        }
+    }
+}
+
+/**
+ * @brief Start the capture rate benchmark.
+ *
+ * Every profile is applied in turn for the given dwell time. The sensors must be
+ * switched along with the bridge for the results to be meaningful.
+ *
+ * @param dwellMs The time spent on each profile, in milliseconds.
+ * @return true if the benchmark started, false if a profile is on probation or a
+ *         benchmark is already running.
+ */
+bool RadioProfiles::startBenchmark(uint32_t dwellMs) {
+    if (on_probation || bench_running) {
+        return false;
+    }
+
+    bench_results.fill(radio_bench_result_t {});
+    bench_restore_index = active_index;
+    bench_dwell_ms      = std::max<uint32_t>(dwellMs, RADIO_PROFILE_BENCH_MIN_MS);
+    bench_index         = 0;
+    bench_start         = millis();
+    bench_running       = true;
+
+    apply(bench_index);
+
+    return true;
+}
+
+/**
+ * @brief Print the capture rate measured with each profile on the serial console.
+ */
+void RadioProfiles::printBenchReport() const {
+    Serial.println("Radio profile benchmark:");
+
+    for (uint8_t i = 0; i < count; ++i) {
+        const radio_bench_result_t &result = bench_results[i];
+        uint32_t expected = result.received + result.missed;
+
+        Serial.printf("  %-12s rx=%u missed=%u capture=%.1f %%\n",
+                      profiles[i].name, result.received, result.missed,
+                      expected > 0 ? (100.0F * result.received) / expected : 0.0F);
+    }
+}
+
+/**
+ * @brief Print every known profile on the serial console.
+ */
+void RadioProfiles::list() const {
+    for (uint8_t i = 0; i < count; ++i) {
+        const RadioProfile &profile = profiles[i];
+
+        const char *uplinkTag {""};
+
+#ifdef BRIDGE_RELAY_MODE
+        uplinkTag = (i == uplink_index) ? " (uplink)" : "";
+#endif
+
+        Serial.printf("%c %-12s %u Hz, BW %u, SF%u, CR 4/%u, preamble %u%s%s\n",
+                      i == active_index ? '*' : ' ',
+                      profile.name, profile.frequency, profile.bandwidth,
+                      profile.spreading_factor, profile.coding_rate + 4, profile.preamble_length,
+                      i < RADIO_PROFILE_MAX_BUILTIN ? " (built-in)" : "", uplinkTag);
+    }
+}
+
+/**
+ * @brief Select the uplink profile and persist it to NVS.
+ *
+ * @param name The name of the profile.
+ * @return true if the profile was selected, false if it is unknown or on the
+ *         channel of the active profile.
+ */
+bool RadioProfiles::setUplink(const char *name) {
+    int index = find(name);
+
+    if (index < 0 || sameChannel(static_cast<uint8_t>(index), active_index)) {
+        return false;
+    }
+
+    uplink_index = static_cast<uint8_t>(index);
+    prefs->putString(NVS_KEY_UPLINK, profiles[uplink_index].name);
+
+    return true;
+}
+
+/**
+ * @brief Tell whether the uplink profile can be used with the active profile.
+ *
+ * A benchmark or a fallback can apply a profile on the uplink channel, the
+ * relay then holds its batches until the active profile moves away from it.
+ */
+bool RadioProfiles::uplinkUsable() const {
+    return !sameChannel(uplink_index, active_index);
+}
+
+/**
+ * @brief Configure the radio to transmit with the uplink profile.
+ *
+ * The active profile is left unchanged: call resumeRx() once the transmission is
+ * done to return to it.
+ *
+ * @param power The output power, in dBm.
+ * @param timeoutMs The transmission timeout, in milliseconds.
+ * @return true if the radio was configured, false if the uplink profile is not usable.
+ */
+bool RadioProfiles::configureUplinkTx(int8_t power, uint32_t timeoutMs) {
+    if (!uplinkUsable()) {
+        return false;
+    }
+
+    const RadioProfile &profile = profiles[uplink_index];
+
+    Radio.Standby();
+    Radio.SetChannel(profile.frequency);
+    Radio.SetTxConfig(MODEM_LORA,                   // modem
+                      power,                        // power
+                      0,                            // fdev
+                      profile.bandwidth,            // bandwidth
+                      profile.spreading_factor,     // datarate
+                      profile.coding_rate,          // coderate
+                      profile.preamble_length,      // preambleLen
+                      LORA_FIX_LENGTH_PAYLOAD_ON,   // fixLen
+                      true,                         // crcOn
+                      false,                        // freqHopOn
+                      0,                            // hopPeriod
+                      LORA_IQ_INVERSION_ON,         // iqInverted
+                      timeoutMs);                   // timeout
+
+    return true;
+}
+
+/**
+ * @brief Return to reception with the active profile, after a transmission.
+ */
+void RadioProfiles::resumeRx() {
+    configureRx(active_index);
+}
@@ -0,0 +1,87 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// reading.cpp - Implementation of the JSON document of a sensor reading.
+//
+// The same document is written by the uplink task of the bridge, by the
+// capture replay and by the host benchmarks, see receive_pipeline.h.
+
+#include "reading.h"            // NOLINT
+#include "wall_clock.h"         // NOLINT
+
+// Database child nodes of a reading. The sensor fields are defined by the
+// payload registry, see payload_registry.cpp.
+constexpr char timePath[] {"timestamp"};
+constexpr char serverTimePath[] {"server_timestamp"};
+
+// Link quality child nodes
+constexpr char rssiPath[] {"rssi"};
+constexpr char snrPath[] {"snr"};
+constexpr char rssiAvgPath[] {"rssi_avg"};
+constexpr char snrAvgPath[] {"snr_avg"};
+constexpr char rssiMinPath[] {"rssi_min"};
+constexpr char rssiMaxPath[] {"rssi_max"};
+constexpr char marginPath[] {"link_margin"};
+constexpr char hopsPath[] {"hops"};
+
+/**
+ * @brief Write the fields of a reading as a JSON object.
+ *
+ * The type specific fields are written by the serializer of the payload
+ * registry.
+ *
+ * The reading is stamped with its capture time once the wall clock is
+ * synchronized, and with the server time before that. The server time is
+ * always stored as well, so the end-to-end latency of each record can be
+ * checked on the database side.
+ *
+ * @param reading The reading.
+ * @param json The JSON writer.
+ */
+void buildReadingJson(const SensorReading &reading, JsonWriter *json) {
+    const PayloadType *type = payloadType(static_cast<uint8_t>(reading.type));
+
+    type->serialize(reading.body, json);
+    json->addInt(rssiPath, reading.rssi);
+    json->addInt(snrPath, reading.snr);
+    json->addInt(rssiAvgPath, reading.rssi_avg);
+    json->addTenths(snrAvgPath, reading.snr_avg);
+    json->addInt(rssiMinPath, reading.rssi_min);
+    json->addInt(rssiMaxPath, reading.rssi_max);
+    json->addTenths(marginPath, reading.link_margin);
+    json->addInt(hopsPath, reading.hops);
+    int64_t capturedMs = monotonicToEpochMs(reading.captured_us);
+
+    if (capturedMs > 0) {
+        json->addInt(timePath, capturedMs);
+    } else {
+        json->addServerTimestamp(timePath);
+    }
+
+    json->addServerTimestamp(serverTimePath);
+}
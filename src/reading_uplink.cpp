@@ -0,0 +1,178 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// File description
+// =========================================================
+// reading_uplink.cpp - Implementation of the upload of the readings.
+//
+// A reading is copied once, from the receive pipeline into a pool record,
+// and written once, as JSON straight into the body of its uplink request.
+// The record stays out of the pool until its write is done, so the pool
+// size bounds the readings between the radio and the database: the queue,
+// plus the requests held by the uplink.
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include "reading_uplink.h"     // NOLINT
+#include "wall_clock.h"         // NOLINT
+
+/**
+ * @brief Create the queue of the readings and set the database path of the records.
+ *
+ * @param databasePath The database node of the records.
+ * @param bridgeId The ID of the bridge, in the keys of the records of anonymous frames.
+ * @param bootId The boot ID of the bridge, in the same keys.
+ * @return true if the queue was created.
+ */
+bool ReadingUplink::begin(const char *databasePath, uint32_t bridgeId, uint32_t bootId) {
+    database_path = databasePath;
+    bridge_id     = bridgeId;
+    boot_id       = bootId;
+
+    queue = xQueueCreate(UPLINK_QUEUE_LENGTH, sizeof(SensorReading *));
+
+    return queue != nullptr;
+}
+
+/**
+ * @brief Queue a reading for the uplink task.
+ *
+ * Runs in the radio task. The reading comes from the reading pool and is
+ * dropped if the pool or the queue is full.
+ *
+ * @param pipeline The pipeline of the reading, for its link statistics.
+ * @param received The reading, as given to the receive pipeline hooks.
+ */
+void ReadingUplink::queueReading(const ReceivePipeline &pipeline, const ReceivedReading &received) {
+    SensorReading *reading = pool.acquire();
+
+    if (reading == nullptr) {
+        ++drop_count;
+        return;
+    }
+
+    pipeline.fillReading(received, reading);
+
+    if (xQueueSend(queue, &reading, 0) != pdTRUE) {
+        pool.release(reading);
+        ++drop_count;
+    }
+}
+
+/**
+ * @brief Hand the queued readings to the uplink while it has room.
+ *
+ * Runs in the uplink task. When the database is slow or unreachable, the
+ * readings wait in the queue, then the pool runs out and the radio task
+ * drops the new ones.
+ */
+void ReadingUplink::submitQueued() {
+    SensorReading *reading {nullptr};
+
+    while (uplink->room() > 0 && xQueueReceive(queue, &reading, 0) == pdTRUE) {
+        submit(reading);
+    }
+}
+
+/**
+ * @brief Block until a reading is queued, or for a time.
+ *
+ * @param timeoutMs The longest wait.
+ */
+void ReadingUplink::waitQueued(uint32_t timeoutMs) {
+    SensorReading *reading {nullptr};
+
+    xQueuePeek(queue, &reading, pdMS_TO_TICKS(timeoutMs));
+}
+
+/**
+ * @brief Queue the write of a reading to the node of its sensor type in the Realtime Database.
+ *
+ * When the frame identifies its sensor, see payloadIdentified(), the record
+ * key is derived from the sensor ID, the boot ID and the packet ID rather
+ * than generated by a push, so bridges that hear the same sensor write the
+ * same record and the upload is idempotent. Other frames are keyed by this
+ * bridge, its boot and a record count: they are written once per bridge that
+ * hears them, as with a push, and never over another record. Either way, the
+ * key is fixed before the first attempt, which lets the uplink send a write
+ * again after a connection loss.
+ *
+ * The JSON document is written straight into the next uplink request.
+ *
+ * @param reading The reading to upload.
+ */
+void ReadingUplink::submit(SensorReading *reading) {
+    const PayloadType *type = payloadType(static_cast<uint8_t>(reading->type));
+    JsonWriter json(uplink->nextBody(), UPLINK_BODY_SIZE);
+
+    buildReadingJson(*reading, &json);
+
+    const PayloadHeader &header = reading->header;
+    std::array<char, UPLINK_PATH_SIZE> recordPath;
+
+    if (payloadIdentified(header)) {
+        snprintf(recordPath.data(), recordPath.size(), "%s/%s%u-%010u-%010u", database_path,
+                 type->path, header.sensor_id, header.boot_id, header.packet_id);
+    } else {
+        snprintf(recordPath.data(), recordPath.size(), "%s/%sb%06x-%08x-%010u", database_path,
+                 type->path, bridge_id & 0x00FFFFFF, boot_id, record_count++);
+    }
+
+    if (!uplink->submit(recordPath.data(), json.finish(), reading)) {
+        log->printf("Set json... too large\n");
+        pool.release(reading);
+        ++drop_count;
+    }
+}
+
+/**
+ * @brief Complete the write of a reading.
+ *
+ * Runs in the uplink task, from the done callback of the uplink. Returns the
+ * reading to the pool and folds the capture to acknowledgment latency into
+ * the statistics.
+ *
+ * @param reading The reading, the context of its write.
+ * @param status The HTTP status, or UPLINK_STATUS_FAILED.
+ */
+void ReadingUplink::done(SensorReading *reading, int status) {
+    if (status >= 200 && status < 300) {
+        log->printf("Set json... ok\n");
+
+        uint32_t latencyMs = static_cast<uint32_t>((monotonicUs() - reading->captured_us) / 1000);
+
+        latency_avg_ms = (latency_avg_ms == 0)
+                         ? latencyMs
+                         : latency_avg_ms + (static_cast<int32_t>(latencyMs - latency_avg_ms) / LATENCY_EWMA_WEIGHT);
+        latency_max_ms = std::max(latency_max_ms, latencyMs);
+    } else {
+        log->printf("Set json... failed (%d)\n", status);
+    }
+
+    pool.release(reading);
+}
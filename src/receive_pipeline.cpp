@@ -0,0 +1,452 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// receive_pipeline.cpp - Implementation of the receive pipeline.
+//
+// A frame goes through four stages:
+//   - decode: length check, type lookup and nanopb decoding in place. Relay
+//     batches are unpacked first, and each relayed frame goes through the
+//     pipeline again.
+//   - dedup:  link statistics, recent frame filter and packet sequence.
+//   - gui:    receive error count, level history and GUI data.
+//   - uplink: the reading hook, which queues the reading for the uplink task
+//     of a bridge or adds the frame to the pending batch of a relay.
+//
+// Nothing is allocated on the way: the decoded payload stays on the stack
+// and the reading hook gets a view of it, see ReceivedReading. A replay times
+// the stages with a StageTimer.
+
+#include <algorithm>
+#include <pb_decode.h>
+#include "receive_pipeline.h"   // NOLINT
+
+static const char *const STAGE_NAMES[] = {"decode", "dedup", "gui", "uplink"};
+
+static_assert(sizeof(STAGE_NAMES) / sizeof(STAGE_NAMES[0]) == static_cast<size_t>(ReceiveStage::COUNT),
+              "Every stage needs a name");
+
+/**
+ * @brief Reset the stage statistics and start timing.
+ *
+ * @param stageClock The clock, in nanoseconds.
+ */
+void StageTimer::enable(stage_clock_t stageClock) {
+    total_ns.fill(0);
+    max_ns.fill(0);
+    laps.fill(0);
+
+    clock = stageClock;
+    last  = clock();
+}
+
+/**
+ * @brief Start timing a frame.
+ */
+void StageTimer::mark() {
+    if (clock != nullptr) {
+        last = clock();
+    }
+}
+
+/**
+ * @brief Charge the time since the previous mark or lap to a stage.
+ *
+ * @param stage The stage that just ended.
+ */
+void StageTimer::lap(ReceiveStage stage) {
+    if (clock == nullptr) {
+        return;
+    }
+
+    int64_t now     = clock();
+    int64_t elapsed = now - last;
+    size_t  index   = static_cast<size_t>(stage);
+
+    total_ns[index] += elapsed;
+    max_ns[index]    = std::max(max_ns[index], elapsed);
+    ++laps[index];
+
+    last = now;
+}
+
+/**
+ * @brief Write the stage statistics as the "stages" member of a JSON object.
+ *
+ * @param json The JSON writer.
+ */
+void StageTimer::addJson(JsonWriter *json) const {
+    json->begin("stages");
+
+    for (size_t i = 0; i < STAGES; ++i) {
+        json->begin(STAGE_NAMES[i]);
+        json->addInt("n", laps[i]);
+        json->addInt("avg_ns", laps[i] > 0 ? total_ns[i] / laps[i] : 0);
+        json->addInt("max_ns", max_ns[i]);
+        json->end();
+    }
+
+    json->end();
+}
+
+/**
+ * @brief Constructor.
+ *
+ * @param receiveHooks The hooks called for each new reading.
+ * @param packetLog The log of the decoding errors, or nullptr.
+ */
+ReceivePipeline::ReceivePipeline(const ReceiveHooks &receiveHooks, PacketLog *packetLog)
+    : hooks(receiveHooks), log(packetLog) {}
+
+/**
+ * @brief Empty the receive state, as after boot.
+ *
+ * @param sf The spreading factor of the link margins.
+ */
+void ReceivePipeline::reset(uint8_t sf) {
+    link_stats = LinkStats(sf);
+#ifndef BRIDGE_NO_RECENT_FILTER
+    recent_frames = RecentFilter();
+#endif
+    level_history = LevelHistory();
+    counters      = ReceiveCounters {};
+
+    portENTER_CRITICAL(&gui_lock);
+    gui_data = OledGuiData {};
+    portEXIT_CRITICAL(&gui_lock);
+}
+
+/**
+ * @brief Run a received frame through the pipeline.
+ *
+ * Frames longer than LORA_MAX_PAYLOAD_LENGTH are rejected before decoding,
+ * whether the radio let them through or a capture holds them.
+ *
+ * @param frame The frame.
+ * @param size The size of the frame.
+ * @param rssi The RSSI value of the frame.
+ * @param snr The SNR value of the frame.
+ * @param capturedUs The capture time of the frame, see wall_clock.h.
+ */
+void ReceivePipeline::receive(const uint8_t *frame, size_t size, int16_t rssi, int8_t snr,
+                              int64_t capturedUs) {
+    ++counters.frames;
+
+    if (timer != nullptr) {
+        timer->mark();
+    }
+
+    if (size > LORA_MAX_PAYLOAD_LENGTH) {
+        ++counters.oversize;
+        return;
+    }
+
+    decodeFrame(frame, size, rssi, snr, capturedUs, 0);
+}
+
+/**
+ * @brief Decode a frame and dispatch it according to its message type.
+ *
+ * Sensor frames are decoded with the nanopb descriptor of their type in the
+ * payload registry. The dispatch is a table lookup: no virtual call and no
+ * heap allocation. Relay batches are unpacked, and each relayed frame goes
+ * through this function again; builds that do not receive relay batches take
+ * them as an unknown type. Any other frame longer than a sensor frame is
+ * rejected, whatever the radio accepts.
+ *
+ * @param frame The frame.
+ * @param size The size of the frame.
+ * @param rssi The RSSI value of the frame, at the first bridge that heard it.
+ * @param snr The SNR value of the frame, at the first bridge that heard it.
+ * @param capturedUs The capture time of the frame, see wall_clock.h.
+ * @param hops The number of relays the frame went through.
+ */
+void ReceivePipeline::decodeFrame(const uint8_t *frame, size_t size, int16_t rssi, int8_t snr,
+                                  int64_t capturedUs, uint32_t hops) {
+    const uint8_t *body {nullptr};
+    size_t bodySize {0};
+
+    PayloadTypeId typeId = payloadFrameType(frame, size, &body, &bodySize);
+
+    if (typeId == PayloadTypeId::PAYLOAD_TYPE_RELAY_BATCH && hops == 0 && LORA_RELAY_BATCHES) {
+        unpackRelayBatch(body, bodySize, rssi, snr, capturedUs);
+        return;
+    }
+
+    if (size > LORA_SENSOR_MAX_PAYLOAD) {
+        ++counters.oversize;
+        return;
+    }
+
+    const PayloadType *type = payloadType(static_cast<uint8_t>(typeId));
+
+    if (type == nullptr) {
+        ++counters.unknown;
+
+        if (log != nullptr) {
+            log->printf("Unknown payload type: %u\n", static_cast<uint8_t>(typeId));
+        }
+        return;
+    }
+
+    /* Allocate space for the decoded message. */
+    PayloadBody decoded {};
+
+    /* Create a stream that reads directly from the frame. */
+    pb_istream_t stream = pb_istream_from_buffer(body, bodySize);
+
+    /* Now we are ready to decode the message. */
+    if (!pb_decode(&stream, type->fields, &decoded)) {
+        ++counters.undecodable;
+
+        if (log != nullptr) {
+            log->printf("Decoding failed: %s\n", PB_GET_ERROR(&stream));
+        }
+        return;
+    }
+
+    lap(ReceiveStage::DECODE);
+
+    ReceivedReading reading {};
+
+    reading.type        = typeId;
+    reading.header      = type->header(decoded);
+    reading.body        = &decoded;
+    reading.frame       = frame;
+    reading.size        = size;
+    reading.rssi        = rssi;
+    reading.snr         = snr;
+    reading.captured_us = capturedUs;
+    reading.hops        = hops;
+
+    processPayload(&reading);
+}
+
+/**
+ * @brief Unpack a relay batch and decode each relayed frame.
+ *
+ * The batch sequence is tracked like a sensor's, so the link statistics show
+ * the batches lost between the relay and this bridge. The capture time of
+ * each frame is moved back by the time it was held by the relays, but not
+ * before the boot of this bridge.
+ *
+ * @param body The encoded RelayBatch message.
+ * @param bodySize The size of the encoded message.
+ * @param rssi The RSSI value of the relay frame.
+ * @param snr The SNR value of the relay frame.
+ * @param capturedUs The capture time of the relay frame, see wall_clock.h.
+ */
+void ReceivePipeline::unpackRelayBatch(const uint8_t *body, size_t bodySize, int16_t rssi, int8_t snr,
+                                       int64_t capturedUs) {
+    RelayBatch batch = RelayBatch_init_zero;
+    pb_istream_t stream = pb_istream_from_buffer(body, bodySize);
+
+    if (!pb_decode(&stream, RelayBatch_fields, &batch)) {
+        ++counters.undecodable;
+
+        if (log != nullptr) {
+            log->printf("Relay batch decoding failed: %s\n", PB_GET_ERROR(&stream));
+        }
+        return;
+    }
+
+    uint64_t source = payloadSource(PayloadTypeId::PAYLOAD_TYPE_RELAY_BATCH, batch.relay_id);
+    uint32_t missed {0};
+
+    link_stats.update(source, rssi, snr);
+
+    if (!link_stats.sequence(source, batch.seq, &missed)) {
+        return;
+    }
+
+    for (pb_size_t i = 0; i < batch.entries_count; ++i) {
+        const RelayEntry &entry = batch.entries[i];
+
+        int64_t entryUs = std::max<int64_t>(capturedUs - static_cast<int64_t>(entry.age_ms) * 1000, 0);
+
+        decodeFrame(entry.frame.bytes, entry.frame.size,
+                    static_cast<int16_t>(entry.rssi), static_cast<int8_t>(entry.snr),
+                    entryUs, std::max<uint32_t>(entry.hops, 1));
+    }
+}
+
+/**
+ * @brief Handle a decoded payload.
+ *
+ * Folds the RSSI and SNR into the link statistics of the sensor, drops the
+ * frames already seen recently or repeated, updates the history and the GUI
+ * data, then hands the reading to the hooks.
+ *
+ * @param reading The reading, its link statistics and missed count are set here.
+ */
+void ReceivePipeline::processPayload(ReceivedReading *reading) {
+    const PayloadHeader &header = reading->header;
+    uint64_t source = payloadSource(reading->type, header.sensor_id);
+
+    reading->link = link_stats.update(source, reading->rssi, reading->snr);
+
+#ifndef BRIDGE_NO_RECENT_FILTER
+    // Frames without a sensor ID all share sensor 0, their packet IDs collide.
+    if (header.has_sensor_id &&
+        !recent_frames.insert(RecentFilter::frameKey(source, header.boot_id, header.packet_id))) {
+        ++counters.suppressed;
+        return;
+    }
+#endif
+
+    if (!link_stats.sequence(source, header.packet_id, &reading->missed)) {
+        return;
+    }
+
+    lap(ReceiveStage::DEDUP);
+
+    if (reading->missed > 0) {
+        ++counters.errors;
+        counters.missed += reading->missed;
+    }
+
+    bool waterLevel = reading->type == PayloadTypeId::PAYLOAD_TYPE_WATER_LEVEL;
+
+    // Frames without a sensor ID cannot be told apart, so they stay out of the history.
+    if (waterLevel && header.has_sensor_id) {
+        level_history.update(source, reading->body->water_level.level, reading->captured_us);
+    }
+
+    portENTER_CRITICAL(&gui_lock);
+    if (waterLevel) {
+        gui_data.info.water_level = reading->body->water_level.level;
+    }
+    gui_data.stats.received_packet_id  = header.packet_id;
+    gui_data.stats.receive_error_count = counters.errors;
+    gui_data.stats.sensor_error_count  = header.err_sensor;
+    gui_data.stats.rssi = reading->rssi;
+    gui_data.stats.snr  = reading->snr;
+    gui_data.stats.link_margin = link_stats.marginTenths(*reading->link);
+    portEXIT_CRITICAL(&gui_lock);
+
+    if (hooks.gui != nullptr) {
+        hooks.gui(*reading);
+    }
+
+    lap(ReceiveStage::GUI);
+
+    ++counters.readings;
+
+    if (hooks.reading != nullptr) {
+        hooks.reading(*reading);
+    }
+
+    lap(ReceiveStage::UPLINK);
+}
+
+/**
+ * @brief Charge the time since the previous stage to a stage, when timed.
+ */
+void ReceivePipeline::lap(ReceiveStage stage) {
+    if (timer != nullptr) {
+        timer->lap(stage);
+    }
+}
+
+/**
+ * @brief Fill the uplink record of a reading.
+ *
+ * @param received The reading, as given to the hooks.
+ * @param reading The record to fill.
+ */
+void ReceivePipeline::fillReading(const ReceivedReading &received, SensorReading *reading) const {
+    const link_stats_t &link = *received.link;
+
+    reading->type        = received.type;
+    reading->header      = received.header;
+    reading->body        = *received.body;
+    reading->rssi        = received.rssi;
+    reading->snr         = received.snr;
+    reading->rssi_avg    = link_stats.rssiAverage(link);
+    reading->rssi_min    = link.rssi_min;
+    reading->rssi_max    = link.rssi_max;
+    reading->snr_avg     = link_stats.snrAverageTenths(link);
+    reading->link_margin = link_stats.marginTenths(link);
+    reading->captured_us = received.captured_us;
+    reading->hops        = static_cast<uint8_t>(received.hops);
+}
+
+/**
+ * @brief Copy the GUI data, except the history, which is copied under the radio mutex.
+ *
+ * @param data The GUI data of the display task.
+ */
+void ReceivePipeline::copyGui(OledGuiData *data) {
+    portENTER_CRITICAL(&gui_lock);
+    data->info  = gui_data.info;
+    data->stats = gui_data.stats;
+    portEXIT_CRITICAL(&gui_lock);
+}
+
+/**
+ * @brief Write the result of a replay as one JSON line.
+ *
+ * The bridge and the host benchmark print the same members: the frame count,
+ * the duration and throughput, the time spent in each stage, the allocations
+ * during the replay, then the counters, the GUI data and the history of the
+ * last pass, as a check that every stage ran.
+ *
+ * @param result The replay result.
+ * @param text The buffer.
+ * @param size The size of the buffer.
+ * @return The length of the document, 0 if it does not fit.
+ */
+size_t ReceivePipeline::replayJson(const ReplayResult &result, char *text, size_t size) const {
+    JsonWriter json(text, size);
+    int64_t durationUs = std::max<int64_t>(result.duration_us, 1);
+
+    json.addString("replay", result.real_time ? "1x" : "max");
+    json.addInt("frames", result.frames);
+    json.addInt("passes", result.passes);
+    json.addInt("duration_ms", durationUs / 1000);
+    json.addInt("frames_per_s", static_cast<int64_t>(result.frames) * 1000000 / durationUs);
+
+    if (timer != nullptr) {
+        timer->addJson(&json);
+    }
+
+    json.addInt("allocations", result.allocations);
+
+    json.begin("pass");
+    json.addInt("readings", counters.readings);
+    json.addInt("errors", counters.errors);
+    json.addInt("missed", counters.missed);
+    json.addInt("suppressed", counters.suppressed);
+    json.addInt("unknown", counters.unknown);
+    json.addInt("oversize", counters.oversize);
+    json.addInt("undecodable", counters.undecodable);
+    json.addInt("gui_packet_id", gui_data.stats.received_packet_id);
+    json.addInt("history_sensors", level_history.count());
+    json.end();
+
+    return json.finish();
+}
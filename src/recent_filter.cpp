@@ -0,0 +1,125 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// recent_filter.cpp - Implementation of the recently-seen frame filter.
+//
+// Keys live in a linear probing hash table kept at most half full. The
+// insertion order is kept in a ring so the oldest key can be evicted, and
+// evicted keys are removed with backward shift deletion, so the table never
+// fills up with tombstones.
+
+#include "recent_filter.h"      // NOLINT
+
+constexpr size_t TABLE_MASK {RECENT_FILTER_TABLE_SIZE - 1};
+
+/**
+ * @brief Return the home slot of a key (Fibonacci hashing).
+ */
+size_t RecentFilter::home(uint64_t key) {
+    return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> (64 - RECENT_FILTER_TABLE_BITS));
+}
+
+/**
+ * @brief Find the slot holding a key.
+ *
+ * @param key The key.
+ * @return The slot index, or -1 if the key is not in the table.
+ */
+int RecentFilter::find(uint64_t key) const {
+    if (key == 0) {
+        return -1;
+    }
+
+    for (size_t i = home(key); table[i] != 0; i = (i + 1) & TABLE_MASK) {
+        if (table[i] == key) {
+            return static_cast<int>(i);
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Remove a key, shifting back the keys that probed past it.
+ *
+ * @param key The key.
+ */
+void RecentFilter::remove(uint64_t key) {
+    int found = find(key);
+
+    if (found < 0) {
+        return;
+    }
+
+    size_t hole = static_cast<size_t>(found);
+    table[hole] = 0;
+
+    for (size_t i = (hole + 1) & TABLE_MASK; table[i] != 0; i = (i + 1) & TABLE_MASK) {
+        size_t slot = home(table[i]);
+
+        // Move the key into the hole unless its home lies cyclically in (hole, i].
+        bool reachable = (hole <= i) ? (slot > hole && slot <= i) : (slot > hole || slot <= i);
+
+        if (!reachable) {
+            table[hole] = table[i];
+            table[i]    = 0;
+            hole        = i;
+        }
+    }
+}
+
+/**
+ * @brief Insert a key, forgetting the oldest key if the filter is full.
+ *
+ * @param key The key, 0 is ignored.
+ * @return true if the key was inserted, false if it was already present.
+ */
+bool RecentFilter::insert(uint64_t key) {
+    if (key == 0 || contains(key)) {
+        return false;
+    }
+
+    if (count == RECENT_FILTER_CAPACITY) {
+        remove(fifo[next]);
+    } else {
+        ++count;
+    }
+
+    fifo[next] = key;
+    next = (next + 1) % RECENT_FILTER_CAPACITY;
+
+    size_t i = home(key);
+
+    while (table[i] != 0) {
+        i = (i + 1) & TABLE_MASK;
+    }
+
+    table[i] = key;
+
+    return true;
+}
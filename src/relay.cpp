@@ -0,0 +1,158 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// relay.cpp - Implementation of the relay aggregator.
+//
+// A bridge built with BRIDGE_RELAY_MODE has no internet uplink. It listens
+// to the sensors on its own radio profile, drops repeated frames, and
+// forwards what it hears to an upstream bridge on the uplink radio profile,
+// several frames at a time. The upstream bridge unpacks the batches and
+// feeds the frames to its normal upload path.
+
+#include <algorithm>
+#include <pb_encode.h>
+#include "payload_registry.h"   // NOLINT
+#include "relay.h"              // NOLINT
+
+static_assert(1 + RelayBatch_size <= LORA_RELAY_MAX_PAYLOAD,
+              "A full relay batch must fit in a relay frame");
+static_assert(sizeof(RelayEntry_frame_t::bytes) >= LORA_SENSOR_MAX_PAYLOAD,
+              "A relay entry must hold any sensor frame");
+
+constexpr auto RELAY_HOLD_EWMA_WEIGHT {8};
+
+/**
+ * @brief Start a new relay session.
+ *
+ * @param relayId The identifier of this relay, reported in every batch.
+ */
+void RelayAggregator::begin(uint32_t relayId) {
+    batch = RelayBatch_init_zero;
+    batch.relay_id = relayId;
+}
+
+/**
+ * @brief Add a frame to the pending batch.
+ *
+ * @param frame The sensor frame, as received.
+ * @param size The size of the frame.
+ * @param rssi The RSSI of the frame at the first relay.
+ * @param snr The SNR of the frame at the first relay.
+ * @param hops The number of relays the frame already went through.
+ * @param capturedUs The capture time of the frame, see wall_clock.h.
+ * @return true if the frame was added, false if it was dropped.
+ */
+bool RelayAggregator::add(const uint8_t *frame, size_t size, int16_t rssi, int8_t snr,
+                          uint32_t hops, int64_t capturedUs) {
+    ++stats.frames_in;
+
+    if (batch.entries_count >= RELAY_MAX_ENTRIES ||
+        size > sizeof(batch.entries[0].frame.bytes) ||
+        hops >= RELAY_MAX_HOPS) {
+        ++stats.frames_dropped;
+        return false;
+    }
+
+    RelayEntry &entry = batch.entries[batch.entries_count];
+
+    std::copy_n(frame, size, entry.frame.bytes);
+    entry.frame.size = static_cast<pb_size_t>(size);
+    entry.rssi       = rssi;
+    entry.snr        = snr;
+    entry.hops       = hops + 1;
+
+    captured_us[batch.entries_count++] = capturedUs;
+
+    return true;
+}
+
+/**
+ * @brief Tell whether the pending batch should be sent.
+ *
+ * @param now The current monotonic time, see wall_clock.h.
+ */
+bool RelayAggregator::ready(int64_t now) const {
+    if (batch.entries_count == 0) {
+        return false;
+    }
+
+    return batch.entries_count >= RELAY_MAX_ENTRIES ||
+           (now - captured_us[0]) >= (static_cast<int64_t>(RELAY_MAX_HOLD_MS) * 1000);
+}
+
+/**
+ * @brief Encode the pending batch as a relay frame and start a new batch.
+ *
+ * The age of each entry, the time it was held by this relay and the ones
+ * before, is clamped to [0, RELAY_MAX_AGE_MS].
+ *
+ * @param buffer The buffer receiving the frame.
+ * @param size The size of the buffer.
+ * @param now The current monotonic time, see wall_clock.h.
+ * @return The size of the frame, or 0 if the batch could not be encoded.
+ */
+size_t RelayAggregator::encode(uint8_t *buffer, size_t size, int64_t now) {
+    if (size < 1) {
+        return 0;
+    }
+
+    for (pb_size_t i = 0; i < batch.entries_count; ++i) {
+        // A frame stamped after now, or held across a long radio profile
+        // change, reports an age within range instead of a wrapped one.
+        int64_t heldMs  = (now - captured_us[i]) / 1000;
+        uint32_t holdMs = static_cast<uint32_t>(std::min<int64_t>(std::max<int64_t>(heldMs, 0),
+                                                                  RELAY_MAX_AGE_MS));
+
+        batch.entries[i].age_ms = holdMs;
+        stats.hold_avg_ms = (stats.hold_avg_ms == 0)
+                            ? holdMs
+                            : stats.hold_avg_ms + (static_cast<int32_t>(holdMs - stats.hold_avg_ms) /
+                                                   RELAY_HOLD_EWMA_WEIGHT);
+    }
+
+    buffer[0] = static_cast<uint8_t>(PayloadTypeId::PAYLOAD_TYPE_RELAY_BATCH);
+
+    pb_ostream_t stream = pb_ostream_from_buffer(buffer + 1, size - 1);
+    bool encoded = pb_encode(&stream, RelayBatch_fields, &batch);
+
+    if (encoded) {
+        ++stats.batches_out;
+        stats.entries_out += batch.entries_count;
+    } else {
+        stats.frames_dropped += batch.entries_count;
+    }
+
+    uint32_t relayId = batch.relay_id;
+    uint32_t seq     = batch.seq;
+
+    batch = RelayBatch_init_zero;
+    batch.relay_id = relayId;
+    batch.seq      = seq + 1;
+
+    return encoded ? 1 + stream.bytes_written : 0;
+}
@@ -0,0 +1,412 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// rtdb_uplink.cpp - Implementation of the asynchronous RTDB uplink.
+//
+// The Firebase client blocks its caller until the response arrives, for up to
+// config.timeout.serverResponse. The uplink talks to the Realtime Database
+// REST API directly instead: it keeps one TLS connection open, pipelines
+// HTTP/1.1 PUT requests on it, and parses the responses as their bytes come
+// in. The Firebase client is still used to get the ID token. The few reads of
+// the bridge go through the same connection as GET requests, so the bridge
+// keeps a single TLS session to the database.
+//
+// Each write is answered with ?print=silent, so a successful write returns
+// a 204 without a body.
+//
+// The server certificate is checked against the roots of root_ca.cpp. The ID
+// token goes in the auth query parameter, the only way the REST API takes a
+// Firebase ID token, the Authorization header being for OAuth2 access tokens.
+// The request lines are never printed, so the token stays off the console and
+// the packet log.
+
+#include <algorithm>
+#include <cstring>
+#include <WiFi.h>
+#include "root_ca.h"            // NOLINT
+#include "rtdb_uplink.h"        // NOLINT
+
+constexpr auto UPLINK_RTT_EWMA_WEIGHT {8};
+
+/**
+ * @brief Set the database the uplink writes to.
+ *
+ * @param databaseUrl The URL of the database, with or without the scheme.
+ */
+void RtdbUplink::begin(const char *databaseUrl) {
+    const char *start = strstr(databaseUrl, "://");
+    start = (start != nullptr) ? start + 3 : databaseUrl;
+
+    size_t length = strcspn(start, "/");
+    length = std::min(length, host.size() - 1);
+
+    memcpy(host.data(), start, length);
+    host[length] = '\0';
+
+    client.setCACert(ROOT_CA_PEM);
+    client.setHandshakeTimeout(UPLINK_CONNECT_TIMEOUT_MS / 1000);
+}
+
+/**
+ * @brief Set the ID token sent with every request.
+ *
+ * @param idToken The Firebase ID token.
+ */
+void RtdbUplink::setToken(const char *idToken) {
+    if (idToken == nullptr || strlen(idToken) >= token.size()) {
+        Serial.println("Uplink: invalid token");
+        return;
+    }
+
+    if (strcmp(idToken, token.data()) != 0) {
+        strcpy(token.data(), idToken);
+    }
+}
+
+/**
+ * @brief Return the body buffer of the next request.
+ *
+ * The caller serializes the document in place, then queues the request with
+ * submit(), so a record goes from its fields to the request without a copy
+ * nor a heap buffer.
+ *
+ * @return The buffer, UPLINK_BODY_SIZE bytes, or nullptr if the uplink is full.
+ */
+char *RtdbUplink::nextBody() {
+    if (count >= UPLINK_MAX_PENDING) {
+        return nullptr;
+    }
+
+    return requests[(first + count) % UPLINK_MAX_PENDING].body.data();
+}
+
+/**
+ * @brief Queue a write of the JSON document held by the next request to a database path.
+ *
+ * The path is copied, so the caller can reuse its buffer.
+ *
+ * @param path The database path, without the leading slash nor the .json suffix.
+ * @param length The length of the document written to nextBody().
+ * @param context Handed back to the done callback.
+ * @return true if the request was queued, false if the uplink is full or the
+ *         request too large.
+ */
+bool RtdbUplink::submit(const char *path, size_t length, void *context) {
+    if (count >= UPLINK_MAX_PENDING || length == 0 || length > UPLINK_BODY_SIZE ||
+        strlen(path) >= UPLINK_PATH_SIZE) {
+        return false;
+    }
+
+    UplinkRequest &request = requests[(first + count) % UPLINK_MAX_PENDING];
+
+    strcpy(request.path.data(), path);
+    request.body_length = length;
+    request.context     = context;
+    request.sent_ms     = 0;
+    request.retries     = 0;
+    request.fetch       = false;
+
+    ++count;
+    ++stats.requests;
+
+    return true;
+}
+
+/**
+ * @brief Queue a read of a database path.
+ *
+ * The response body, up to UPLINK_BODY_SIZE - 1 bytes, is handed to the done
+ * callback.
+ *
+ * @param path The database path, without the leading slash nor the .json suffix.
+ * @param context Handed back to the done callback.
+ * @return true if the request was queued, false if the uplink is full or the
+ *         path too long.
+ */
+bool RtdbUplink::fetch(const char *path, void *context) {
+    if (count >= UPLINK_MAX_PENDING || strlen(path) >= UPLINK_PATH_SIZE) {
+        return false;
+    }
+
+    UplinkRequest &request = requests[(first + count) % UPLINK_MAX_PENDING];
+
+    strcpy(request.path.data(), path);
+    request.body_length = 0;
+    request.context     = context;
+    request.sent_ms     = 0;
+    request.retries     = 0;
+    request.fetch       = true;
+
+    ++count;
+    ++stats.requests;
+
+    return true;
+}
+
+/**
+ * @brief Make progress: connect, read the responses, check the timeout and send.
+ *
+ * Never waits for the server, except for the TLS handshake of a new
+ * connection, at most UPLINK_CONNECT_TIMEOUT_MS. Called from the uplink task.
+ *
+ * @param authorized true if the token is valid. Without it, the uplink neither
+ *        connects nor sends, it only reads the responses still due.
+ */
+void RtdbUplink::poll(bool authorized) {
+    if (!client.connected()) {
+        if (in_flight > 0) {
+            fail(in_flight);
+        }
+
+        if (count == 0 || !authorized || !connect()) {
+            return;
+        }
+    }
+
+    receive();
+
+    if (in_flight > 0 && (millis() - requests[first].sent_ms) > UPLINK_RESPONSE_TIMEOUT_MS) {
+        ++stats.timeouts;
+        fail(in_flight);
+        return;
+    }
+
+    if (authorized) {
+        send();
+    }
+}
+
+/**
+ * @brief Open the connection to the database.
+ *
+ * @return true if connected.
+ */
+bool RtdbUplink::connect() {
+    if (token[0] == '\0' || WiFi.status() != WL_CONNECTED ||
+        (last_connect != 0 && (millis() - last_connect) < UPLINK_RECONNECT_PERIOD_MS)) {
+        return false;
+    }
+
+    last_connect = millis();
+
+    if (!client.connect(host.data(), UPLINK_PORT, UPLINK_CONNECT_TIMEOUT_MS)) {
+        Serial.printf("Uplink: cannot connect to %s\n", host.data());
+        return false;
+    }
+
+    ++stats.connections;
+    parse       = Parse::STATUS;
+    line_length = 0;
+
+    return true;
+}
+
+/**
+ * @brief Close the connection. The requests in flight are sent again on the next one.
+ */
+void RtdbUplink::disconnect() {
+    client.stop();
+    in_flight   = 0;
+    parse       = Parse::STATUS;
+    line_length = 0;
+    close_after = false;
+}
+
+/**
+ * @brief Close the connection after a failure, count a failed attempt of every
+ *        request sent on it, and give up on those past UPLINK_MAX_RETRIES.
+ *
+ * The requests are always sent in order, so a request has been through at
+ * least as many attempts as the ones behind it, and those given up on are
+ * always at the head of the queue.
+ *
+ * @param attempted The number of requests sent, or being sent, on the connection.
+ */
+void RtdbUplink::fail(size_t attempted) {
+    disconnect();
+
+    for (size_t i = 0; i < std::min(attempted, count); ++i) {
+        ++requests[(first + i) % UPLINK_MAX_PENDING].retries;
+    }
+
+    while (count > 0 && requests[first].retries > UPLINK_MAX_RETRIES) {
+        complete(UPLINK_STATUS_FAILED);
+    }
+}
+
+/**
+ * @brief Send the queued requests, up to UPLINK_MAX_IN_FLIGHT without a response.
+ */
+void RtdbUplink::send() {
+    while (in_flight < count && in_flight < UPLINK_MAX_IN_FLIGHT) {
+        UplinkRequest &request = requests[(first + in_flight) % UPLINK_MAX_PENDING];
+        int length {0};
+
+        if (request.fetch) {
+            request.body_length = 0;
+            length = snprintf(head.data(), head.size(),
+                              "GET /%s.json?auth=%s HTTP/1.1\r\n"
+                              "Host: %s\r\n"
+                              "\r\n",
+                              request.path.data(), token.data(), host.data());
+        } else {
+            length = snprintf(head.data(), head.size(),
+                              "PUT /%s.json?print=silent&auth=%s HTTP/1.1\r\n"
+                              "Host: %s\r\n"
+                              "Content-Type: application/json\r\n"
+                              "Content-Length: %u\r\n"
+                              "\r\n",
+                              request.path.data(), token.data(), host.data(),
+                              static_cast<unsigned>(request.body_length));
+        }
+
+        size_t bodyLength = request.fetch ? 0 : request.body_length;
+
+        if (client.write(reinterpret_cast<const uint8_t *>(head.data()), length) != static_cast<size_t>(length) ||
+            client.write(reinterpret_cast<const uint8_t *>(request.body.data()), bodyLength) != bodyLength) {
+            fail(in_flight + 1);
+            return;
+        }
+
+        request.sent_ms = millis();
+        ++in_flight;
+        stats.in_flight_max = std::max<uint32_t>(stats.in_flight_max, in_flight);
+    }
+}
+
+/**
+ * @brief Read the bytes received so far and complete the requests answered.
+ */
+void RtdbUplink::receive() {
+    while (client.available() > 0) {
+        int c = client.read();
+
+        if (c < 0) {
+            break;
+        }
+
+        if (parse == Parse::BODY) {
+            UplinkRequest &request = requests[first];
+
+            if (in_flight > 0 && request.fetch && request.body_length < request.body.size() - 1) {
+                request.body[request.body_length++] = static_cast<char>(c);
+            }
+
+            if (--body_left == 0) {
+                responseDone();
+            }
+        } else if (c == '\n') {
+            parseLine();
+            line_length = 0;
+        } else if (c != '\r' && line_length < line.size() - 1) {
+            line[line_length++] = static_cast<char>(c);
+        }
+    }
+}
+
+/**
+ * @brief Parse the status line or a header line of a response.
+ *
+ * Only the status, the content length and the connection header are kept.
+ */
+void RtdbUplink::parseLine() {
+    line[line_length] = '\0';
+
+    if (parse == Parse::STATUS) {
+        if (strncmp(line.data(), "HTTP/1.", 7) == 0 && line_length > 9) {
+            status      = atoi(&line[9]);
+            body_left   = 0;
+            close_after = false;
+            parse       = Parse::HEADERS;
+        }
+    } else if (line_length == 0) {
+        if (body_left == 0) {
+            responseDone();
+        } else {
+            parse = Parse::BODY;
+        }
+    } else if (strncasecmp(line.data(), "Content-Length:", 15) == 0) {
+        body_left = strtoul(&line[15], nullptr, 10);
+    } else if (strncasecmp(line.data(), "Connection: close", 17) == 0) {
+        close_after = true;
+    }
+}
+
+/**
+ * @brief Complete the oldest request in flight with the response just parsed.
+ */
+void RtdbUplink::responseDone() {
+    parse = Parse::STATUS;
+
+    if (in_flight > 0) {
+        complete(status);
+    }
+
+    if (close_after) {
+        disconnect();
+    }
+}
+
+/**
+ * @brief Remove the oldest request and report it to the done callback.
+ *
+ * The body of a fetch is handed to the callback in place, it stays valid until
+ * the next request is queued.
+ *
+ * @param httpStatus The HTTP status, or UPLINK_STATUS_FAILED.
+ */
+void RtdbUplink::complete(int httpStatus) {
+    UplinkRequest &request = requests[first];
+    uint32_t rttMs = millis() - request.sent_ms;
+    void *context  = request.context;
+    const char *response {nullptr};
+
+    if (request.fetch && httpStatus != UPLINK_STATUS_FAILED) {
+        request.body[request.body_length] = '\0';
+        response = request.body.data();
+    }
+
+    first = (first + 1) % UPLINK_MAX_PENDING;
+    --count;
+
+    if (in_flight > 0) {
+        --in_flight;
+    }
+
+    if (httpStatus >= 200 && httpStatus < 300) {
+        ++stats.completed;
+        stats.rtt_avg_ms = (stats.rtt_avg_ms == 0)
+                           ? rttMs
+                           : stats.rtt_avg_ms + (static_cast<int32_t>(rttMs - stats.rtt_avg_ms) /
+                                                 UPLINK_RTT_EWMA_WEIGHT);
+    } else {
+        ++stats.errors;
+    }
+
+    done(context, httpStatus, rttMs, response);
+}
@@ -0,0 +1,96 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// task_monitor.cpp - Implementation of the task runtime report.
+//
+// The report takes a snapshot of every FreeRTOS task and compares it with the
+// previous snapshot, so the CPU usage shown is the usage over the last report
+// period rather than since boot.
+
+#include "task_monitor.h"       // NOLINT
+
+/**
+ * @brief Return the run time counter of a task in the previous snapshot.
+ *
+ * @param handle The handle of the task.
+ * @return The previous run time counter, or 0 if the task is new.
+ */
+uint32_t TaskMonitor::previousRunTime(TaskHandle_t handle) const {
+    for (UBaseType_t i = 0; i < previous_count; ++i) {
+        if (previous[i].handle == handle) {
+            return previous[i].run_time;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Print the task report on the serial console.
+ *
+ * CPU usage is given as a percentage of one core, so the tasks of each core add
+ * up to 100 % including its idle task.
+ */
+void TaskMonitor::report() {
+    uint32_t total {0};
+    UBaseType_t count = uxTaskGetSystemState(status.data(), status.size(), &total);
+
+    Serial.printf("Tasks: %u\n", count);
+    Serial.println("  name             core prio  cpu%   stack free");
+
+    for (UBaseType_t i = 0; i < count; ++i) {
+        const TaskStatus_t &task = status[i];
+        BaseType_t core = xTaskGetAffinity(task.xHandle);
+
+#if configGENERATE_RUN_TIME_STATS
+        uint32_t elapsed = total - previous_total;
+        uint32_t busy    = task.ulRunTimeCounter - previousRunTime(task.xHandle);
+        float    cpu     = (elapsed > 0) ? (100.0F * busy) / elapsed : 0.0F;
+
+        Serial.printf("  %-16s %4s %4u %5.1f %6u%s\n",
+                      task.pcTaskName, core == tskNO_AFFINITY ? "any" : (core == 0 ? "0" : "1"),
+                      task.uxCurrentPriority, cpu, task.usStackHighWaterMark,
+                      task.usStackHighWaterMark < TASK_STACK_WARN_BYTES ? "  LOW" : "");
+#else
+        Serial.printf("  %-16s %4s %4u   n/a %6u%s\n",
+                      task.pcTaskName, core == tskNO_AFFINITY ? "any" : (core == 0 ? "0" : "1"),
+                      task.uxCurrentPriority, task.usStackHighWaterMark,
+                      task.usStackHighWaterMark < TASK_STACK_WARN_BYTES ? "  LOW" : "");
+#endif
+    }
+
+#if configGENERATE_RUN_TIME_STATS
+    for (UBaseType_t i = 0; i < count; ++i) {
+        previous[i].handle   = status[i].xHandle;
+        previous[i].run_time = status[i].ulRunTimeCounter;
+    }
+#endif
+
+    previous_count = count;
+    previous_total = total;
+}
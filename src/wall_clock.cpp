@@ -0,0 +1,113 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// wall_clock.cpp - Implementation of the SNTP-disciplined wall clock.
+//
+// Frames are stamped with the monotonic microsecond timer when they are
+// received, which is cheap, never jumps and works before the first SNTP
+// sync. The stamp is converted to UTC only when the reading is uploaded, by
+// measuring its age against the current wall-clock time. Readings captured
+// before the first sync therefore still get an accurate capture time, as
+// long as the bridge has not rebooted in between.
+
+#include <Arduino.h>
+#include <esp_sntp.h>
+#include <esp_timer.h>
+#include <sys/time.h>
+#include "wall_clock.h"         // NOLINT
+
+static constexpr char NTP_SERVER_1[] {"pool.ntp.org"};
+static constexpr char NTP_SERVER_2[] {"time.google.com"};
+
+static volatile bool synced {false};
+
+/**
+ * @brief Called by the SNTP client each time the system time is adjusted.
+ *
+ * @param tv The new system time.
+ */
+static void onTimeSync(struct timeval * /* tv */) {
+    if (!synced) {
+        Serial.println("Wall clock synchronized");
+    }
+
+    synced = true;
+}
+
+/**
+ * @brief Start the SNTP client. Must be called once the network is up.
+ *
+ * Calling it again is harmless: the client is only started once.
+ */
+void beginWallClock() {
+    static bool started {false};
+
+    if (started) {
+        return;
+    }
+
+    started = true;
+
+    sntp_set_time_sync_notification_cb(onTimeSync);
+    configTime(0, 0, NTP_SERVER_1, NTP_SERVER_2);
+}
+
+/**
+ * @brief Tell whether the wall clock has been synchronized at least once.
+ */
+bool wallClockSynced() {
+    return synced;
+}
+
+/**
+ * @brief Return the monotonic time since boot, in microseconds.
+ */
+int64_t monotonicUs() {
+    return esp_timer_get_time();
+}
+
+/**
+ * @brief Convert a monotonic timestamp to a UTC time.
+ *
+ * @param monotonic The monotonic timestamp, from monotonicUs().
+ * @return The UTC time in milliseconds since the epoch, or 0 if the wall clock has
+ *         not been synchronized yet.
+ */
+int64_t monotonicToEpochMs(int64_t monotonic) {
+    if (!synced) {
+        return 0;
+    }
+
+    struct timeval now;
+    int64_t nowMonotonic = monotonicUs();
+    gettimeofday(&now, nullptr);
+
+    int64_t nowMs = (static_cast<int64_t>(now.tv_sec) * 1000) + (now.tv_usec / 1000);
+
+    return nowMs - ((nowMonotonic - monotonic) / 1000);
+}
@@ -0,0 +1,219 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// Arduino.h - Host stand-in for the parts of the Arduino core used by the
+//             modules built in the native environment.
+//
+// The host tests run on one thread, so the FreeRTOS spinlocks are no-ops.
+// Serial keeps the last bytes written in a fixed buffer, so a test can
+// check them and writing never allocates memory. millis() returns a clock
+// the tests move by hand.
+//
+// The microsecond clock behind esp_timer_get_time() only moves when a task
+// blocks: vTaskDelay() and the light sleep advance it, so code that waits
+// by spinning never sees the time pass. digitalRead() asks the simulated
+// peripheral that owns the pin, such as the radio of LoRaWan_APP.h.
+//
+// A FreeRTOS queue is a ring of fixed-size items, allocated once by
+// xQueueCreate(). Waiting on an empty queue blocks for the whole timeout,
+// there being no other task to fill it.
+
+#ifndef TEST_STUBS_ARDUINO_H_
+#define TEST_STUBS_ARDUINO_H_
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+typedef int portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux)  ((void)(mux))
+#define portDISABLE_INTERRUPTS()
+#define portENABLE_INTERRUPTS()
+
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms)  (ms)
+
+#define LOW  0
+#define HIGH 1
+
+/**
+ * @brief The HostSerial class records what the firmware prints.
+ */
+class HostSerial {
+ private:
+    static constexpr size_t SIZE {1024};
+
+    char   text[SIZE + 1] {};
+    size_t length {0};
+
+ public:
+    size_t write(const uint8_t *data, size_t size) {
+        size_t kept = std::min(size, SIZE - length);
+
+        memcpy(text + length, data, kept);
+        length += kept;
+        text[length] = '\0';
+
+        return size;
+    }
+
+    size_t printf(const char *format, ...) {
+        char line[SIZE];
+        va_list args;
+
+        va_start(args, format);
+        int length = vsnprintf(line, sizeof(line), format, args);
+        va_end(args);
+
+        return (length > 0) ? write(reinterpret_cast<const uint8_t *>(line), strlen(line)) : 0;
+    }
+
+    size_t println(const char *line) {
+        return write(reinterpret_cast<const uint8_t *>(line), strlen(line)) +
+               write(reinterpret_cast<const uint8_t *>("\n"), 1);
+    }
+
+    const char *output() const { return text; }
+    void clear() { length = 0; text[0] = '\0'; }
+};
+
+inline HostSerial &hostSerial() {
+    static HostSerial serial;
+    return serial;
+}
+
+#define Serial hostSerial()
+
+inline uint32_t &hostMillis() {
+    static uint32_t now {0};
+    return now;
+}
+
+inline uint32_t millis() {
+    return hostMillis();
+}
+
+inline int64_t &hostMicros() {
+    static int64_t now {0};
+    return now;
+}
+
+/**
+ * @brief Count the blocking calls, so a test can tell a task blocks instead of spinning.
+ */
+inline uint32_t &hostDelayCount() {
+    static uint32_t count {0};
+    return count;
+}
+
+inline void vTaskDelay(uint32_t ticks) {
+    ++hostDelayCount();
+    hostMicros() += static_cast<int64_t>(ticks) * portTICK_PERIOD_MS * 1000;
+}
+
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+
+#define pdTRUE  1
+#define pdFALSE 0
+
+typedef struct {
+    uint8_t *items;
+    size_t   item_size;
+    size_t   length;
+    size_t   first;
+    size_t   count;
+} host_queue_t;
+
+typedef host_queue_t *QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(size_t length, size_t itemSize) {
+    QueueHandle_t queue = static_cast<QueueHandle_t>(malloc(sizeof(host_queue_t)));
+
+    *queue = host_queue_t {static_cast<uint8_t *>(malloc(length * itemSize)), itemSize, length, 0, 0};
+    return queue;
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void *item, uint32_t /* ticks */) {
+    if (queue->count == queue->length) {
+        return pdFALSE;
+    }
+
+    size_t last = (queue->first + queue->count++) % queue->length;
+    memcpy(queue->items + last * queue->item_size, item, queue->item_size);
+
+    return pdTRUE;
+}
+
+inline BaseType_t xQueuePeek(QueueHandle_t queue, void *item, uint32_t ticks) {
+    if (queue->count == 0) {
+        vTaskDelay(ticks);
+        return pdFALSE;
+    }
+
+    memcpy(item, queue->items + queue->first * queue->item_size, queue->item_size);
+    return pdTRUE;
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void *item, uint32_t ticks) {
+    if (xQueuePeek(queue, item, ticks) != pdTRUE) {
+        return pdFALSE;
+    }
+
+    queue->first = (queue->first + 1) % queue->length;
+    --queue->count;
+
+    return pdTRUE;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    return static_cast<UBaseType_t>(queue->count);
+}
+
+typedef int (*host_pin_reader_t)(uint8_t pin);
+
+inline host_pin_reader_t &hostPinReader() {
+    static host_pin_reader_t reader {nullptr};
+    return reader;
+}
+
+inline int digitalRead(uint8_t pin) {
+    return (hostPinReader() != nullptr) ? hostPinReader()(pin) : LOW;
+}
+
+inline void configTime(long /* gmtOffset */, int /* daylightOffset */,   // NOLINT
+                       const char * /* server1 */, const char * /* server2 */) {}
+
+#endif  // TEST_STUBS_ARDUINO_H_
@@ -0,0 +1,200 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// LoRaWan_APP.h - Host stand-in for the SX126x radio of the Heltec library.
+//
+// The radio is simulated on the host clock, see Arduino.h. A test puts one
+// frame on the air: its preamble starts at a given time and lasts a given
+// number of symbols. A CAD detects it when the whole CAD falls within the
+// preamble, and a reception gets it when it starts early enough to lock on
+// the rest of the preamble, before or after the frame is put on the air.
+// Otherwise the reception times out. DIO1 rises at
+// the end of the CAD or the reception, and IrqProcess() calls the radio
+// events as the driver does.
+
+#ifndef TEST_STUBS_LORAWAN_APP_H_
+#define TEST_STUBS_LORAWAN_APP_H_
+
+#include <Arduino.h>
+
+typedef enum {
+    MODEM_FSK = 0,
+    MODEM_LORA,
+} RadioModems_t;
+
+typedef struct {
+    void (*TxDone)(void);
+    void (*TxTimeout)(void);
+    void (*RxDone)(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr);
+    void (*RxTimeout)(void);
+    void (*RxError)(void);
+    void (*FhssChangeChannel)(uint8_t currentChannel);
+    void (*CadDone)(bool channelActivityDetected);
+} RadioEvents_t;
+
+/**
+ * @brief The HostRadio class simulates the radio for one frame on the air.
+ */
+class HostRadio {
+ public:
+    enum class Mode { SLEEP, STANDBY, CAD, RX };
+
+    static constexpr uint8_t DIO1_IO {14};
+
+    RadioEvents_t *events {nullptr};
+    Mode     mode {Mode::SLEEP};
+
+    // Air settings, set by the test
+    uint32_t symbol_us {1024};
+    uint32_t cad_symbols {2};
+    uint32_t lock_symbols {3};                          // Preamble left to lock on
+
+    // The frame on the air
+    bool     on_air {false};
+    bool     noise {false};                             // CAD detects, no frame follows
+    int64_t  preamble_start_us {0};
+    uint32_t preamble_symbols {8};
+    uint32_t frame_symbols {40};                        // Preamble included
+    uint8_t  frame[16] {};
+    uint16_t frame_size {0};
+    int16_t  rssi {-90};
+    int8_t   snr {5};
+
+    // Counters
+    uint32_t cads {0};
+    uint32_t receptions {0};
+    uint32_t sleeps {0};
+    int64_t  rx_start_us {0};
+
+    void reset() { *this = HostRadio(); }
+
+    void transmit(int64_t startUs, uint32_t preambleSymbols, uint32_t frameSymbols) {
+        on_air            = true;
+        preamble_start_us = startUs;
+        preamble_symbols  = preambleSymbols;
+        frame_symbols     = frameSymbols;
+    }
+
+    int dio1() const {
+        int64_t irqUs = irq();
+        return (irqUs >= 0 && hostMicros() >= irqUs) ? HIGH : LOW;
+    }
+
+    void Init(RadioEvents_t *radioEvents) {
+        events = radioEvents;
+        hostPinReader() = readPin;
+    }
+
+    void Sleep() {
+        mode = Mode::SLEEP;
+        ++sleeps;
+    }
+
+    void Standby() {
+        mode = Mode::STANDBY;
+    }
+
+    void StartCad() {
+        mode      = Mode::CAD;
+        cad_start = hostMicros();
+        ++cads;
+    }
+
+    void Rx(uint32_t timeoutMs) {
+        mode          = Mode::RX;
+        rx_start_us   = hostMicros();
+        rx_timeout_us = static_cast<int64_t>(timeoutMs) * 1000;
+        ++receptions;
+    }
+
+    void IrqProcess() {
+        if (dio1() == LOW) {
+            return;
+        }
+
+        if (mode == Mode::CAD) {
+            int64_t preambleEnd = preamble_start_us + preamble_symbols * symbol_us;
+            bool detected = noise ||
+                            (on_air && cad_start >= preamble_start_us &&
+                             cad_start + cad_symbols * symbol_us <= preambleEnd);
+
+            mode = Mode::STANDBY;
+            events->CadDone(detected);
+        } else if (mode == Mode::RX) {
+            mode = Mode::STANDBY;
+
+            if (locked()) {
+                on_air = false;
+                events->RxDone(frame, frame_size, rssi, snr);
+            } else {
+                events->RxTimeout();
+            }
+        }
+    }
+
+ private:
+    int64_t cad_start {0};
+    int64_t rx_timeout_us {0};                          // 0: continuous reception
+
+    bool locked() const {
+        int64_t lockBy = preamble_start_us + (preamble_symbols - lock_symbols) * symbol_us;
+        return on_air && rx_start_us <= lockBy;
+    }
+
+    // The time DIO1 rises at, or -1
+    int64_t irq() const {
+        if (mode == Mode::CAD) {
+            return cad_start + cad_symbols * symbol_us;
+        }
+
+        if (mode == Mode::RX) {
+            if (locked()) {
+                return preamble_start_us + frame_symbols * symbol_us;
+            }
+
+            return (rx_timeout_us > 0) ? rx_start_us + rx_timeout_us : -1;
+        }
+
+        return -1;
+    }
+
+    static int readPin(uint8_t pin);
+};
+
+inline HostRadio &hostRadio() {
+    static HostRadio radio;
+    return radio;
+}
+
+inline int HostRadio::readPin(uint8_t pin) {
+    return (pin == DIO1_IO) ? hostRadio().dio1() : LOW;
+}
+
+#define Radio hostRadio()
+
+#endif  // TEST_STUBS_LORAWAN_APP_H_
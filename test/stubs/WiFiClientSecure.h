@@ -0,0 +1,167 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// File description
+// =========================================================
+// WiFiClientSecure.h - Host stand-in for the TLS client of the Arduino core.
+//
+// Every client talks to the same scripted server: the tests read the bytes
+// sent, queue the response bytes, refuse connections or drop the current one.
+// The server can also answer each request by itself after a latency, stall
+// for a while, or present a certificate that does not chain to the roots the
+// client checks. Time is the millis() of the Arduino stub.
+
+#ifndef TEST_STUBS_WIFICLIENTSECURE_H_
+#define TEST_STUBS_WIFICLIENTSECURE_H_
+
+#include <string>
+#include <vector>
+#include <Arduino.h>
+
+/**
+ * @brief The HostServer class is the far end of the host TLS clients.
+ */
+class HostServer {
+ public:
+    bool        accept {true};
+    bool        connected {false};
+    uint32_t    connections {0};
+    const char *ca_cert {nullptr};
+    bool        trusted_cert {true};                    // Chains to the roots of the client
+    uint32_t    certificate_failures {0};
+    std::string sent;
+    std::string response;
+    size_t      read_position {0};
+
+    // Answer to every request, latency_ms after it is sent, unless nullptr
+    const char *auto_response {nullptr};
+    uint32_t    latency_ms {0};
+    uint32_t    stall_until_ms {0};                     // Nothing is received before
+    std::vector<uint32_t> answer_ms;                    // Answers still to come
+
+    void reset() { *this = HostServer(); }
+    void reply(const char *bytes) { response += bytes; }
+    void stall(uint32_t ms) { stall_until_ms = millis() + ms; }
+
+    /**
+     * @brief Close the connection from the server side. Whatever it had not
+     *        delivered yet is lost with it.
+     */
+    void drop() {
+        connected     = false;
+        read_position = response.size();
+        answer_ms.clear();
+    }
+
+    /**
+     * @brief Schedule the answer to a request that starts with the bytes written.
+     */
+    void received(const char *bytes, size_t size) {
+        bool request = size >= 4 && (strncmp(bytes, "PUT ", 4) == 0 || strncmp(bytes, "GET ", 4) == 0);
+
+        if (request && auto_response != nullptr) {
+            answer_ms.push_back(millis() + latency_ms);
+        }
+    }
+
+    /**
+     * @brief Return the number of bytes the client can read now.
+     */
+    size_t deliver() {
+        if (!connected || static_cast<int32_t>(millis() - stall_until_ms) < 0) {
+            return 0;
+        }
+
+        size_t due {0};
+
+        while (due < answer_ms.size() && static_cast<int32_t>(millis() - answer_ms[due]) >= 0) {
+            response += auto_response;
+            ++due;
+        }
+
+        answer_ms.erase(answer_ms.begin(), answer_ms.begin() + due);
+
+        return response.size() - read_position;
+    }
+};
+
+inline HostServer &hostServer() {
+    static HostServer server;
+    return server;
+}
+
+/**
+ * @brief The WiFiClientSecure class connects to the host server.
+ */
+class WiFiClientSecure {
+ public:
+    void setCACert(const char *rootCa) { hostServer().ca_cert = rootCa; }
+    void setInsecure() { hostServer().ca_cert = nullptr; }
+    void setHandshakeTimeout(unsigned long /* seconds */) {}
+
+    int connect(const char * /* host */, uint16_t /* port */, int32_t /* timeoutMs */) {
+        HostServer &server = hostServer();
+
+        // The handshake fails when the certificate is checked and not trusted.
+        if (server.accept && server.ca_cert != nullptr && !server.trusted_cert) {
+            ++server.certificate_failures;
+            return 0;
+        }
+
+        server.connected = server.accept;
+        server.connections += server.accept ? 1 : 0;
+
+        return server.accept ? 1 : 0;
+    }
+
+    uint8_t connected() { return hostServer().connected ? 1 : 0; }
+    void stop() { hostServer().drop(); }
+
+    size_t write(const uint8_t *data, size_t size) {
+        if (!hostServer().connected) {
+            return 0;
+        }
+
+        hostServer().sent.append(reinterpret_cast<const char *>(data), size);
+        hostServer().received(reinterpret_cast<const char *>(data), size);
+        return size;
+    }
+
+    int available() { return static_cast<int>(hostServer().deliver()); }
+
+    int read() {
+        HostServer &server = hostServer();
+
+        if (server.deliver() == 0) {
+            return -1;
+        }
+
+        return static_cast<uint8_t>(server.response[server.read_position++]);
+    }
+};
+
+#endif  // TEST_STUBS_WIFICLIENTSECURE_H_
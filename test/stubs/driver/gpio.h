@@ -0,0 +1,64 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// gpio.h - Host stand-in for the GPIO driver of ESP-IDF, limited to the
+//          wakeup of the light sleep.
+
+#ifndef TEST_STUBS_DRIVER_GPIO_H_
+#define TEST_STUBS_DRIVER_GPIO_H_
+
+#include <esp_sleep.h>
+
+typedef int gpio_num_t;
+
+typedef enum {
+    GPIO_INTR_DISABLE = 0,
+    GPIO_INTR_POSEDGE,
+    GPIO_INTR_NEGEDGE,
+    GPIO_INTR_ANYEDGE,
+    GPIO_INTR_LOW_LEVEL,
+    GPIO_INTR_HIGH_LEVEL,
+} gpio_int_type_t;
+
+inline int gpio_wakeup_enable(gpio_num_t pin, gpio_int_type_t type) {
+    hostSleep().gpio_enabled = true;
+    hostSleep().gpio_pin     = pin;
+    hostSleep().gpio_level   = (type == GPIO_INTR_HIGH_LEVEL) ? HIGH : LOW;
+    return 0;
+}
+
+inline int gpio_wakeup_disable(gpio_num_t /* pin */) {
+    hostSleep().gpio_enabled = false;
+    return 0;
+}
+
+inline int gpio_set_intr_type(gpio_num_t /* pin */, gpio_int_type_t /* type */) {
+    return 0;
+}
+
+#endif  // TEST_STUBS_DRIVER_GPIO_H_
@@ -0,0 +1,96 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// esp_sleep.h - Host stand-in for the light sleep of ESP-IDF.
+//
+// A light sleep moves the host clock to the timer wakeup, plus the time the
+// chip takes to enter and leave the sleep, or stops early when the GPIO
+// enabled for the wakeup reaches its level.
+
+#ifndef TEST_STUBS_ESP_SLEEP_H_
+#define TEST_STUBS_ESP_SLEEP_H_
+
+#include <Arduino.h>
+
+/**
+ * @brief The HostSleep class keeps the wakeup sources and counts the light sleeps.
+ */
+class HostSleep {
+ public:
+    static constexpr int64_t STEP_US {10};              // Resolution of the GPIO wakeup
+
+    int64_t  wake_overhead_us {500};
+    uint64_t timer_us {0};
+    bool     gpio_enabled {false};
+    int      gpio_pin {-1};
+    int      gpio_level {HIGH};
+    uint32_t sleeps {0};
+    uint32_t gpio_wakeups {0};
+    int64_t  slept_us {0};
+
+    void reset() { *this = HostSleep(); }
+
+    void lightSleep() {
+        int64_t start = hostMicros();
+        int64_t end   = start + static_cast<int64_t>(timer_us) + wake_overhead_us;
+
+        ++sleeps;
+
+        while (hostMicros() < end) {
+            if (gpio_enabled && digitalRead(static_cast<uint8_t>(gpio_pin)) == gpio_level) {
+                ++gpio_wakeups;
+                break;
+            }
+
+            hostMicros() += STEP_US;
+        }
+
+        slept_us += hostMicros() - start;
+    }
+};
+
+inline HostSleep &hostSleep() {
+    static HostSleep sleep;
+    return sleep;
+}
+
+inline int esp_sleep_enable_gpio_wakeup() {
+    return 0;
+}
+
+inline int esp_sleep_enable_timer_wakeup(uint64_t us) {
+    hostSleep().timer_us = us;
+    return 0;
+}
+
+inline int esp_light_sleep_start() {
+    hostSleep().lightSleep();
+    return 0;
+}
+
+#endif  // TEST_STUBS_ESP_SLEEP_H_
@@ -0,0 +1,50 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// esp_sntp.h - Host stand-in for the SNTP client of ESP-IDF.
+//
+// The host never synchronizes: the notification callback is kept, so a
+// test can call it to mark the wall clock synchronized.
+
+#ifndef TEST_STUBS_ESP_SNTP_H_
+#define TEST_STUBS_ESP_SNTP_H_
+
+struct timeval;
+
+typedef void (*sntp_sync_time_cb_t)(struct timeval *tv);
+
+inline sntp_sync_time_cb_t &hostSntpCallback() {
+    static sntp_sync_time_cb_t callback {nullptr};
+    return callback;
+}
+
+inline void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback) {
+    hostSntpCallback() = callback;
+}
+
+#endif  // TEST_STUBS_ESP_SNTP_H_
@@ -0,0 +1,152 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// File description
+// =========================================================
+// test_capture_format.cpp - Unit tests of the on-flash format of the RF captures.
+
+#include <vector>
+#include <unity.h>
+#include "capture_format.h"     // NOLINT
+
+static void appendRecord(std::vector<uint8_t> *capture, const uint8_t *frame, uint8_t size,
+                         int16_t rssi, int8_t snr, uint32_t deltaUs) {
+    CaptureHeader header;
+
+    captureEncodeHeader(size, rssi, snr, deltaUs, &header);
+    capture->insert(capture->end(), header.begin(), header.end());
+    capture->insert(capture->end(), frame, frame + size);
+}
+
+static std::vector<uint8_t> emptyCapture() {
+    return std::vector<uint8_t>(CAPTURE_MAGIC, CAPTURE_MAGIC + CAPTURE_MAGIC_SIZE);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_header_layout_is_little_endian(void) {
+    CaptureHeader header;
+    const uint8_t expected[CAPTURE_HEADER_SIZE] = {42, 0x8E, 0xFF, 0xF6, 0x78, 0x56, 0x34, 0x12};
+
+    captureEncodeHeader(42, -114, -10, 0x12345678, &header);
+
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, header.data(), CAPTURE_HEADER_SIZE);
+}
+
+static void test_header_round_trip(void) {
+    CaptureHeader header;
+    CaptureRecord record {};
+
+    captureEncodeHeader(CAPTURE_MAX_FRAME, -140, -21, UINT32_MAX, &header);
+    captureDecodeHeader(header, &record);
+
+    TEST_ASSERT_EQUAL_UINT8(CAPTURE_MAX_FRAME, record.size);
+    TEST_ASSERT_EQUAL_INT16(-140, record.rssi);
+    TEST_ASSERT_EQUAL_INT8(-21, record.snr);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, record.delta_us);
+}
+
+static void test_delta_is_clamped(void) {
+    TEST_ASSERT_EQUAL_UINT32(0, captureDelta(0, 5000000));                      // First frame
+    TEST_ASSERT_EQUAL_UINT32(1500, captureDelta(5000000, 5001500));
+    TEST_ASSERT_EQUAL_UINT32(0, captureDelta(5000000, 4000000));                // Relayed, earlier
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, captureDelta(1, 1 + (INT64_C(1) << 40)));
+}
+
+static void test_reader_returns_the_records_in_order(void) {
+    std::vector<uint8_t> capture = emptyCapture();
+    const uint8_t first[] = {0x08, 0x01, 0x10, 0x02};
+    const uint8_t second[] = {0x02, 0x08, 0x07};
+    CaptureReader reader;
+    CaptureRecord record {};
+
+    appendRecord(&capture, first, sizeof(first), -80, 9, 0);
+    appendRecord(&capture, second, sizeof(second), -120, -12, 30000000);
+    appendRecord(&capture, first, 0, -90, 0, 1);
+
+    TEST_ASSERT_TRUE(reader.begin(capture.data(), capture.size()));
+
+    TEST_ASSERT_TRUE(reader.next(&record));
+    TEST_ASSERT_EQUAL_UINT8(sizeof(first), record.size);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(first, record.frame.data(), sizeof(first));
+    TEST_ASSERT_EQUAL_INT16(-80, record.rssi);
+
+    TEST_ASSERT_TRUE(reader.next(&record));
+    TEST_ASSERT_EQUAL_UINT8(sizeof(second), record.size);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(second, record.frame.data(), sizeof(second));
+    TEST_ASSERT_EQUAL_INT8(-12, record.snr);
+    TEST_ASSERT_EQUAL_UINT32(30000000, record.delta_us);
+
+    TEST_ASSERT_TRUE(reader.next(&record));
+    TEST_ASSERT_EQUAL_UINT8(0, record.size);
+
+    TEST_ASSERT_FALSE(reader.next(&record));
+}
+
+static void test_reader_rejects_another_format(void) {
+    std::vector<uint8_t> capture = emptyCapture();
+    const uint8_t frame[] = {0x08, 0x01};
+    CaptureReader reader;
+    CaptureRecord record {};
+
+    appendRecord(&capture, frame, sizeof(frame), -80, 9, 0);
+    capture[3] = '0';
+
+    TEST_ASSERT_FALSE(reader.begin(capture.data(), capture.size()));
+    TEST_ASSERT_FALSE(reader.next(&record));
+    TEST_ASSERT_FALSE(reader.begin(capture.data(), 2));
+    TEST_ASSERT_FALSE(reader.next(&record));
+}
+
+static void test_reader_stops_at_a_truncated_record(void) {
+    std::vector<uint8_t> capture = emptyCapture();
+    const uint8_t frame[] = {0x08, 0x01, 0x10, 0x02};
+    CaptureReader reader;
+    CaptureRecord record {};
+
+    appendRecord(&capture, frame, sizeof(frame), -80, 9, 0);
+    appendRecord(&capture, frame, sizeof(frame), -80, 9, 100);
+
+    TEST_ASSERT_TRUE(reader.begin(capture.data(), capture.size() - 1));
+    TEST_ASSERT_TRUE(reader.next(&record));
+    TEST_ASSERT_FALSE(reader.next(&record));
+
+    TEST_ASSERT_TRUE(reader.begin(capture.data(), CAPTURE_MAGIC_SIZE + CAPTURE_HEADER_SIZE - 1));
+    TEST_ASSERT_FALSE(reader.next(&record));
+}
+
+int main(int /* argc */, char ** /* argv */) {
+    UNITY_BEGIN();
+    RUN_TEST(test_header_layout_is_little_endian);
+    RUN_TEST(test_header_round_trip);
+    RUN_TEST(test_delta_is_clamped);
+    RUN_TEST(test_reader_returns_the_records_in_order);
+    RUN_TEST(test_reader_rejects_another_format);
+    RUN_TEST(test_reader_stops_at_a_truncated_record);
+    return UNITY_END();
+}
@@ -0,0 +1,193 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// File description
+// =========================================================
+// test_history.cpp - Unit tests of the level history.
+
+#include <unity.h>
+#include "history.h"            // NOLINT
+#include "payload_registry.h"   // NOLINT
+
+static const uint64_t SENSOR_A = payloadSource(PayloadTypeId::PAYLOAD_TYPE_WATER_LEVEL, 7);
+static const uint64_t SENSOR_B = payloadSource(PayloadTypeId::PAYLOAD_TYPE_WATER_LEVEL, 8);
+
+// Middle of a column, far enough from boot for a whole history
+constexpr int64_t columnUs(int64_t column) {
+    return column * HISTORY_COLUMN_US + HISTORY_COLUMN_US / 2;
+}
+
+constexpr int64_t NOW_COLUMN {1000};
+
+static void copyPage(const LevelHistory &history, uint8_t page, uint64_t *source,
+                     HistoryColumns *columns) {
+    TEST_ASSERT_TRUE(history.copy(page, columnUs(NOW_COLUMN), source, columns));
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_readings_fold_into_the_min_and_max_of_their_column(void) {
+    LevelHistory history;
+    uint64_t source {0};
+
+    history.update(SENSOR_A, 40, columnUs(NOW_COLUMN));
+    history.update(SENSOR_A, 55, columnUs(NOW_COLUMN));
+    history.update(SENSOR_A, 47, columnUs(NOW_COLUMN));
+
+    HistoryColumns columns {};
+    copyPage(history, 0, &source, &columns);
+
+    TEST_ASSERT_EQUAL_UINT64(SENSOR_A, source);
+    TEST_ASSERT_EQUAL_UINT8(40, columns[HISTORY_COLUMNS - 1].min);
+    TEST_ASSERT_EQUAL_UINT8(55, columns[HISTORY_COLUMNS - 1].max);
+
+    for (size_t i = 0; i < HISTORY_COLUMNS - 1; ++i) {
+        TEST_ASSERT_TRUE(columns[i].min > columns[i].max);
+    }
+}
+
+static void test_sources_sharing_a_sensor_id_are_kept_apart(void) {
+    LevelHistory history;
+    uint64_t source {0};
+    uint64_t other = payloadSource(PayloadTypeId::PAYLOAD_TYPE_AIR, 7);
+
+    history.update(SENSOR_A, 20, columnUs(NOW_COLUMN));
+    history.update(other, 90, columnUs(NOW_COLUMN));
+
+    TEST_ASSERT_EQUAL_UINT8(2, history.count());
+
+    HistoryColumns columns {};
+
+    copyPage(history, 0, &source, &columns);
+    TEST_ASSERT_EQUAL_UINT64(SENSOR_A, source);
+    TEST_ASSERT_EQUAL_UINT8(20, columns[HISTORY_COLUMNS - 1].max);
+
+    copyPage(history, 1, &source, &columns);
+    TEST_ASSERT_EQUAL_UINT64(other, source);
+    TEST_ASSERT_EQUAL_UINT8(90, columns[HISTORY_COLUMNS - 1].min);
+}
+
+static void test_skipped_columns_are_emptied(void) {
+    LevelHistory history;
+    uint64_t source {0};
+
+    // A full turn of the ring earlier, then two columns earlier
+    history.update(SENSOR_A, 10, columnUs(NOW_COLUMN - HISTORY_COLUMNS));
+    history.update(SENSOR_A, 30, columnUs(NOW_COLUMN - 2));
+    history.update(SENSOR_A, 60, columnUs(NOW_COLUMN));
+
+    HistoryColumns columns {};
+    copyPage(history, 0, &source, &columns);
+
+    TEST_ASSERT_EQUAL_UINT8(30, columns[HISTORY_COLUMNS - 3].min);
+    TEST_ASSERT_TRUE(columns[HISTORY_COLUMNS - 2].min > columns[HISTORY_COLUMNS - 2].max);
+    TEST_ASSERT_EQUAL_UINT8(60, columns[HISTORY_COLUMNS - 1].min);
+
+    for (size_t i = 0; i < HISTORY_COLUMNS - 3; ++i) {
+        TEST_ASSERT_TRUE(columns[i].min > columns[i].max);
+    }
+}
+
+static void test_late_readings_go_to_their_own_column(void) {
+    LevelHistory history;
+    uint64_t source {0};
+
+    history.update(SENSOR_A, 50, columnUs(NOW_COLUMN));
+    history.update(SENSOR_A, 35, columnUs(NOW_COLUMN - 5));
+    history.update(SENSOR_A, 99, columnUs(NOW_COLUMN - HISTORY_COLUMNS));     // Out of the history
+
+    HistoryColumns columns {};
+    copyPage(history, 0, &source, &columns);
+
+    TEST_ASSERT_EQUAL_UINT8(50, columns[HISTORY_COLUMNS - 1].min);
+    TEST_ASSERT_EQUAL_UINT8(35, columns[HISTORY_COLUMNS - 6].max);
+
+    for (size_t i = 0; i < HISTORY_COLUMNS; ++i) {
+        TEST_ASSERT_TRUE(columns[i].min > columns[i].max || columns[i].max != 99);
+    }
+}
+
+static void test_readings_captured_before_boot_are_ignored(void) {
+    LevelHistory history;
+    uint64_t source {0};
+    HistoryColumns columns {};
+
+    // A relayed reading held longer than the bridge has been up
+    history.update(SENSOR_A, 60, columnUs(5));
+    history.update(SENSOR_A, 99, -2 * HISTORY_COLUMN_US);
+    history.update(SENSOR_A, 98, -1000);
+
+    TEST_ASSERT_TRUE(history.copy(0, columnUs(5), &source, &columns));
+    TEST_ASSERT_EQUAL_UINT64(SENSOR_A, source);
+    TEST_ASSERT_EQUAL_UINT8(60, columns[HISTORY_COLUMNS - 1].min);
+    TEST_ASSERT_EQUAL_UINT8(60, columns[HISTORY_COLUMNS - 1].max);
+
+    for (size_t i = 0; i < HISTORY_COLUMNS - 1; ++i) {
+        TEST_ASSERT_TRUE(columns[i].min > columns[i].max);
+    }
+
+    // Still the newest column, so a reading later in it lands there
+    history.update(SENSOR_A, 70, columnUs(5));
+    TEST_ASSERT_TRUE(history.copy(0, columnUs(5), &source, &columns));
+    TEST_ASSERT_EQUAL_UINT8(70, columns[HISTORY_COLUMNS - 1].max);
+}
+
+static void test_least_recent_series_is_reused_when_full(void) {
+    LevelHistory history;
+    uint64_t source {0};
+
+    history.update(SENSOR_A, 10, columnUs(NOW_COLUMN - 10));
+
+    for (uint32_t i = 1; i < HISTORY_MAX_SENSORS; ++i) {
+        history.update(SENSOR_B + i, 20, columnUs(NOW_COLUMN));
+    }
+
+    history.update(SENSOR_B, 30, columnUs(NOW_COLUMN));
+
+    TEST_ASSERT_EQUAL_UINT8(HISTORY_MAX_SENSORS, history.count());
+
+    HistoryColumns columns {};
+
+    for (uint8_t page = 0; page < HISTORY_MAX_SENSORS; ++page) {
+        copyPage(history, page, &source, &columns);
+        TEST_ASSERT_NOT_EQUAL_UINT64(SENSOR_A, source);
+    }
+
+    TEST_ASSERT_FALSE(history.copy(HISTORY_MAX_SENSORS, columnUs(NOW_COLUMN), &source, &columns));
+}
+
+int main(int /* argc */, char ** /* argv */) {
+    UNITY_BEGIN();
+    RUN_TEST(test_readings_fold_into_the_min_and_max_of_their_column);
+    RUN_TEST(test_sources_sharing_a_sensor_id_are_kept_apart);
+    RUN_TEST(test_skipped_columns_are_emptied);
+    RUN_TEST(test_late_readings_go_to_their_own_column);
+    RUN_TEST(test_readings_captured_before_boot_are_ignored);
+    RUN_TEST(test_least_recent_series_is_reused_when_full);
+    return UNITY_END();
+}
@@ -0,0 +1,118 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// test_json_writer.cpp - Unit tests of the JSON writer.
+
+#include <array>
+#include <cstring>
+#include <unity.h>
+#include "json_writer.h"        // NOLINT
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_empty_object(void) {
+    std::array<char, 8> text;
+    JsonWriter json(text.data(), text.size());
+
+    TEST_ASSERT_EQUAL_size_t(2, json.finish());
+    TEST_ASSERT_EQUAL_STRING("{}", text.data());
+}
+
+static void test_members_and_nested_objects(void) {
+    std::array<char, 128> text;
+    JsonWriter json(text.data(), text.size());
+
+    json.addString("level", "42");
+    json.addInt("rssi", -97);
+    json.addInt("timestamp", 1700000000123LL);
+    json.addServerTimestamp("server_timestamp");
+    json.addTenths("snr_avg", -75);
+
+    size_t length = json.finish();
+
+    TEST_ASSERT_EQUAL_STRING("{\"level\":\"42\",\"rssi\":-97,\"timestamp\":1700000000123,"
+                             "\"server_timestamp\":{\".sv\":\"timestamp\"},\"snr_avg\":-7.5}",
+                             text.data());
+    TEST_ASSERT_EQUAL_size_t(strlen(text.data()), length);
+}
+
+static void test_tenths_keep_their_sign(void) {
+    std::array<char, 64> text;
+    JsonWriter json(text.data(), text.size());
+
+    json.addTenths("a", -5);
+    json.addTenths("b", 0);
+    json.addTenths("c", 123);
+    json.finish();
+
+    TEST_ASSERT_EQUAL_STRING("{\"a\":-0.5,\"b\":0.0,\"c\":12.3}", text.data());
+}
+
+static void test_strings_are_escaped(void) {
+    std::array<char, 64> text;
+    JsonWriter json(text.data(), text.size());
+
+    json.addString("name", "a\"b\\c\n");
+    json.finish();
+
+    TEST_ASSERT_EQUAL_STRING("{\"name\":\"a\\\"b\\\\c\\u000a\"}", text.data());
+}
+
+static void test_overflow_is_reported(void) {
+    std::array<char, 24> text;
+    JsonWriter json(text.data(), text.size());
+
+    json.addString("distance", "1234");
+    TEST_ASSERT_FALSE(json.overflowed());
+
+    json.addInt("level", 50);
+    TEST_ASSERT_TRUE(json.overflowed());
+    TEST_ASSERT_EQUAL_size_t(0, json.finish());
+}
+
+static void test_exact_fit(void) {
+    std::array<char, 9> text;                           // {"a":12} and the terminator
+    JsonWriter json(text.data(), text.size());
+
+    json.addInt("a", 12);
+
+    TEST_ASSERT_EQUAL_size_t(8, json.finish());
+    TEST_ASSERT_EQUAL_STRING("{\"a\":12}", text.data());
+}
+
+int main(int /* argc */, char ** /* argv */) {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_object);
+    RUN_TEST(test_members_and_nested_objects);
+    RUN_TEST(test_tenths_keep_their_sign);
+    RUN_TEST(test_strings_are_escaped);
+    RUN_TEST(test_overflow_is_reported);
+    RUN_TEST(test_exact_fit);
+    return UNITY_END();
+}
@@ -0,0 +1,206 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// test_link_stats.cpp - Unit tests of the link statistics.
+
+#include <unity.h>
+#include "link_stats.h"         // NOLINT
+
+constexpr uint32_t SENSOR_A {0x01000001};
+constexpr uint32_t SENSOR_B {0x01000002};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_first_sample_sets_every_statistic(void) {
+    LinkStats stats;
+    const link_stats_t *link = stats.update(SENSOR_A, -90, 5);
+
+    TEST_ASSERT_EQUAL_UINT32(1, link->samples);
+    TEST_ASSERT_EQUAL_INT16(-90, stats.rssiAverage(*link));
+    TEST_ASSERT_EQUAL_INT16(50, stats.snrAverageTenths(*link));
+    TEST_ASSERT_EQUAL_INT16(-90, link->rssi_min);
+    TEST_ASSERT_EQUAL_INT16(-90, link->rssi_max);
+    TEST_ASSERT_EQUAL_INT8(5, link->snr_min);
+    TEST_ASSERT_EQUAL_INT8(5, link->snr_max);
+}
+
+static void test_average_converges_and_range_is_kept(void) {
+    LinkStats stats;
+    const link_stats_t *link = stats.update(SENSOR_A, -120, -10);
+
+    for (int i = 0; i < 100; ++i) {
+        link = stats.update(SENSOR_A, -80, 10);
+    }
+
+    TEST_ASSERT_INT_WITHIN(1, -80, stats.rssiAverage(*link));
+    TEST_ASSERT_INT_WITHIN(5, 100, stats.snrAverageTenths(*link));
+    TEST_ASSERT_EQUAL_INT16(-120, link->rssi_min);
+    TEST_ASSERT_EQUAL_INT16(-80, link->rssi_max);
+    TEST_ASSERT_EQUAL_INT8(-10, link->snr_min);
+    TEST_ASSERT_EQUAL_INT8(10, link->snr_max);
+}
+
+static void test_weak_negative_samples_keep_their_average(void) {
+    LinkStats stats;
+    const link_stats_t *link {nullptr};
+
+    for (int i = 0; i < 20; ++i) {
+        link = stats.update(SENSOR_A, -120, -20);
+    }
+
+    TEST_ASSERT_EQUAL_INT32(-120 * 16, link->rssi_ewma);
+    TEST_ASSERT_EQUAL_INT32(-20 * 16, link->snr_ewma);
+    TEST_ASSERT_EQUAL_INT16(-120, stats.rssiAverage(*link));
+    TEST_ASSERT_EQUAL_INT16(-200, stats.snrAverageTenths(*link));
+
+    link = stats.update(SENSOR_A, -128, -20);
+
+    TEST_ASSERT_EQUAL_INT32(-120 * 16 - 16, link->rssi_ewma);
+}
+
+static void test_histograms_clamp_to_their_range(void) {
+    LinkStats stats;
+
+    stats.update(SENSOR_A, -200, -50);
+    const link_stats_t *link = stats.update(SENSOR_A, 20, 50);
+
+    TEST_ASSERT_EQUAL_UINT32(1, link->rssi_hist[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, link->rssi_hist[LINK_HIST_BINS - 1]);
+    TEST_ASSERT_EQUAL_UINT32(1, link->snr_hist[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, link->snr_hist[LINK_HIST_BINS - 1]);
+}
+
+static void test_sources_are_kept_apart(void) {
+    LinkStats stats;
+
+    stats.update(SENSOR_A, -70, 0);
+    stats.update(SENSOR_B, -110, 0);
+
+    TEST_ASSERT_EQUAL_INT16(-70, stats.rssiAverage(*stats.find(SENSOR_A)));
+    TEST_ASSERT_EQUAL_INT16(-110, stats.rssiAverage(*stats.find(SENSOR_B)));
+}
+
+static void test_least_recently_updated_source_is_recycled(void) {
+    LinkStats stats;
+
+    for (uint32_t i = 0; i < LINK_STATS_MAX_SENSORS; ++i) {
+        stats.update(SENSOR_A + i, -90, 0);
+    }
+
+    stats.update(SENSOR_A, -90, 0);                     // SENSOR_A + 1 is now the oldest
+    stats.update(SENSOR_A + LINK_STATS_MAX_SENSORS, -90, 0);
+
+    TEST_ASSERT_NOT_NULL(stats.find(SENSOR_A));
+    TEST_ASSERT_NULL(stats.find(SENSOR_A + 1));
+    TEST_ASSERT_NOT_NULL(stats.find(SENSOR_A + LINK_STATS_MAX_SENSORS));
+}
+
+static void test_sequence_counts_gaps_and_repeats(void) {
+    LinkStats stats;
+    uint32_t missed {0};
+
+    stats.update(SENSOR_A, -90, 0);
+
+    TEST_ASSERT_TRUE(stats.sequence(SENSOR_A, 10, &missed));
+    TEST_ASSERT_EQUAL_UINT32(0, missed);
+    TEST_ASSERT_TRUE(stats.sequence(SENSOR_A, 14, &missed));
+    TEST_ASSERT_EQUAL_UINT32(3, missed);
+    TEST_ASSERT_FALSE(stats.sequence(SENSOR_A, 14, &missed));
+    TEST_ASSERT_EQUAL_UINT32(3, stats.find(SENSOR_A)->missed);
+}
+
+static void test_sequence_accepts_late_frames_and_restarts(void) {
+    LinkStats stats;
+    uint32_t missed {0};
+
+    stats.update(SENSOR_A, -90, 0);
+    stats.sequence(SENSOR_A, 100, &missed);
+    stats.sequence(SENSOR_A, 103, &missed);
+
+    // A relayed frame arriving after a newer direct one is no longer missed.
+    TEST_ASSERT_TRUE(stats.sequence(SENSOR_A, 101, &missed));
+    TEST_ASSERT_EQUAL_UINT32(1, stats.find(SENSOR_A)->missed);
+
+    // A sensor restart starts a new sequence without counting a gap.
+    TEST_ASSERT_TRUE(stats.sequence(SENSOR_A, 1, &missed));
+    TEST_ASSERT_EQUAL_UINT32(0, missed);
+    TEST_ASSERT_TRUE(stats.sequence(SENSOR_A, 2, &missed));
+    TEST_ASSERT_EQUAL_UINT32(0, missed);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.find(SENSOR_A)->missed);
+}
+
+static void test_margin_follows_the_spreading_factor(void) {
+    LinkStats stats(7);
+    const link_stats_t *link = stats.update(SENSOR_A, -100, 0);
+
+    TEST_ASSERT_EQUAL_INT16(75, stats.marginTenths(*link));
+
+    stats.setSpreadingFactor(12);
+    TEST_ASSERT_EQUAL_INT16(200, stats.marginTenths(*link));
+
+    stats.setSpreadingFactor(3);                        // Clamped to SF7
+    TEST_ASSERT_EQUAL_INT16(-75, LinkStats::demodFloorTenths(3));
+    TEST_ASSERT_EQUAL_INT16(75, stats.marginTenths(*link));
+}
+
+static void test_advice_needs_samples_and_margin(void) {
+    LinkStats stats(9);
+    const link_stats_t *link {nullptr};
+
+    for (int i = 0; i < LINK_ADVICE_MIN_SAMPLES - 1; ++i) {
+        link = stats.update(SENSOR_A, -80, 5);          // 17.5 dB above the SF9 floor
+        stats.update(SENSOR_B, -125, -12);              // Below the SF9 floor
+    }
+
+    TEST_ASSERT_EQUAL(LinkAdvice::LINK_ADVICE_NONE, stats.advice(*link));
+
+    link = stats.update(SENSOR_A, -80, 5);
+    const link_stats_t *weak = stats.update(SENSOR_B, -125, -12);
+
+    TEST_ASSERT_EQUAL(LinkAdvice::LINK_ADVICE_FASTER, stats.advice(*link));
+    TEST_ASSERT_EQUAL(LinkAdvice::LINK_ADVICE_SLOWER, stats.advice(*weak));
+
+    stats.setSpreadingFactor(7);                        // Already the fastest
+    TEST_ASSERT_EQUAL(LinkAdvice::LINK_ADVICE_KEEP, stats.advice(*link));
+}
+
+int main(int /* argc */, char ** /* argv */) {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_sample_sets_every_statistic);
+    RUN_TEST(test_average_converges_and_range_is_kept);
+    RUN_TEST(test_weak_negative_samples_keep_their_average);
+    RUN_TEST(test_histograms_clamp_to_their_range);
+    RUN_TEST(test_sources_are_kept_apart);
+    RUN_TEST(test_least_recently_updated_source_is_recycled);
+    RUN_TEST(test_sequence_counts_gaps_and_repeats);
+    RUN_TEST(test_sequence_accepts_late_frames_and_restarts);
+    RUN_TEST(test_margin_follows_the_spreading_factor);
+    RUN_TEST(test_advice_needs_samples_and_margin);
+    return UNITY_END();
+}
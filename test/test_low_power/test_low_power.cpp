@@ -0,0 +1,275 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// test_low_power.cpp - Unit tests of the low-power receiver, on a simulated
+//                      radio and light sleep, see the stubs.
+
+#include <cstring>
+#include <LoRaWan_APP.h>
+#include <esp_sleep.h>
+#include <unity.h>
+#include "low_power.h"          // NOLINT
+#include "wall_clock.h"         // NOLINT
+
+constexpr int64_t  START_US {1000000};
+constexpr uint32_t FRAME_SYMBOLS {32};                  // After the preamble
+constexpr uint32_t SWEEP_FRAMES {61};
+
+static CadReceiver receiver;
+static RadioEvents_t events;
+static uint32_t received;
+static int64_t receivedUs;
+
+// The radio events, as the bridge sets them up in low-power mode
+static void onCadDone(bool detected) {
+    receiver.cadDone(detected);
+}
+
+static void onRxDone(uint8_t * /* payload */, uint16_t /* size */, int16_t /* rssi */,
+                     int8_t /* snr */) {
+    ++received;
+    receivedUs = monotonicUs();
+    Radio.Sleep();
+    receiver.rxDone(true);
+}
+
+static void onRxTimeout(void) {
+    Radio.Sleep();
+    receiver.rxDone(false);
+}
+
+static RadioProfile profile(uint8_t spreadingFactor, uint16_t preamble) {
+    RadioProfile result {};
+
+    strncpy(result.name, "test", sizeof(result.name));
+    result.frequency        = 915000000;
+    result.bandwidth        = 0;
+    result.spreading_factor = spreadingFactor;
+    result.coding_rate      = 1;
+    result.preamble_length  = preamble;
+
+    return result;
+}
+
+static uint32_t symbolUs(const RadioProfile &active) {
+    return (1U << active.spreading_factor) * 1000000U / 125000U;
+}
+
+static void begin(const RadioProfile &active) {
+    Radio.symbol_us = symbolUs(active);
+    receiver.begin(active);
+}
+
+// The radio task of the bridge, mutex aside
+static void run(const RadioProfile &active, int64_t untilUs) {
+    while (monotonicUs() < untilUs) {
+        receiver.cycle(active);
+        Radio.IrqProcess();
+        receiver.idle();
+    }
+}
+
+// Frames starting at every phase of the CAD cycle
+static void catchEveryFrame(const RadioProfile &active) {
+    uint32_t symbol = symbolUs(active);
+    int64_t  stepUs = static_cast<int64_t>(active.preamble_length) * symbol / SWEEP_FRAMES;
+
+    begin(active);
+    run(active, monotonicUs() + active.preamble_length * symbol);
+
+    for (uint32_t i = 0; i < SWEEP_FRAMES; ++i) {
+        int64_t start = monotonicUs() + i * stepUs;
+        int64_t end   = start + (active.preamble_length + FRAME_SYMBOLS) * symbol;
+
+        Radio.transmit(start, active.preamble_length, active.preamble_length + FRAME_SYMBOLS);
+        run(active, end + active.preamble_length * symbol);
+
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(i + 1, received, "Frame missed");
+        Radio.on_air = false;
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(SWEEP_FRAMES, receiver.statistics().packets);
+    TEST_ASSERT_EQUAL_UINT32(0, receiver.statistics().false_wakeups);
+}
+
+void setUp(void) {
+    hostMicros()     = START_US;
+    hostDelayCount() = 0;
+    hostRadio().reset();
+    hostSleep().reset();
+    hostSerial().clear();
+
+    events           = RadioEvents_t {};
+    events.CadDone   = onCadDone;
+    events.RxDone    = onRxDone;
+    events.RxTimeout = onRxTimeout;
+    Radio.Init(&events);
+
+    receiver   = CadReceiver();
+    received   = 0;
+    receivedUs = 0;
+}
+
+void tearDown(void) {}
+
+static void test_every_frame_is_caught_at_sf9_and_sf12(void) {
+    RadioProfile sf9 = profile(9, 8);
+    catchEveryFrame(sf9);
+    TEST_ASSERT_TRUE(receiver.cadCycles());
+
+    setUp();
+
+    RadioProfile sf12 = profile(12, 8);
+    catchEveryFrame(sf12);
+    TEST_ASSERT_TRUE(receiver.cadCycles());
+}
+
+static void test_every_frame_is_caught_at_sf7_with_a_long_preamble(void) {
+    RadioProfile sf7 = profile(7, 16);
+
+    catchEveryFrame(sf7);
+
+    TEST_ASSERT_TRUE(receiver.cadCycles());
+    TEST_ASSERT_GREATER_THAN_UINT32(0, receiver.sleepUs());
+}
+
+static void test_short_preamble_falls_back_to_continuous_reception(void) {
+    RadioProfile sf7 = profile(7, 8);
+
+    catchEveryFrame(sf7);
+
+    TEST_ASSERT_FALSE(receiver.cadCycles());
+    TEST_ASSERT_EQUAL_UINT32(0, Radio.cads);
+    TEST_ASSERT_EQUAL_UINT32(SWEEP_FRAMES, hostSleep().gpio_wakeups);
+
+    // The radio listens all the time, the ESP32 sleeps between the frames.
+    LowPowerDuty measured = receiver.duty();
+
+    TEST_ASSERT_EQUAL_INT64(measured.period_us, measured.radio_on_us);
+    TEST_ASSERT_GREATER_THAN_INT64(measured.period_us / 2, measured.cpu_sleep_us);
+}
+
+static void test_duty_cycle_report_accounts_for_the_time(void) {
+    RadioProfile sf9 = profile(9, 8);
+    int64_t cadUs = LOW_POWER_CAD_SYMBOLS * symbolUs(sf9);
+
+    begin(sf9);
+    run(sf9, START_US + 5000000);
+
+    LowPowerDuty measured = receiver.duty();
+    uint32_t cycles = receiver.statistics().cycles;
+
+    TEST_ASSERT_EQUAL_INT64(monotonicUs() - START_US, measured.period_us);
+    TEST_ASSERT_EQUAL_INT64(hostSleep().slept_us, measured.cpu_sleep_us);
+    TEST_ASSERT_EQUAL_UINT32(cycles, Radio.cads);
+    TEST_ASSERT_GREATER_OR_EQUAL_INT64(cycles * cadUs, measured.radio_on_us);
+    TEST_ASSERT_LESS_OR_EQUAL_INT64(cycles * (cadUs + 1000), measured.radio_on_us);
+
+    // Cheaper than the radio alone in continuous reception
+    TEST_ASSERT_LESS_THAN_UINT32(SX126X_RX_UA, measured.current_ua);
+    TEST_ASSERT_GREATER_THAN_UINT32(ESP32_LIGHT_SLEEP_UA, measured.current_ua);
+
+    receiver.report(0);
+
+    TEST_ASSERT_NOT_NULL(strstr(hostSerial().output(), "Low power: radio on"));
+    TEST_ASSERT_EQUAL_INT64(0, receiver.duty().period_us);
+    TEST_ASSERT_EQUAL_INT64(0, receiver.duty().radio_on_us);
+}
+
+static void test_noise_counts_a_false_wakeup(void) {
+    RadioProfile sf9 = profile(9, 8);
+
+    begin(sf9);
+    Radio.noise = true;
+    run(sf9, START_US + 1);
+
+    TEST_ASSERT_EQUAL_UINT32(1, receiver.statistics().detections);
+    TEST_ASSERT_EQUAL_UINT32(1, receiver.statistics().false_wakeups);
+    TEST_ASSERT_EQUAL_UINT32(0, receiver.statistics().packets);
+    TEST_ASSERT_EQUAL_UINT32(1, Radio.receptions);
+    TEST_ASSERT_TRUE(Radio.mode == HostRadio::Mode::SLEEP);
+}
+
+static void test_detection_wakes_on_the_end_of_the_frame(void) {
+    RadioProfile sf9 = profile(9, 8);
+    uint32_t symbol = symbolUs(sf9);
+    int64_t  start  = START_US + 3 * symbol;
+    int64_t  end    = start + (8 + FRAME_SYMBOLS) * symbol;
+
+    begin(sf9);
+    Radio.transmit(start, 8, 8 + FRAME_SYMBOLS);
+    run(sf9, end + 1);
+
+    TEST_ASSERT_EQUAL_UINT32(1, received);
+    TEST_ASSERT_EQUAL_UINT32(1, receiver.statistics().detections);
+    TEST_ASSERT_INT64_WITHIN(HostSleep::STEP_US, end, receivedUs);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, hostSleep().gpio_wakeups);
+    TEST_ASSERT_TRUE(Radio.mode == HostRadio::Mode::SLEEP);
+}
+
+static void test_profile_change_resizes_the_cycle(void) {
+    RadioProfile sf7 = profile(7, 8);
+    RadioProfile sf9 = profile(9, 8);
+
+    begin(sf7);
+    run(sf7, START_US + 100000);
+
+    TEST_ASSERT_FALSE(receiver.cadCycles());
+    TEST_ASSERT_TRUE(Radio.mode == HostRadio::Mode::RX);
+
+    Radio.symbol_us = symbolUs(sf9);
+    run(sf9, START_US + 200000);
+
+    TEST_ASSERT_TRUE(receiver.cadCycles());
+    TEST_ASSERT_GREATER_THAN_UINT32(0, Radio.cads);
+    TEST_ASSERT_TRUE(Radio.mode == HostRadio::Mode::SLEEP);
+}
+
+static void test_waits_block_instead_of_spinning(void) {
+    RadioProfile sf7 = profile(7, 16);
+
+    begin(sf7);
+    run(sf7, START_US + 1000000);
+
+    // The clock only moves when the task blocks, a spinning wait would never return.
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(2 * receiver.statistics().cycles,
+                                        hostDelayCount() + hostSleep().sleeps);
+}
+
+int main(int /* argc */, char ** /* argv */) {
+    UNITY_BEGIN();
+    RUN_TEST(test_every_frame_is_caught_at_sf9_and_sf12);
+    RUN_TEST(test_every_frame_is_caught_at_sf7_with_a_long_preamble);
+    RUN_TEST(test_short_preamble_falls_back_to_continuous_reception);
+    RUN_TEST(test_duty_cycle_report_accounts_for_the_time);
+    RUN_TEST(test_noise_counts_a_false_wakeup);
+    RUN_TEST(test_detection_wakes_on_the_end_of_the_frame);
+    RUN_TEST(test_profile_change_resizes_the_cycle);
+    RUN_TEST(test_waits_block_instead_of_spinning);
+    return UNITY_END();
+}
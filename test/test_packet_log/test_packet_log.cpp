@@ -0,0 +1,89 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// test_packet_log.cpp - Unit tests of the per-packet log.
+
+#include <string>
+#include <unity.h>
+#include "packet_log.h"         // NOLINT
+
+void setUp(void) {
+    Serial.clear();
+}
+
+void tearDown(void) {}
+
+static void test_lines_are_printed_in_order_on_flush(void) {
+    PacketLog log;
+
+    log.printf("Decoding failed: %s\n", "eof");
+    log.printf("Set json... failed (%d)\n", 503);
+
+    TEST_ASSERT_EQUAL_STRING("", Serial.output());
+    TEST_ASSERT_EQUAL_size_t(2, log.waiting());
+
+    log.flush();
+
+    TEST_ASSERT_EQUAL_STRING("Decoding failed: eof\nSet json... failed (503)\n", Serial.output());
+    TEST_ASSERT_EQUAL_size_t(0, log.waiting());
+}
+
+static void test_long_lines_are_truncated(void) {
+    PacketLog log;
+    std::string line(2 * PACKET_LOG_ENTRY_SIZE, 'x');
+
+    log.printf("%s", line.c_str());
+    log.flush();
+
+    TEST_ASSERT_EQUAL_size_t(PACKET_LOG_ENTRY_SIZE - 1, strlen(Serial.output()));
+}
+
+static void test_lines_are_dropped_when_every_entry_waits(void) {
+    PacketLog log;
+
+    for (int i = 0; i < PACKET_LOG_ENTRIES + 2; ++i) {
+        log.printf("%d\n", i);
+    }
+
+    TEST_ASSERT_EQUAL_size_t(PACKET_LOG_ENTRIES, log.waiting());
+    TEST_ASSERT_EQUAL_UINT32(2, log.droppedCount());
+
+    log.flush();
+    log.printf("again\n");
+    log.flush();
+
+    TEST_ASSERT_EQUAL_STRING("again\n", Serial.output() + strlen(Serial.output()) - 6);
+}
+
+int main(int /* argc */, char ** /* argv */) {
+    UNITY_BEGIN();
+    RUN_TEST(test_lines_are_printed_in_order_on_flush);
+    RUN_TEST(test_long_lines_are_truncated);
+    RUN_TEST(test_lines_are_dropped_when_every_entry_waits);
+    return UNITY_END();
+}
@@ -0,0 +1,223 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// test_payload_registry.cpp - Unit tests of the payload registry.
+
+#include <array>
+#include <cstring>
+#include <pb_decode.h>
+#include <pb_encode.h>
+#include <unity.h>
+#include "json_writer.h"        // NOLINT
+#include "payload_registry.h"   // NOLINT
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static size_t encodeLevel(uint8_t *frame, size_t size, bool legacy) {
+    LoraPayload level = LoraPayload_init_zero;
+    size_t offset = legacy ? 0 : 1;
+
+    level.id            = 42;
+    level.distance      = 1234;
+    level.level         = 87;
+    level.err_sensor    = 1;
+    level.has_sensor_id = true;
+    level.sensor_id     = 0x01020304;
+    level.has_boot_id   = true;
+    level.boot_id       = 5;
+
+    frame[0] = static_cast<uint8_t>(PayloadTypeId::PAYLOAD_TYPE_WATER_LEVEL);
+
+    pb_ostream_t stream = pb_ostream_from_buffer(frame + offset, size - offset);
+
+    return pb_encode(&stream, LoraPayload_fields, &level) ? stream.bytes_written + offset : 0;
+}
+
+static void test_enveloped_frame_is_split_after_the_type(void) {
+    std::array<uint8_t, 32> frame;
+    size_t size = encodeLevel(frame.data(), frame.size(), false);
+    const uint8_t *body {nullptr};
+    size_t bodySize {0};
+
+    TEST_ASSERT_EQUAL_UINT8(static_cast<uint8_t>(PayloadTypeId::PAYLOAD_TYPE_WATER_LEVEL),
+                            static_cast<uint8_t>(payloadFrameType(frame.data(), size, &body, &bodySize)));
+    TEST_ASSERT_EQUAL_PTR(frame.data() + 1, body);
+    TEST_ASSERT_EQUAL_size_t(size - 1, bodySize);
+}
+
+static void test_legacy_frame_is_a_whole_water_level_message(void) {
+    std::array<uint8_t, 32> frame;
+    size_t size = encodeLevel(frame.data(), frame.size(), true);
+    const uint8_t *body {nullptr};
+    size_t bodySize {0};
+
+    TEST_ASSERT_EQUAL_UINT8(PAYLOAD_LEGACY_TAG, frame[0]);
+    TEST_ASSERT_EQUAL_UINT8(static_cast<uint8_t>(PayloadTypeId::PAYLOAD_TYPE_WATER_LEVEL),
+                            static_cast<uint8_t>(payloadFrameType(frame.data(), size, &body, &bodySize)));
+    TEST_ASSERT_EQUAL_PTR(frame.data(), body);
+    TEST_ASSERT_EQUAL_size_t(size, bodySize);
+}
+
+static void test_empty_frame_has_no_type(void) {
+    uint8_t frame {0};
+    const uint8_t *body {nullptr};
+    size_t bodySize {0};
+
+    TEST_ASSERT_EQUAL_UINT8(static_cast<uint8_t>(PayloadTypeId::PAYLOAD_TYPE_NONE),
+                            static_cast<uint8_t>(payloadFrameType(&frame, 0, &body, &bodySize)));
+}
+
+static void test_only_sensor_types_are_registered(void) {
+    TEST_ASSERT_NULL(payloadType(static_cast<uint8_t>(PayloadTypeId::PAYLOAD_TYPE_NONE)));
+    TEST_ASSERT_NOT_NULL(payloadType(static_cast<uint8_t>(PayloadTypeId::PAYLOAD_TYPE_WATER_LEVEL)));
+    TEST_ASSERT_NOT_NULL(payloadType(static_cast<uint8_t>(PayloadTypeId::PAYLOAD_TYPE_AIR)));
+    TEST_ASSERT_NULL(payloadType(static_cast<uint8_t>(PayloadTypeId::PAYLOAD_TYPE_RELAY_BATCH)));
+    TEST_ASSERT_NULL(payloadType(0xFF));
+}
+
+static void test_paths_are_relative_to_the_database_path(void) {
+    for (uint8_t i = 0; i < PAYLOAD_TYPE_COUNT; ++i) {
+        const PayloadType *type = payloadType(i);
+
+        if (type == nullptr) {
+            continue;
+        }
+
+        TEST_ASSERT_NOT_EQUAL('/', type->path[0]);
+        TEST_ASSERT_EQUAL('/', type->path[strlen(type->path) - 1]);
+        TEST_ASSERT_NULL(strstr(type->path, "water_tank"));
+    }
+}
+
+static void test_water_level_header_and_fields(void) {
+    std::array<uint8_t, 32> frame;
+    size_t size = encodeLevel(frame.data(), frame.size(), false);
+    const PayloadType *type = payloadType(frame[0]);
+    PayloadBody body {};
+    pb_istream_t stream = pb_istream_from_buffer(frame.data() + 1, size - 1);
+
+    TEST_ASSERT_TRUE(pb_decode(&stream, type->fields, &body));
+
+    PayloadHeader header = type->header(body);
+
+    TEST_ASSERT_EQUAL_UINT32(0x01020304, header.sensor_id);
+    TEST_ASSERT_EQUAL_UINT32(42, header.packet_id);
+    TEST_ASSERT_EQUAL_UINT32(1, header.err_sensor);
+    TEST_ASSERT_EQUAL_UINT32(5, header.boot_id);
+    TEST_ASSERT_TRUE(payloadIdentified(header));
+
+    std::array<char, 96> text;
+    JsonWriter json(text.data(), text.size());
+
+    type->serialize(body, &json);
+    json.finish();
+
+    TEST_ASSERT_EQUAL_STRING("{\"level\":\"87\",\"distance\":\"1234\",\"error\":\"1\"}", text.data());
+}
+
+static void test_air_fields(void) {
+    PayloadBody body {};
+    const PayloadType *type = payloadType(static_cast<uint8_t>(PayloadTypeId::PAYLOAD_TYPE_AIR));
+
+    body.air.id          = 7;
+    body.air.temperature = -75;
+    body.air.err_sensor  = 0;
+
+    std::array<char, 64> text;
+    JsonWriter json(text.data(), text.size());
+
+    type->serialize(body, &json);
+    json.finish();
+
+    TEST_ASSERT_EQUAL_STRING("{\"temperature\":-7.5,\"error\":\"0\"}", text.data());
+}
+
+static void test_sources_keep_the_whole_sensor_id(void) {
+    uint64_t low  = payloadSource(PayloadTypeId::PAYLOAD_TYPE_WATER_LEVEL, 0x00000001);
+    uint64_t high = payloadSource(PayloadTypeId::PAYLOAD_TYPE_WATER_LEVEL, 0x01000001);
+    uint64_t air  = payloadSource(PayloadTypeId::PAYLOAD_TYPE_AIR, 0x00000001);
+
+    TEST_ASSERT_NOT_EQUAL_UINT64(low, high);
+    TEST_ASSERT_NOT_EQUAL_UINT64(low, air);
+    TEST_ASSERT_EQUAL_UINT32(0x01000001, payloadSourceSensor(high));
+    TEST_ASSERT_EQUAL_UINT8(static_cast<uint8_t>(PayloadTypeId::PAYLOAD_TYPE_AIR), payloadSourceType(air));
+}
+
+static void test_frames_without_sensor_or_boot_id_are_not_identified(void) {
+    const PayloadType *type = payloadType(static_cast<uint8_t>(PayloadTypeId::PAYLOAD_TYPE_AIR));
+    PayloadBody body {};
+
+    body.air = AirPayload_init_zero;
+    TEST_ASSERT_FALSE(payloadIdentified(type->header(body)));
+
+    body.air.has_sensor_id = true;
+    TEST_ASSERT_FALSE(payloadIdentified(type->header(body)));
+
+    body.air.has_boot_id = true;
+    TEST_ASSERT_TRUE(payloadIdentified(type->header(body)));
+
+    body.air.has_sensor_id = false;
+    TEST_ASSERT_FALSE(payloadIdentified(type->header(body)));
+}
+
+static void test_identified_frame_fits_a_sensor_frame(void) {
+    LoraPayload level = LoraPayload_init_zero;
+    std::array<uint8_t, 64> frame;
+
+    // Packet ID of a sensor sending every minute for 30 years, whole 32-bit IDs.
+    level.id            = 16000000;
+    level.distance      = 9999;
+    level.level         = 100;
+    level.err_sensor    = 1;
+    level.err_lora      = 1;
+    level.has_sensor_id = true;
+    level.sensor_id     = 0xFFFFFFFF;
+    level.has_boot_id   = true;
+    level.boot_id       = 0xFFFFFFFF;
+
+    pb_ostream_t stream = pb_ostream_from_buffer(frame.data() + 1, frame.size() - 1);
+
+    TEST_ASSERT_TRUE(pb_encode(&stream, LoraPayload_fields, &level));
+    TEST_ASSERT_LESS_OR_EQUAL(LORA_SENSOR_MAX_PAYLOAD, 1 + stream.bytes_written);
+}
+
+int main(int /* argc */, char ** /* argv */) {
+    UNITY_BEGIN();
+    RUN_TEST(test_enveloped_frame_is_split_after_the_type);
+    RUN_TEST(test_legacy_frame_is_a_whole_water_level_message);
+    RUN_TEST(test_empty_frame_has_no_type);
+    RUN_TEST(test_only_sensor_types_are_registered);
+    RUN_TEST(test_paths_are_relative_to_the_database_path);
+    RUN_TEST(test_water_level_header_and_fields);
+    RUN_TEST(test_air_fields);
+    RUN_TEST(test_sources_keep_the_whole_sensor_id);
+    RUN_TEST(test_frames_without_sensor_or_boot_id_are_not_identified);
+    RUN_TEST(test_identified_frame_fits_a_sensor_frame);
+    return UNITY_END();
+}
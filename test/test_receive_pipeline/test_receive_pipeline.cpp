@@ -0,0 +1,299 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// File description
+// =========================================================
+// test_receive_pipeline.cpp - Unit tests of the receive pipeline.
+//
+// Relay batches are unpacked only by the builds that receive them, see
+// LORA_RELAY_BATCHES: the relay test checks whichever applies.
+
+#include <array>
+#include <cstring>
+#include <pb_encode.h>
+#include <unity.h>
+#include "receive_pipeline.h"   // NOLINT
+#include "relay.h"              // NOLINT
+
+constexpr uint32_t SENSOR_ID {7};
+constexpr uint32_t BOOT_ID   {0x5EED0007};
+constexpr int64_t  NOW_US    {INT64_C(3600) * 1000000};
+
+using Frame = std::array<uint8_t, LORA_RELAY_MAX_PAYLOAD>;
+
+typedef struct {
+    uint32_t        calls;
+    uint32_t        gui_calls;
+    bool            gui_first;                          // The GUI hook ran before the reading hook
+    ReceivedReading last;
+    SensorReading   reading;
+} hook_log_t;
+
+static hook_log_t hookLog;
+
+static void onGui(const ReceivedReading &reading);
+static void onReading(const ReceivedReading &reading);
+
+static ReceivePipeline pipeline({onGui, onReading}, nullptr);
+static Frame frame;
+static Frame batchFrame;
+
+static void onGui(const ReceivedReading & /* reading */) {
+    ++hookLog.gui_calls;
+}
+
+static void onReading(const ReceivedReading &reading) {
+    ++hookLog.calls;
+    hookLog.gui_first = hookLog.gui_calls == hookLog.calls;
+    hookLog.last = reading;
+    pipeline.fillReading(reading, &hookLog.reading);
+}
+
+static size_t encodeLevel(uint32_t packetId, uint8_t level, Frame *out) {
+    LoraPayload payload = LoraPayload_init_zero;
+
+    payload.id            = packetId;
+    payload.level         = level;
+    payload.err_sensor    = 2;
+    payload.has_sensor_id = true;
+    payload.sensor_id     = SENSOR_ID;
+    payload.has_boot_id   = true;
+    payload.boot_id       = BOOT_ID;
+
+    (*out)[0] = static_cast<uint8_t>(PayloadTypeId::PAYLOAD_TYPE_WATER_LEVEL);
+
+    pb_ostream_t stream = pb_ostream_from_buffer(out->data() + 1, out->size() - 1);
+    TEST_ASSERT_TRUE(pb_encode(&stream, LoraPayload_fields, &payload));
+
+    return 1 + stream.bytes_written;
+}
+
+static void receiveLevel(uint32_t packetId, uint8_t level) {
+    size_t size = encodeLevel(packetId, level, &frame);
+
+    pipeline.receive(frame.data(), size, -90, 6, NOW_US);
+}
+
+// Each reading of the clock is 10 ns after the previous one.
+static int64_t fakeClockNs(void) {
+    static int64_t now {0};
+    return now += 10;
+}
+
+void setUp(void) {
+    pipeline.reset(7);
+    pipeline.setTimer(nullptr);
+    hookLog = hook_log_t {};
+}
+
+void tearDown(void) {}
+
+static void test_new_reading_goes_through_every_stage(void) {
+    size_t size = encodeLevel(10, 55, &frame);
+
+    pipeline.receive(frame.data(), size, -90, 6, NOW_US);
+
+    TEST_ASSERT_EQUAL_UINT32(1, hookLog.calls);
+    TEST_ASSERT_TRUE(hookLog.gui_first);
+
+    const ReceivedReading &last = hookLog.last;
+
+    TEST_ASSERT_TRUE(last.type == PayloadTypeId::PAYLOAD_TYPE_WATER_LEVEL);
+    TEST_ASSERT_EQUAL_UINT32(10, last.header.packet_id);
+    TEST_ASSERT_EQUAL_UINT32(SENSOR_ID, last.header.sensor_id);
+    TEST_ASSERT_TRUE(last.frame == frame.data());
+    TEST_ASSERT_EQUAL_size_t(size, last.size);
+    TEST_ASSERT_EQUAL_UINT32(0, last.hops);
+    TEST_ASSERT_TRUE(last.captured_us == NOW_US);
+
+    const SensorReading &reading = hookLog.reading;
+
+    TEST_ASSERT_EQUAL_UINT32(55, reading.body.water_level.level);
+    TEST_ASSERT_EQUAL_INT16(-90, reading.rssi);
+    TEST_ASSERT_EQUAL_INT16(-90, reading.rssi_avg);
+    TEST_ASSERT_EQUAL_INT8(6, reading.snr);
+    TEST_ASSERT_EQUAL_UINT8(0, reading.hops);
+    TEST_ASSERT_TRUE(reading.captured_us == NOW_US);
+
+    OledGuiData gui {};
+    pipeline.copyGui(&gui);
+
+    TEST_ASSERT_EQUAL_UINT8(55, gui.info.water_level);
+    TEST_ASSERT_EQUAL_UINT32(10, gui.stats.received_packet_id);
+    TEST_ASSERT_EQUAL_UINT32(2, gui.stats.sensor_error_count);
+    TEST_ASSERT_EQUAL_INT16(-90, gui.stats.rssi);
+    TEST_ASSERT_EQUAL_UINT8(1, pipeline.history().count());
+    TEST_ASSERT_EQUAL_UINT32(1, pipeline.statistics().frames);
+    TEST_ASSERT_EQUAL_UINT32(1, pipeline.statistics().readings);
+}
+
+static void test_repeated_and_missed_frames(void) {
+    receiveLevel(10, 55);
+    receiveLevel(10, 55);
+    receiveLevel(13, 50);
+
+#ifndef BRIDGE_NO_RECENT_FILTER
+    TEST_ASSERT_EQUAL_UINT32(1, pipeline.statistics().suppressed);
+#endif
+    TEST_ASSERT_EQUAL_UINT32(2, hookLog.calls);
+    TEST_ASSERT_EQUAL_UINT32(2, hookLog.last.missed);
+    TEST_ASSERT_EQUAL_UINT32(1, pipeline.statistics().errors);
+    TEST_ASSERT_EQUAL_UINT32(2, pipeline.statistics().missed);
+
+    OledGuiData gui {};
+    pipeline.copyGui(&gui);
+
+    TEST_ASSERT_EQUAL_UINT32(1, gui.stats.receive_error_count);
+    TEST_ASSERT_EQUAL_UINT8(50, gui.info.water_level);
+}
+
+static void test_rejected_frames_are_counted(void) {
+    std::array<uint8_t, LORA_MAX_PAYLOAD_LENGTH + 1> oversized {};
+    const uint8_t unknown[] {0x7F, 0x08, 0x01};
+    const uint8_t truncated[] {static_cast<uint8_t>(PayloadTypeId::PAYLOAD_TYPE_WATER_LEVEL), 0x08};
+
+    oversized[0] = static_cast<uint8_t>(PayloadTypeId::PAYLOAD_TYPE_WATER_LEVEL);
+
+    pipeline.receive(oversized.data(), oversized.size(), -90, 6, NOW_US);
+    pipeline.receive(unknown, sizeof(unknown), -90, 6, NOW_US);
+    pipeline.receive(truncated, sizeof(truncated), -90, 6, NOW_US);
+
+    const ReceiveCounters &counters = pipeline.statistics();
+
+    TEST_ASSERT_EQUAL_UINT32(3, counters.frames);
+    TEST_ASSERT_EQUAL_UINT32(1, counters.oversize);
+    TEST_ASSERT_EQUAL_UINT32(1, counters.unknown);
+    TEST_ASSERT_EQUAL_UINT32(1, counters.undecodable);
+    TEST_ASSERT_EQUAL_UINT32(0, counters.readings);
+    TEST_ASSERT_EQUAL_UINT32(0, hookLog.calls);
+    TEST_ASSERT_EQUAL_UINT32(0, hookLog.gui_calls);
+}
+
+static void test_relay_batches_are_unpacked_where_received(void) {
+    RelayAggregator relay;
+
+    relay.begin(0x00C0FFEE);
+    relay.add(frame.data(), encodeLevel(20, 40, &frame), -118, -9, 0, 0);     // Heard by the relay
+    relay.add(frame.data(), encodeLevel(21, 41, &frame), -117, -8, 1, 0);     // Relayed already
+
+    // Held longer than this bridge has been up
+    size_t length = relay.encode(batchFrame.data(), batchFrame.size(), 2000000);
+    pipeline.receive(batchFrame.data(), length, -95, 4, 500000);
+
+    // Too long for a sensor frame, or else of an unknown type
+    if (!LORA_RELAY_BATCHES) {
+        const ReceiveCounters &counters = pipeline.statistics();
+
+        TEST_ASSERT_EQUAL_UINT32(0, hookLog.calls);
+        TEST_ASSERT_EQUAL_UINT32(1, length > LORA_MAX_PAYLOAD_LENGTH ? counters.oversize : counters.unknown);
+        return;
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(2, hookLog.calls);
+    TEST_ASSERT_EQUAL_UINT32(21, hookLog.last.header.packet_id);
+    TEST_ASSERT_EQUAL_UINT32(2, hookLog.last.hops);
+    TEST_ASSERT_EQUAL_INT16(-117, hookLog.last.rssi);
+    TEST_ASSERT_TRUE(hookLog.last.captured_us == 0);
+    TEST_ASSERT_EQUAL_UINT8(2, hookLog.reading.hops);
+
+    // A relayed frame without a hop count still went through one relay.
+    RelayBatch batch = RelayBatch_init_zero;
+    size_t size = encodeLevel(22, 42, &frame);
+
+    batch.relay_id      = 0x00C0FFEE;
+    batch.seq           = 1;
+    batch.entries_count = 1;
+    batch.entries[0].frame.size = static_cast<pb_size_t>(size);
+    memcpy(batch.entries[0].frame.bytes, frame.data(), size);
+
+    batchFrame[0] = static_cast<uint8_t>(PayloadTypeId::PAYLOAD_TYPE_RELAY_BATCH);
+
+    pb_ostream_t stream = pb_ostream_from_buffer(batchFrame.data() + 1, batchFrame.size() - 1);
+    TEST_ASSERT_TRUE(pb_encode(&stream, RelayBatch_fields, &batch));
+
+    pipeline.receive(batchFrame.data(), 1 + stream.bytes_written, -95, 4, NOW_US);
+
+    TEST_ASSERT_EQUAL_UINT32(3, hookLog.calls);
+    TEST_ASSERT_EQUAL_UINT32(1, hookLog.last.hops);
+    TEST_ASSERT_TRUE(hookLog.last.captured_us == NOW_US);
+}
+
+static void test_stage_timer_laps_each_stage(void) {
+    StageTimer timer;
+    std::array<char, REPLAY_RESULT_SIZE> text;
+
+    pipeline.setTimer(&timer);
+    timer.enable(fakeClockNs);
+
+    receiveLevel(10, 55);
+    receiveLevel(10, 55);
+    receiveLevel(11, 56);
+
+    timer.disable();
+
+    ReplayResult result {false, 3, 1, 2000, 0};
+
+    TEST_ASSERT_GREATER_THAN_size_t(0, pipeline.replayJson(result, text.data(), text.size()));
+    TEST_ASSERT_NOT_NULL(strstr(text.data(), "{\"replay\":\"max\",\"frames\":3,\"passes\":1,"
+                                             "\"duration_ms\":2,\"frames_per_s\":1500,"));
+    TEST_ASSERT_NOT_NULL(strstr(text.data(), "\"decode\":{\"n\":3,\"avg_ns\":10,\"max_ns\":10}"));
+#ifndef BRIDGE_NO_RECENT_FILTER
+    TEST_ASSERT_NOT_NULL(strstr(text.data(), "\"dedup\":{\"n\":2,"));
+#endif
+    TEST_ASSERT_NOT_NULL(strstr(text.data(), "\"gui\":{\"n\":2,"));
+    TEST_ASSERT_NOT_NULL(strstr(text.data(), "\"uplink\":{\"n\":2,"));
+    TEST_ASSERT_NOT_NULL(strstr(text.data(), "\"allocations\":0,"));
+    TEST_ASSERT_NOT_NULL(strstr(text.data(), "\"readings\":2,"));
+    TEST_ASSERT_NOT_NULL(strstr(text.data(), "\"gui_packet_id\":11,\"history_sensors\":1}}"));
+}
+
+static void test_reset_empties_the_pipeline(void) {
+    receiveLevel(10, 55);
+    pipeline.reset(7);
+
+    OledGuiData gui {};
+    pipeline.copyGui(&gui);
+
+    TEST_ASSERT_EQUAL_UINT32(0, gui.stats.received_packet_id);
+    TEST_ASSERT_EQUAL_UINT8(0, pipeline.history().count());
+    TEST_ASSERT_EQUAL_UINT32(0, pipeline.statistics().frames);
+
+    // The same frame again is a new reading, not a repeat.
+    receiveLevel(10, 55);
+    TEST_ASSERT_EQUAL_UINT32(2, hookLog.calls);
+}
+
+int main(int /* argc */, char ** /* argv */) {
+    UNITY_BEGIN();
+    RUN_TEST(test_new_reading_goes_through_every_stage);
+    RUN_TEST(test_repeated_and_missed_frames);
+    RUN_TEST(test_rejected_frames_are_counted);
+    RUN_TEST(test_relay_batches_are_unpacked_where_received);
+    RUN_TEST(test_stage_timer_laps_each_stage);
+    RUN_TEST(test_reset_empties_the_pipeline);
+    return UNITY_END();
+}
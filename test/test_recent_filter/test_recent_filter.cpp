@@ -0,0 +1,112 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// test_recent_filter.cpp - Unit tests of the recently-seen frame filter.
+
+#include <array>
+#include <unity.h>
+#include "payload_registry.h"   // NOLINT
+#include "recent_filter.h"      // NOLINT
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_repeated_key_is_rejected(void) {
+    RecentFilter filter;
+
+    TEST_ASSERT_TRUE(filter.insert(1234));
+    TEST_ASSERT_FALSE(filter.insert(1234));
+    TEST_ASSERT_TRUE(filter.contains(1234));
+}
+
+static void test_key_zero_is_ignored(void) {
+    RecentFilter filter;
+
+    TEST_ASSERT_FALSE(filter.insert(0));
+    TEST_ASSERT_FALSE(filter.contains(0));
+}
+
+static void test_oldest_key_is_forgotten_when_full(void) {
+    RecentFilter filter;
+
+    for (uint64_t key = 1; key <= RECENT_FILTER_CAPACITY + 1; ++key) {
+        TEST_ASSERT_TRUE(filter.insert(key));
+    }
+
+    TEST_ASSERT_FALSE(filter.contains(1));
+
+    for (uint64_t key = 2; key <= RECENT_FILTER_CAPACITY + 1; ++key) {
+        TEST_ASSERT_TRUE(filter.contains(key));
+    }
+}
+
+static void test_evictions_keep_the_other_keys_reachable(void) {
+    RecentFilter filter;
+    std::array<uint64_t, 8 * RECENT_FILTER_CAPACITY> keys;
+
+    // Frame keys spread over the table, so some probe past others.
+    for (size_t i = 0; i < keys.size(); ++i) {
+        keys[i] = RecentFilter::frameKey(i % 5, 0, static_cast<uint32_t>(i));
+        TEST_ASSERT_TRUE(filter.insert(keys[i]));
+
+        size_t oldest = (i + 1 > RECENT_FILTER_CAPACITY) ? i + 1 - RECENT_FILTER_CAPACITY : 0;
+
+        for (size_t j = oldest; j <= i; ++j) {
+            TEST_ASSERT_TRUE(filter.contains(keys[j]));
+        }
+
+        if (oldest > 0) {
+            TEST_ASSERT_FALSE(filter.contains(keys[oldest - 1]));
+        }
+    }
+}
+
+static void test_frame_keys_separate_sources_boots_and_packets(void) {
+    uint64_t sensorA = payloadSource(PayloadTypeId::PAYLOAD_TYPE_WATER_LEVEL, 0x00000001);
+    uint64_t sensorB = payloadSource(PayloadTypeId::PAYLOAD_TYPE_WATER_LEVEL, 0x01000001);
+    uint64_t airA    = payloadSource(PayloadTypeId::PAYLOAD_TYPE_AIR, 0x00000001);
+
+    RecentFilter filter;
+
+    TEST_ASSERT_TRUE(filter.insert(RecentFilter::frameKey(sensorA, 1, 7)));
+    TEST_ASSERT_TRUE(filter.insert(RecentFilter::frameKey(sensorB, 1, 7)));
+    TEST_ASSERT_TRUE(filter.insert(RecentFilter::frameKey(airA, 1, 7)));
+    TEST_ASSERT_TRUE(filter.insert(RecentFilter::frameKey(sensorA, 1, 8)));
+    TEST_ASSERT_TRUE(filter.insert(RecentFilter::frameKey(sensorA, 2, 7)));
+    TEST_ASSERT_FALSE(filter.insert(RecentFilter::frameKey(sensorA, 1, 7)));
+}
+
+int main(int /* argc */, char ** /* argv */) {
+    UNITY_BEGIN();
+    RUN_TEST(test_repeated_key_is_rejected);
+    RUN_TEST(test_key_zero_is_ignored);
+    RUN_TEST(test_oldest_key_is_forgotten_when_full);
+    RUN_TEST(test_evictions_keep_the_other_keys_reachable);
+    RUN_TEST(test_frame_keys_separate_sources_boots_and_packets);
+    return UNITY_END();
+}
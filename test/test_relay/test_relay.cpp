@@ -0,0 +1,205 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// File description
+// =========================================================
+// test_relay.cpp - Unit tests of the relay aggregator.
+
+#include <array>
+#include <pb_decode.h>
+#include <unity.h>
+#include "payload_registry.h"   // NOLINT
+#include "relay.h"              // NOLINT
+
+constexpr int64_t HOLD_US {static_cast<int64_t>(RELAY_MAX_HOLD_MS) * 1000};
+
+static RelayAggregator relay;
+static std::array<uint8_t, LORA_SENSOR_MAX_PAYLOAD> sensorFrame;
+static std::array<uint8_t, LORA_RELAY_MAX_PAYLOAD> relayFrame;
+
+void setUp(void) {
+    relay = RelayAggregator();
+    relay.begin(0x00ABCDEF);
+
+    for (size_t i = 0; i < sensorFrame.size(); ++i) {
+        sensorFrame[i] = static_cast<uint8_t>(0xA0 + i);
+    }
+}
+
+void tearDown(void) {}
+
+static bool decodeBatch(size_t length, RelayBatch *batch) {
+    pb_istream_t stream = pb_istream_from_buffer(relayFrame.data() + 1, length - 1);
+
+    *batch = RelayBatch_init_zero;
+
+    return relayFrame[0] == static_cast<uint8_t>(PayloadTypeId::PAYLOAD_TYPE_RELAY_BATCH) &&
+           pb_decode(&stream, RelayBatch_fields, batch);
+}
+
+static void test_empty_batch_is_never_ready(void) {
+    TEST_ASSERT_FALSE(relay.ready(0));
+    TEST_ASSERT_FALSE(relay.ready(10 * HOLD_US));
+}
+
+static void test_batch_is_ready_when_full(void) {
+    for (size_t i = 0; i < RELAY_MAX_ENTRIES; ++i) {
+        TEST_ASSERT_FALSE(relay.ready(1000));
+        TEST_ASSERT_TRUE(relay.add(sensorFrame.data(), 12, -80, 5, 0, 1000));
+    }
+
+    TEST_ASSERT_TRUE(relay.ready(1000));
+}
+
+static void test_batch_is_ready_when_the_oldest_frame_is_held_long_enough(void) {
+    TEST_ASSERT_TRUE(relay.add(sensorFrame.data(), 12, -80, 5, 0, 1000));
+    TEST_ASSERT_TRUE(relay.add(sensorFrame.data(), 12, -80, 5, 0, 1000 + HOLD_US / 2));
+
+    TEST_ASSERT_FALSE(relay.ready(1000 + HOLD_US - 1));
+    TEST_ASSERT_TRUE(relay.ready(1000 + HOLD_US));
+}
+
+static void test_frames_over_the_hop_limit_or_the_entry_size_are_dropped(void) {
+    std::array<uint8_t, LORA_SENSOR_MAX_PAYLOAD + 1> oversized {};
+
+    TEST_ASSERT_FALSE(relay.add(sensorFrame.data(), 12, -80, 5, RELAY_MAX_HOPS, 1000));
+    TEST_ASSERT_FALSE(relay.add(oversized.data(), oversized.size(), -80, 5, 0, 1000));
+    TEST_ASSERT_TRUE(relay.add(sensorFrame.data(), 12, -80, 5, RELAY_MAX_HOPS - 1, 1000));
+
+    TEST_ASSERT_EQUAL_UINT32(3, relay.statistics().frames_in);
+    TEST_ASSERT_EQUAL_UINT32(2, relay.statistics().frames_dropped);
+}
+
+static void test_frames_beyond_a_full_batch_are_dropped(void) {
+    for (size_t i = 0; i < RELAY_MAX_ENTRIES; ++i) {
+        relay.add(sensorFrame.data(), 12, -80, 5, 0, 1000);
+    }
+
+    TEST_ASSERT_FALSE(relay.add(sensorFrame.data(), 12, -80, 5, 0, 1000));
+    TEST_ASSERT_EQUAL_UINT32(1, relay.statistics().frames_dropped);
+}
+
+static void test_full_batch_of_largest_frames_fits_a_relay_frame(void) {
+    for (size_t i = 0; i < RELAY_MAX_ENTRIES; ++i) {
+        TEST_ASSERT_TRUE(relay.add(sensorFrame.data(), sensorFrame.size(), -32768, -128,
+                                   RELAY_MAX_HOPS - 1, 0));
+    }
+
+    // The worst case age fits in 5 bytes, like the worst case RSSI and SNR.
+    size_t length = relay.encode(relayFrame.data(), relayFrame.size(), INT64_C(0xFFFFFFFF) * 1000);
+
+    TEST_ASSERT_GREATER_THAN_size_t(0, length);
+    TEST_ASSERT_LESS_OR_EQUAL_size_t(LORA_RELAY_MAX_PAYLOAD, length);
+    TEST_ASSERT_LESS_OR_EQUAL_size_t(LORA_RELAY_MAX_PAYLOAD, 1 + RelayBatch_size);
+}
+
+static void test_encoded_batch_keeps_frames_and_link_data(void) {
+    relay.add(sensorFrame.data(), 12, -97, -7, 0, 1000);
+    relay.add(sensorFrame.data() + 1, 20, -60, 9, 1, 1000 + 250000);
+
+    size_t length = relay.encode(relayFrame.data(), relayFrame.size(), 1000 + 500000);
+    RelayBatch batch;
+
+    TEST_ASSERT_TRUE(decodeBatch(length, &batch));
+    TEST_ASSERT_EQUAL_UINT32(0x00ABCDEF, batch.relay_id);
+    TEST_ASSERT_EQUAL_UINT32(0, batch.seq);
+    TEST_ASSERT_EQUAL(2, batch.entries_count);
+
+    TEST_ASSERT_EQUAL(12, batch.entries[0].frame.size);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(sensorFrame.data(), batch.entries[0].frame.bytes, 12);
+    TEST_ASSERT_EQUAL_INT32(-97, batch.entries[0].rssi);
+    TEST_ASSERT_EQUAL_INT32(-7, batch.entries[0].snr);
+    TEST_ASSERT_EQUAL_UINT32(1, batch.entries[0].hops);
+    TEST_ASSERT_EQUAL_UINT32(500, batch.entries[0].age_ms);
+
+    TEST_ASSERT_EQUAL(20, batch.entries[1].frame.size);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(sensorFrame.data() + 1, batch.entries[1].frame.bytes, 20);
+    TEST_ASSERT_EQUAL_UINT32(2, batch.entries[1].hops);
+    TEST_ASSERT_EQUAL_UINT32(250, batch.entries[1].age_ms);
+
+    TEST_ASSERT_EQUAL_UINT32(1, relay.statistics().batches_out);
+    TEST_ASSERT_EQUAL_UINT32(2, relay.statistics().entries_out);
+}
+
+static void test_encode_starts_the_next_batch(void) {
+    relay.add(sensorFrame.data(), 12, -80, 5, 0, 1000);
+    relay.encode(relayFrame.data(), relayFrame.size(), 2000);
+
+    TEST_ASSERT_FALSE(relay.ready(10 * HOLD_US));
+
+    relay.add(sensorFrame.data(), 12, -80, 5, 0, 3000);
+
+    size_t length = relay.encode(relayFrame.data(), relayFrame.size(), 4000);
+    RelayBatch batch;
+
+    TEST_ASSERT_TRUE(decodeBatch(length, &batch));
+    TEST_ASSERT_EQUAL_UINT32(1, batch.seq);
+    TEST_ASSERT_EQUAL(1, batch.entries_count);
+}
+
+static void test_entry_ages_are_clamped(void) {
+    RelayBatch batch;
+
+    TEST_ASSERT_TRUE(relay.add(sensorFrame.data(), 12, -80, 5, 0, 5 * HOLD_US));
+    TEST_ASSERT_TRUE(relay.add(sensorFrame.data(), 12, -80, 5, 0, 0));
+
+    size_t length = relay.encode(relayFrame.data(), relayFrame.size(), HOLD_US);
+
+    TEST_ASSERT_TRUE(decodeBatch(length, &batch));
+    TEST_ASSERT_EQUAL_UINT32(0, batch.entries[0].age_ms);
+    TEST_ASSERT_EQUAL_UINT32(RELAY_MAX_HOLD_MS, batch.entries[1].age_ms);
+
+    TEST_ASSERT_TRUE(relay.add(sensorFrame.data(), 12, -80, 5, 0, 0));
+    length = relay.encode(relayFrame.data(), relayFrame.size(),
+                          static_cast<int64_t>(RELAY_MAX_AGE_MS) * 2000);
+
+    TEST_ASSERT_TRUE(decodeBatch(length, &batch));
+    TEST_ASSERT_EQUAL_UINT32(RELAY_MAX_AGE_MS, batch.entries[0].age_ms);
+}
+
+static void test_batch_that_does_not_fit_the_buffer_is_dropped(void) {
+    relay.add(sensorFrame.data(), sensorFrame.size(), -80, 5, 0, 1000);
+
+    TEST_ASSERT_EQUAL_size_t(0, relay.encode(relayFrame.data(), 8, 2000));
+    TEST_ASSERT_EQUAL_UINT32(1, relay.statistics().frames_dropped);
+    TEST_ASSERT_FALSE(relay.ready(10 * HOLD_US));
+}
+
+int main(int /* argc */, char ** /* argv */) {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_batch_is_never_ready);
+    RUN_TEST(test_batch_is_ready_when_full);
+    RUN_TEST(test_batch_is_ready_when_the_oldest_frame_is_held_long_enough);
+    RUN_TEST(test_frames_over_the_hop_limit_or_the_entry_size_are_dropped);
+    RUN_TEST(test_frames_beyond_a_full_batch_are_dropped);
+    RUN_TEST(test_full_batch_of_largest_frames_fits_a_relay_frame);
+    RUN_TEST(test_encoded_batch_keeps_frames_and_link_data);
+    RUN_TEST(test_encode_starts_the_next_batch);
+    RUN_TEST(test_entry_ages_are_clamped);
+    RUN_TEST(test_batch_that_does_not_fit_the_buffer_is_dropped);
+    return UNITY_END();
+}
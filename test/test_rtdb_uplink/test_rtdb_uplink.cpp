@@ -0,0 +1,366 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// File description
+// =========================================================
+// test_rtdb_uplink.cpp - Unit tests of the asynchronous RTDB uplink.
+//
+// The latency test reports the time the uplink takes to write a series of
+// records, pipelined and one at a time, against a server that answers each
+// request after a set latency.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <WiFi.h>
+#include <unity.h>
+#include "root_ca.h"            // NOLINT
+#include "rtdb_uplink.h"        // NOLINT
+
+constexpr char NO_CONTENT[] {"HTTP/1.1 204 No Content\r\n\r\n"};
+constexpr auto POLL_STEP_MS   {10};                     // Uplink task, see UPLINK_POLL_PERIOD_MS
+constexpr auto LATENCY_WRITES {32};
+
+typedef struct {
+    void       *context;
+    int         status;
+    std::string response;
+} done_call_t;
+
+static std::vector<done_call_t> doneCalls;
+
+static void onDone(void *context, int status, uint32_t /* rttMs */, const char *response) {
+    doneCalls.push_back({context, status, (response != nullptr) ? response : "(null)"});
+}
+
+static int contexts[UPLINK_MAX_PENDING];
+
+static void submitWrite(RtdbUplink *uplink, size_t index) {
+    char *body = uplink->nextBody();
+
+    TEST_ASSERT_NOT_NULL(body);
+    strcpy(body, "{\"level\":1}");
+    TEST_ASSERT_TRUE(uplink->submit("water_tank/sensor/1", strlen(body), &contexts[index]));
+}
+
+static size_t countOf(const std::string &text, const char *pattern) {
+    size_t found {0};
+
+    for (size_t at = text.find(pattern); at != std::string::npos; at = text.find(pattern, at + 1)) {
+        ++found;
+    }
+
+    return found;
+}
+
+void setUp(void) {
+    hostServer().reset();
+    hostWiFi().state = WL_CONNECTED;
+    hostMillis() = 1000;
+    doneCalls.clear();
+}
+
+void tearDown(void) {}
+
+static void test_server_certificate_is_checked(void) {
+    RtdbUplink uplink(onDone);
+
+    uplink.begin("https://example-rtdb.firebaseio.com/");
+
+    TEST_ASSERT_EQUAL_PTR(ROOT_CA_PEM, hostServer().ca_cert);
+}
+
+static void test_nothing_is_sent_without_authorization(void) {
+    RtdbUplink uplink(onDone);
+
+    uplink.begin("https://example-rtdb.firebaseio.com/");
+    uplink.setToken("token");
+    submitWrite(&uplink, 0);
+    uplink.poll(false);
+
+    TEST_ASSERT_EQUAL_UINT32(0, hostServer().connections);
+    TEST_ASSERT_EQUAL_size_t(0, hostServer().sent.size());
+}
+
+static void test_writes_are_pipelined_and_completed_in_order(void) {
+    RtdbUplink uplink(onDone);
+
+    uplink.begin("https://example-rtdb.firebaseio.com/");
+    uplink.setToken("token");
+
+    for (size_t i = 0; i < 3; ++i) {
+        submitWrite(&uplink, i);
+    }
+
+    uplink.poll(true);
+
+    TEST_ASSERT_EQUAL_size_t(3, countOf(hostServer().sent, "PUT /water_tank/sensor/1.json?print=silent&auth=token "));
+    TEST_ASSERT_EQUAL_size_t(0, doneCalls.size());
+
+    for (size_t i = 0; i < 3; ++i) {
+        hostServer().reply("HTTP/1.1 204 No Content\r\n\r\n");
+    }
+
+    uplink.poll(true);
+
+    TEST_ASSERT_EQUAL_size_t(3, doneCalls.size());
+
+    for (size_t i = 0; i < 3; ++i) {
+        TEST_ASSERT_EQUAL_PTR(&contexts[i], doneCalls[i].context);
+        TEST_ASSERT_EQUAL_INT(204, doneCalls[i].status);
+        TEST_ASSERT_EQUAL_STRING("(null)", doneCalls[i].response.c_str());
+    }
+
+    TEST_ASSERT_TRUE(uplink.idle());
+}
+
+static void test_every_request_in_flight_counts_a_retry(void) {
+    RtdbUplink uplink(onDone);
+
+    uplink.begin("https://example-rtdb.firebaseio.com/");
+    uplink.setToken("token");
+    submitWrite(&uplink, 0);
+    submitWrite(&uplink, 1);
+
+    for (int attempt = 0; attempt <= UPLINK_MAX_RETRIES; ++attempt) {
+        TEST_ASSERT_EQUAL_size_t(0, doneCalls.size());
+
+        uplink.poll(true);
+        hostServer().drop();
+        hostMillis() += UPLINK_RECONNECT_PERIOD_MS;
+    }
+
+    uplink.poll(true);
+
+    TEST_ASSERT_EQUAL_UINT32(UPLINK_MAX_RETRIES + 1, hostServer().connections);
+    TEST_ASSERT_EQUAL_size_t(2, doneCalls.size());
+    TEST_ASSERT_EQUAL_PTR(&contexts[0], doneCalls[0].context);
+    TEST_ASSERT_EQUAL_INT(UPLINK_STATUS_FAILED, doneCalls[0].status);
+    TEST_ASSERT_EQUAL_PTR(&contexts[1], doneCalls[1].context);
+    TEST_ASSERT_EQUAL_INT(UPLINK_STATUS_FAILED, doneCalls[1].status);
+    TEST_ASSERT_TRUE(uplink.idle());
+}
+
+static void test_a_closed_connection_is_not_a_failure(void) {
+    RtdbUplink uplink(onDone);
+
+    uplink.begin("https://example-rtdb.firebaseio.com/");
+    uplink.setToken("token");
+    submitWrite(&uplink, 0);
+    submitWrite(&uplink, 1);
+
+    for (int attempt = 0; attempt <= UPLINK_MAX_RETRIES; ++attempt) {
+        uplink.poll(true);
+        hostServer().reply("HTTP/1.1 204 No Content\r\nConnection: close\r\n\r\n");
+        uplink.poll(true);
+        hostServer().response.clear();
+        hostServer().read_position = 0;
+        hostMillis() += UPLINK_RECONNECT_PERIOD_MS;
+    }
+
+    TEST_ASSERT_EQUAL_size_t(2, doneCalls.size());
+    TEST_ASSERT_EQUAL_INT(204, doneCalls[0].status);
+    TEST_ASSERT_EQUAL_INT(204, doneCalls[1].status);
+}
+
+static void test_fetch_hands_the_response_body(void) {
+    RtdbUplink uplink(onDone);
+
+    uplink.begin("https://example-rtdb.firebaseio.com/");
+    uplink.setToken("token");
+    TEST_ASSERT_TRUE(uplink.fetch("water_tank/bridge/config/radio_profile", &contexts[0]));
+    submitWrite(&uplink, 1);
+    uplink.poll(true);
+
+    TEST_ASSERT_EQUAL_size_t(1, countOf(hostServer().sent,
+                                        "GET /water_tank/bridge/config/radio_profile.json?auth=token "));
+
+    hostServer().reply("HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\n\"sf7bw125\"");
+    hostServer().reply("HTTP/1.1 204 No Content\r\n\r\n");
+    uplink.poll(true);
+
+    TEST_ASSERT_EQUAL_size_t(2, doneCalls.size());
+    TEST_ASSERT_EQUAL_INT(200, doneCalls[0].status);
+    TEST_ASSERT_EQUAL_STRING("\"sf7bw125\"", doneCalls[0].response.c_str());
+    TEST_ASSERT_EQUAL_INT(204, doneCalls[1].status);
+    TEST_ASSERT_EQUAL_STRING("(null)", doneCalls[1].response.c_str());
+}
+
+static void test_token_is_not_printed(void) {
+    RtdbUplink uplink(onDone);
+
+    Serial.clear();
+    uplink.begin("https://example-rtdb.firebaseio.com/");
+    uplink.setToken("secret-token");
+    hostServer().accept = false;
+    submitWrite(&uplink, 0);
+    uplink.poll(true);
+    hostServer().accept = true;
+    hostMillis() += UPLINK_RECONNECT_PERIOD_MS;
+    uplink.poll(true);
+    hostServer().drop();
+    hostMillis() += UPLINK_RECONNECT_PERIOD_MS;
+    uplink.poll(true);
+
+    TEST_ASSERT_EQUAL_size_t(2, countOf(hostServer().sent, "auth=secret-token"));
+    TEST_ASSERT_EQUAL_size_t(0, countOf(Serial.output(), "secret-token"));
+}
+
+static void test_timeout_then_reconnect_then_certificate_failure(void) {
+    RtdbUplink uplink(onDone);
+    HostServer &server = hostServer();
+
+    Serial.clear();
+    uplink.begin("https://example-rtdb.firebaseio.com/");
+    uplink.setToken("token");
+    server.auto_response = NO_CONTENT;
+    server.stall(UPLINK_RESPONSE_TIMEOUT_MS + UPLINK_RECONNECT_PERIOD_MS);
+    submitWrite(&uplink, 0);
+    submitWrite(&uplink, 1);
+    uplink.poll(true);
+
+    // The server takes the writes and stalls: the uplink gives up on the connection.
+    hostMillis() += UPLINK_RESPONSE_TIMEOUT_MS;
+    uplink.poll(true);
+
+    TEST_ASSERT_EQUAL_UINT32(0, uplink.statistics().timeouts);
+
+    hostMillis() += 1;
+    uplink.poll(true);
+
+    TEST_ASSERT_EQUAL_UINT32(1, uplink.statistics().timeouts);
+    TEST_ASSERT_FALSE(server.connected);
+    TEST_ASSERT_EQUAL_size_t(0, doneCalls.size());
+
+    // The certificate changed meanwhile: the handshake fails and the writes
+    // wait, with a new attempt every reconnect period.
+    server.trusted_cert = false;
+    uplink.poll(true);
+
+    TEST_ASSERT_EQUAL_UINT32(1, server.certificate_failures);
+
+    hostMillis() += UPLINK_RECONNECT_PERIOD_MS - 1;
+    uplink.poll(true);
+
+    TEST_ASSERT_EQUAL_UINT32(1, server.certificate_failures);
+
+    hostMillis() += 1;
+    uplink.poll(true);
+
+    TEST_ASSERT_EQUAL_UINT32(2, server.certificate_failures);
+    TEST_ASSERT_EQUAL_UINT32(1, server.connections);
+    TEST_ASSERT_EQUAL_size_t(0, doneCalls.size());
+    TEST_ASSERT_EQUAL_size_t(2, countOf(Serial.output(), "Uplink: cannot connect to example-rtdb.firebaseio.com"));
+
+    // Trusted again: the next connection sends both writes again and the
+    // server, no longer stalled, answers them.
+    server.trusted_cert = true;
+    hostMillis() += UPLINK_RECONNECT_PERIOD_MS;
+    uplink.poll(true);
+    uplink.poll(true);
+
+    TEST_ASSERT_EQUAL_UINT32(2, server.connections);
+    TEST_ASSERT_EQUAL_size_t(4, countOf(server.sent, "PUT /water_tank/sensor/1.json"));
+    TEST_ASSERT_EQUAL_size_t(2, doneCalls.size());
+    TEST_ASSERT_EQUAL_PTR(&contexts[0], doneCalls[0].context);
+    TEST_ASSERT_EQUAL_INT(204, doneCalls[0].status);
+    TEST_ASSERT_EQUAL_PTR(&contexts[1], doneCalls[1].context);
+    TEST_ASSERT_EQUAL_INT(204, doneCalls[1].status);
+    TEST_ASSERT_EQUAL_UINT32(1, uplink.statistics().timeouts);
+    TEST_ASSERT_EQUAL_UINT32(0, uplink.statistics().errors);
+    TEST_ASSERT_TRUE(uplink.idle());
+}
+
+/**
+ * @brief Return the time to write LATENCY_WRITES records through the uplink.
+ *
+ * @param latencyMs The time the server takes to answer a request.
+ * @param serial true to submit a write only once the previous one is done.
+ */
+static uint32_t timeWrites(uint32_t latencyMs, bool serial) {
+    RtdbUplink uplink(onDone);
+    HostServer &server = hostServer();
+
+    server.reset();
+    server.auto_response = NO_CONTENT;
+    server.latency_ms    = latencyMs;
+    doneCalls.clear();
+
+    uplink.begin("https://example-rtdb.firebaseio.com/");
+    uplink.setToken("token");
+
+    uint32_t start = millis();
+    size_t submitted {0};
+
+    while (doneCalls.size() < LATENCY_WRITES) {
+        while (submitted < LATENCY_WRITES && uplink.room() > 0 && (!serial || uplink.idle())) {
+            submitWrite(&uplink, submitted++ % UPLINK_MAX_PENDING);
+        }
+
+        uplink.poll(true);
+        hostMillis() += POLL_STEP_MS;
+    }
+
+    for (const auto &call : doneCalls) {
+        TEST_ASSERT_EQUAL_INT(204, call.status);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(1, server.connections);
+
+    return millis() - start;
+}
+
+static void test_pipelining_hides_the_latency(void) {
+    const uint32_t latencies[] {20, 100, 500, 2000};
+
+    for (uint32_t latencyMs : latencies) {
+        uint32_t serialMs    = timeWrites(latencyMs, true);
+        uint32_t pipelinedMs = timeWrites(latencyMs, false);
+        char message[96];
+
+        snprintf(message, sizeof(message), "%u writes, latency %4u ms: serial %6u ms, pipelined %6u ms",
+                 LATENCY_WRITES, latencyMs, serialMs, pipelinedMs);
+        TEST_MESSAGE(message);
+
+        // Up to UPLINK_MAX_IN_FLIGHT writes share each round trip.
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(serialMs / UPLINK_MAX_IN_FLIGHT + latencyMs + POLL_STEP_MS, pipelinedMs);
+    }
+}
+
+int main(int /* argc */, char ** /* argv */) {
+    UNITY_BEGIN();
+    RUN_TEST(test_server_certificate_is_checked);
+    RUN_TEST(test_nothing_is_sent_without_authorization);
+    RUN_TEST(test_writes_are_pipelined_and_completed_in_order);
+    RUN_TEST(test_every_request_in_flight_counts_a_retry);
+    RUN_TEST(test_a_closed_connection_is_not_a_failure);
+    RUN_TEST(test_fetch_hands_the_response_body);
+    RUN_TEST(test_token_is_not_printed);
+    RUN_TEST(test_timeout_then_reconnect_then_certificate_failure);
+    RUN_TEST(test_pipelining_hides_the_latency);
+    return UNITY_END();
+}
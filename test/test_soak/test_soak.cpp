@@ -0,0 +1,254 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// test_soak.cpp - Soak test of the per-packet path: no packet may allocate memory.
+//
+// The frames of a few water level and air sensors go through the code of the
+// radio and uplink tasks: the receive pipeline, the reading pool and queue,
+// the JSON body of the request and the RTDB uplink, over the host TLS client.
+// The frames come in bursts and the server answers the requests in flight
+// after a round trip, so the requests are pipelined as on the bridge. The allocations are counted for
+// the whole run, after the queue and the server buffers are set up.
+
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <pb_encode.h>
+#include <unity.h>
+#include <WiFi.h>
+#include "packet_log.h"         // NOLINT
+#include "reading_uplink.h"     // NOLINT
+#include "receive_pipeline.h"   // NOLINT
+#include "rtdb_uplink.h"        // NOLINT
+#include "wall_clock.h"         // NOLINT
+
+constexpr uint32_t SOAK_PACKETS   {1000000};
+constexpr auto     SOAK_SENSORS   {4};            // Per payload type
+constexpr auto     SOAK_BURST     {2 * SOAK_SENSORS};
+constexpr auto     SOAK_RTT_MS    {40};
+constexpr auto     SOAK_SENT_SIZE {64 * 1024};
+
+static size_t allocations {0};
+
+#ifdef __GLIBC__
+// Every allocation, operator new included, goes through malloc.
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+
+void *malloc(size_t size) noexcept {
+    ++allocations;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) noexcept {
+    ++allocations;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size) noexcept {
+    ++allocations;
+    return __libc_realloc(pointer, size);
+}
+}
+#else
+void *operator new(size_t size) {
+    ++allocations;
+
+    void *pointer = std::malloc(size);
+
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    return pointer;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+    std::free(pointer);
+}
+#endif
+
+constexpr char SOAK_RESPONSE[] {"HTTP/1.1 204 No Content\r\n\r\n"};
+
+static void onUplinkDone(void *context, int status, uint32_t rttMs, const char *response);
+static void onReading(const ReceivedReading &reading);
+
+static PacketLog packetLog;
+static RtdbUplink rtdbUplink(onUplinkDone);
+static ReadingUplink readingUplink(&rtdbUplink, &packetLog);
+static ReceivePipeline pipeline({nullptr, onReading}, &packetLog);
+
+static void onReading(const ReceivedReading &reading) {
+    readingUplink.queueReading(pipeline, reading);
+}
+
+static void onUplinkDone(void *context, int status, uint32_t /* rttMs */, const char * /* response */) {
+    readingUplink.done(static_cast<SensorReading *>(context), status);
+}
+
+static size_t encodeFrame(uint32_t index, std::array<uint8_t, 32> *frame) {
+    uint32_t sensor   = 1 + (index / 2) % SOAK_SENSORS;
+    uint32_t packetId = index / SOAK_BURST;
+    PayloadTypeId typeId {};
+    const void *message {nullptr};
+
+    LoraPayload level = LoraPayload_init_zero;
+    AirPayload  air   = AirPayload_init_zero;
+
+    if (index % 2 == 0) {
+        level.id            = packetId;
+        level.distance      = 1000 + packetId % 1000;
+        level.level         = packetId % 101;
+        level.has_sensor_id = true;
+        level.sensor_id     = sensor;
+        level.has_boot_id   = true;
+        level.boot_id       = 1;
+
+        typeId  = PayloadTypeId::PAYLOAD_TYPE_WATER_LEVEL;
+        message = &level;
+    } else {
+        air.id            = packetId;
+        air.temperature   = -75 + static_cast<int32_t>(packetId % 150);
+        air.has_sensor_id = true;
+        air.sensor_id     = sensor;
+
+        typeId  = PayloadTypeId::PAYLOAD_TYPE_AIR;
+        message = &air;
+    }
+
+    (*frame)[0] = static_cast<uint8_t>(typeId);
+
+    pb_ostream_t stream = pb_ostream_from_buffer(frame->data() + 1, frame->size() - 1);
+
+    TEST_ASSERT_TRUE(pb_encode(&stream, payloadType((*frame)[0])->fields, message));
+    return stream.bytes_written + 1;
+}
+
+/**
+ * @brief Answer every request the uplink sent since the last call.
+ */
+static void answerRequests(void) {
+    HostServer &server = hostServer();
+    const char *request = server.sent.c_str();
+
+    while ((request = strstr(request, "PUT /")) != nullptr) {
+        server.reply(SOAK_RESPONSE);
+        ++request;
+    }
+
+    server.sent.clear();
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_packets_never_allocate(void) {
+    std::array<uint8_t, 32> frame {};
+    HostServer &server = hostServer();
+
+    hostWiFi().state = WL_CONNECTED;
+    hostMillis() = 1000;
+    server.sent.reserve(SOAK_SENT_SIZE);
+    server.response.reserve(SOAK_BURST * sizeof(SOAK_RESPONSE));
+
+    pipeline.reset(7);
+    rtdbUplink.begin("https://soak-rtdb.firebaseio.com/");
+    rtdbUplink.setToken("token");
+    TEST_ASSERT_TRUE(readingUplink.begin("water_tank", 0xB1D6E, 1));
+
+    size_t before = allocations;
+
+    for (uint32_t i = 0; i < SOAK_PACKETS; ++i) {
+        size_t size = encodeFrame(i, &frame);
+
+        pipeline.receive(frame.data(), size, -90 - static_cast<int16_t>(i % 20), 5, monotonicUs());
+
+        if ((i + 1) % SOAK_BURST != 0) {
+            continue;
+        }
+
+        // Uplink task: one round trip per poll until the burst is written.
+        for (;;) {
+            readingUplink.submitQueued();
+            rtdbUplink.poll(true);
+
+            if (server.read_position == server.response.size()) {
+                server.response.clear();
+                server.read_position = 0;
+            }
+
+            if (rtdbUplink.idle() && readingUplink.waiting() == 0) {
+                break;
+            }
+
+            answerRequests();
+            hostMillis() += SOAK_RTT_MS;
+            hostMicros() += SOAK_RTT_MS * 1000;
+        }
+
+        if (i % 1000 < SOAK_BURST) {
+            packetLog.flush();
+            Serial.clear();
+        }
+    }
+
+    const auto &pool = readingUplink.readingPool();
+    const UplinkStats &uplinkStats = rtdbUplink.statistics();
+
+    TEST_ASSERT_EQUAL_size_t(0, allocations - before);
+    TEST_ASSERT_EQUAL_UINT32(0, readingUplink.dropped());
+    TEST_ASSERT_EQUAL_UINT32(SOAK_PACKETS, uplinkStats.completed);
+    TEST_ASSERT_EQUAL_UINT32(0, uplinkStats.errors);
+    TEST_ASSERT_EQUAL_UINT32(1, uplinkStats.connections);
+    TEST_ASSERT_TRUE(rtdbUplink.idle());
+
+    // The records of one burst at most are out of the pool at a time.
+    TEST_ASSERT_EQUAL_size_t(pool.capacity(), pool.available());
+    TEST_ASSERT_LESS_OR_EQUAL_size_t(SOAK_BURST, pool.capacity() - pool.lowWater());
+    TEST_ASSERT_EQUAL_UINT32(0, pool.badReleaseCount());
+
+    // The uplink writes a burst in as many round trips as it takes in flight.
+    TEST_ASSERT_EQUAL_UINT32(SOAK_BURST / UPLINK_MAX_IN_FLIGHT * SOAK_RTT_MS, readingUplink.latencyMaxMs());
+}
+
+int main(int /* argc */, char ** /* argv */) {
+    UNITY_BEGIN();
+    RUN_TEST(test_packets_never_allocate);
+    return UNITY_END();
+}
@@ -0,0 +1,130 @@
+// Copyright notice
+// =========================================================
+// Copyright (c) 2024 EmbedGenius
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// File description
+// =========================================================
+// test_static_pool.cpp - Unit tests of the fixed-size object pool.
+
+// The misuse tests check the counters instead of aborting.
+#define NDEBUG
+
+#include <unity.h>
+#include "static_pool.h"        // NOLINT
+
+typedef struct {
+    uint32_t value;
+    uint8_t  tag;
+} pooled_t;
+
+using Pool = StaticPool<pooled_t, 3>;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_acquire_until_exhausted(void) {
+    Pool pool;
+    pooled_t *items[3];
+
+    for (auto &item : items) {
+        item = pool.acquire();
+        TEST_ASSERT_NOT_NULL(item);
+    }
+
+    TEST_ASSERT_TRUE(items[0] != items[1] && items[1] != items[2] && items[0] != items[2]);
+    TEST_ASSERT_NULL(pool.acquire());
+    TEST_ASSERT_EQUAL_UINT32(1, pool.failureCount());
+    TEST_ASSERT_EQUAL_size_t(0, pool.available());
+    TEST_ASSERT_EQUAL_size_t(0, pool.lowWater());
+}
+
+static void test_release_makes_the_object_available_again(void) {
+    Pool pool;
+    pooled_t *item = pool.acquire();
+
+    pool.release(item);
+
+    TEST_ASSERT_EQUAL_size_t(3, pool.available());
+    TEST_ASSERT_EQUAL_size_t(2, pool.lowWater());
+    TEST_ASSERT_EQUAL_PTR(item, pool.acquire());
+}
+
+static void test_release_of_nullptr_is_ignored(void) {
+    Pool pool;
+
+    pool.release(nullptr);
+
+    TEST_ASSERT_EQUAL_size_t(3, pool.available());
+    TEST_ASSERT_EQUAL_UINT32(0, pool.badReleaseCount());
+}
+
+static void test_double_release_is_rejected(void) {
+    Pool pool;
+    pooled_t *item = pool.acquire();
+
+    pool.release(item);
+    pool.release(item);
+
+    TEST_ASSERT_EQUAL_size_t(3, pool.available());
+    TEST_ASSERT_EQUAL_UINT32(1, pool.badReleaseCount());
+}
+
+static void test_release_of_a_free_object_is_rejected(void) {
+    Pool pool;
+    pooled_t *item = pool.acquire();
+
+    pool.release(item + 1);
+
+    TEST_ASSERT_EQUAL_size_t(2, pool.available());
+    TEST_ASSERT_EQUAL_UINT32(1, pool.badReleaseCount());
+}
+
+static void test_release_of_a_foreign_object_is_rejected(void) {
+    Pool pool;
+    Pool other;
+    pooled_t local {};
+    pooled_t *item = pool.acquire();
+
+    pool.release(&local);
+    pool.release(other.acquire());
+    pool.release(reinterpret_cast<pooled_t *>(reinterpret_cast<uint8_t *>(item) + 1));
+
+    TEST_ASSERT_EQUAL_size_t(2, pool.available());
+    TEST_ASSERT_EQUAL_UINT32(3, pool.badReleaseCount());
+
+    pool.release(item);
+    TEST_ASSERT_EQUAL_size_t(3, pool.available());
+}
+
+int main(int /* argc */, char ** /* argv */) {
+    UNITY_BEGIN();
+    RUN_TEST(test_acquire_until_exhausted);
+    RUN_TEST(test_release_makes_the_object_available_again);
+    RUN_TEST(test_release_of_nullptr_is_ignored);
+    RUN_TEST(test_double_release_is_rejected);
+    RUN_TEST(test_release_of_a_free_object_is_rejected);
+    RUN_TEST(test_release_of_a_foreign_object_is_rejected);
+    return UNITY_END();
+}